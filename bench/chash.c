@@ -0,0 +1,201 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <octonaut/common.h>
+#include <octonaut/hash_function.h>
+#include <octonaut/hash.h>
+#include <octonaut/chash.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#include "bench.h"
+
+/**
+ * mixed lookups, puts, and pops from 1 to 64 threads on a single mutex
+ * around an octo_hash against the sharded octo_chash
+ *
+ * nine in ten operations look up a shared key, the rest put or pop a key
+ * of the thread's own
+ */
+
+#define BENCH_SHARED 100000
+#define BENCH_OWN 1000
+#define BENCH_OPS 1000000
+
+typedef struct bench_entry
+{
+    uint32_t key;
+    octo_hash_entry hash;
+} bench_entry;
+
+typedef struct bench_thread
+{
+    pthread_t thread;
+    bool sharded;
+    uint64_t seed;
+    bench_entry own[BENCH_OWN];
+} bench_thread;
+
+static pthread_mutex_t bench_mutex = PTHREAD_MUTEX_INITIALIZER;
+static octo_hash bench_hash;
+static octo_chash bench_chash;
+static bench_entry bench_shared[BENCH_SHARED];
+
+static void * bench_worker(void *arg)
+{
+    bench_thread *t = arg;
+    size_t found = 0;
+    size_t next = 0;
+
+    for(size_t i = 0; i < BENCH_OPS; ++i)
+    {
+        uint64_t r = bench_rand(&t->seed);
+
+        if(r % 10)
+        {
+            uint32_t key = (r >> 8) % BENCH_SHARED;
+
+            if(t->sharded)
+            {
+                found += octo_chash_get(&bench_chash, &key, sizeof(key)) != NULL;
+            }
+            else
+            {
+                pthread_mutex_lock(&bench_mutex);
+                found += octo_hash_get(&bench_hash, &key, sizeof(key)) != NULL;
+                pthread_mutex_unlock(&bench_mutex);
+            }
+            continue;
+        }
+
+        /* alternately put and pop the thread's own keys in turn */
+        bench_entry *e = &t->own[next/2 % BENCH_OWN];
+        next += 1;
+
+        if(t->sharded)
+        {
+            if(next % 2)
+            {
+                octo_chash_put(&bench_chash, &e->hash);
+            }
+            else
+            {
+                octo_chash_pop(&bench_chash, &e->key, sizeof(e->key));
+            }
+        }
+        else
+        {
+            pthread_mutex_lock(&bench_mutex);
+            if(next % 2)
+            {
+                octo_hash_put(&bench_hash, &e->hash);
+            }
+            else
+            {
+                octo_hash_pop(&bench_hash, &e->key, sizeof(e->key));
+            }
+            pthread_mutex_unlock(&bench_mutex);
+        }
+    }
+
+    return (void *)found;
+}
+
+static void bench_threads(size_t n_threads, bool sharded)
+{
+    bench_thread *threads = calloc(n_threads, sizeof(bench_thread));
+    char param[32];
+    double start;
+
+    for(size_t t = 0; t < n_threads; ++t)
+    {
+        threads[t].sharded = sharded;
+        threads[t].seed = 88172645463325252ULL + t;
+        for(uint32_t i = 0; i < BENCH_OWN; ++i)
+        {
+            threads[t].own[i].key = BENCH_SHARED + t*BENCH_OWN + i;
+            octo_hash_entry_init(&threads[t].own[i].hash,
+                &threads[t].own[i].key, sizeof(uint32_t));
+        }
+    }
+
+    start = bench_now();
+    for(size_t t = 0; t < n_threads; ++t)
+    {
+        pthread_create(&threads[t].thread, NULL, bench_worker, &threads[t]);
+    }
+    for(size_t t = 0; t < n_threads; ++t)
+    {
+        pthread_join(threads[t].thread, NULL);
+    }
+
+    /* time per operation across all threads, lower scales better */
+    snprintf(param, sizeof(param), "threads/%zu", n_threads);
+    bench_report(sharded ? "octo_chash_mixed" : "octo_hash_mutex_mixed",
+        param, BENCH_OPS*n_threads, bench_now() - start);
+
+    /* leave only the shared keys for the next run */
+    for(size_t t = 0; t < n_threads; ++t)
+    {
+        for(uint32_t i = 0; i < BENCH_OWN; ++i)
+        {
+            octo_hash_pop(&bench_hash, &threads[t].own[i].key, sizeof(uint32_t));
+            octo_chash_pop(&bench_chash, &threads[t].own[i].key, sizeof(uint32_t));
+        }
+    }
+    free(threads);
+}
+
+int main(int argc, char **argv)
+{
+    octo_hash_init(&bench_hash, octo_default_hash_function, 0, 17);
+    octo_chash_init(&bench_chash, octo_default_hash_function, 0, 6, 11);
+
+    for(uint32_t i = 0; i < BENCH_SHARED; ++i)
+    {
+        bench_shared[i].key = i;
+        octo_hash_entry_init(&bench_shared[i].hash, &bench_shared[i].key, sizeof(uint32_t));
+        octo_chash_put(&bench_chash, &bench_shared[i].hash);
+    }
+
+    /* entries are intrusive so the mutex table needs its own copies */
+    bench_entry *copies = malloc(sizeof(bench_entry)*BENCH_SHARED);
+    for(uint32_t i = 0; i < BENCH_SHARED; ++i)
+    {
+        copies[i].key = i;
+        octo_hash_entry_init(&copies[i].hash, &copies[i].key, sizeof(uint32_t));
+        octo_hash_put(&bench_hash, &copies[i].hash);
+    }
+
+    for(size_t n_threads = 1; n_threads <= 64; n_threads *= 2)
+    {
+        bench_threads(n_threads, false);
+        bench_threads(n_threads, true);
+    }
+
+    octo_chash_destroy(&bench_chash);
+    octo_hash_destroy(&bench_hash);
+    free(copies);
+    return 0;
+}
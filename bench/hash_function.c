@@ -0,0 +1,374 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <octonaut/common.h>
+#include <octonaut/hash_function.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "bench.h"
+
+/**
+ * speed and quality of every octo_hash function
+ *
+ * speed is nanoseconds per hash and megabytes per second for key lengths
+ * from 1 to 4096 bytes. quality is the worst avalanche bias over every
+ * input and output bit, the chi-square of bin counts as a standard score
+ * (near 0 is uniform, large is clumped), and full 32 bit collisions on
+ * realistic key sets of header names, urls, and sequential integers.
+ */
+
+typedef struct bench_function
+{
+    const char *name;
+    octo_hash_function fn;
+} bench_function;
+
+static const bench_function bench_functions[] = {
+    {"octo_hash_murmur3", octo_hash_murmur3},
+    {"octo_hash_murmur3_x64", octo_hash_murmur3_x64},
+    {"octo_hash_wyhash", octo_hash_wyhash},
+    {"octo_hash_crc32c", octo_hash_crc32c},
+    {"octo_hash_siphash13", octo_hash_siphash13},
+    {"octo_hash_halfsiphash13", octo_hash_halfsiphash13},
+    {"octo_default_hash_function", octo_default_hash_function},
+};
+
+#define BENCH_N_FUNCTIONS (sizeof(bench_functions)/sizeof(bench_functions[0]))
+
+static const char *bench_header_names[] = {
+    "Accept", "Accept-Charset", "Accept-Encoding", "Accept-Language",
+    "Accept-Ranges", "Access-Control-Allow-Origin", "Age", "Allow",
+    "Authorization", "Cache-Control", "Connection", "Content-Disposition",
+    "Content-Encoding", "Content-Language", "Content-Length",
+    "Content-Location", "Content-Range", "Content-Type", "Cookie", "Date",
+    "DNT", "ETag", "Expect", "Expires", "Forwarded", "From", "Host",
+    "If-Match", "If-Modified-Since", "If-None-Match", "If-Range",
+    "If-Unmodified-Since", "Keep-Alive", "Last-Modified", "Link",
+    "Location", "Max-Forwards", "Origin", "Pragma", "Proxy-Authenticate",
+    "Proxy-Authorization", "Range", "Referer", "Retry-After", "Server",
+    "Set-Cookie", "TE", "Trailer", "Transfer-Encoding", "Upgrade",
+    "User-Agent", "Vary", "Via", "Warning", "WWW-Authenticate",
+    "X-Forwarded-For", "X-Forwarded-Host", "X-Forwarded-Proto",
+    "X-Request-Id", "X-Real-IP", "X-Frame-Options", "X-Content-Type-Options",
+};
+
+#define BENCH_N_HEADER_NAMES (sizeof(bench_header_names)/sizeof(bench_header_names[0]))
+
+/**
+ * a set of keys stored back to back
+ */
+typedef struct bench_keys
+{
+    const char *name;
+    size_t n;
+    char *data;
+    size_t *offsets;
+    size_t *lens;
+} bench_keys;
+
+static void bench_keys_init(bench_keys *keys, const char *name, size_t n, size_t maxlen)
+{
+    keys->name = name;
+    keys->n = 0;
+    keys->data = malloc(n*maxlen);
+    keys->offsets = malloc(sizeof(size_t)*n);
+    keys->lens = malloc(sizeof(size_t)*n);
+}
+
+static void bench_keys_add(bench_keys *keys, const void *key, size_t len)
+{
+    size_t offset = keys->n ? keys->offsets[keys->n - 1] + keys->lens[keys->n - 1] : 0;
+
+    memcpy(keys->data + offset, key, len);
+    keys->offsets[keys->n] = offset;
+    keys->lens[keys->n] = len;
+    keys->n += 1;
+}
+
+static void bench_keys_destroy(bench_keys *keys)
+{
+    free(keys->data);
+    free(keys->offsets);
+    free(keys->lens);
+}
+
+/**
+ * header names in the case clients send them and lower cased, and
+ * custom headers as services add them
+ */
+static void bench_keys_headers(bench_keys *keys, size_t n)
+{
+    char key[64];
+
+    bench_keys_init(keys, "headers", n, sizeof(key));
+
+    for(size_t i = 0; i < BENCH_N_HEADER_NAMES && keys->n < n; ++i)
+    {
+        const char *header = bench_header_names[i];
+        size_t len = strlen(header);
+
+        bench_keys_add(keys, header, len);
+        for(size_t j = 0; j < len; ++j)
+        {
+            key[j] = header[j] | 0x20;
+        }
+        if(memcmp(key, header, len) != 0)
+        {
+            bench_keys_add(keys, key, len);
+        }
+    }
+
+    for(size_t i = 0; keys->n < n; ++i)
+    {
+        size_t len = snprintf(key, sizeof(key), "X-%s-%zu",
+            bench_header_names[i % BENCH_N_HEADER_NAMES], i/BENCH_N_HEADER_NAMES);
+        bench_keys_add(keys, key, len);
+    }
+}
+
+/**
+ * request paths with ids and queries like an api sees
+ */
+static void bench_keys_urls(bench_keys *keys, size_t n)
+{
+    static const char *resources[] = {"users", "orders", "items", "sessions", "carts"};
+    uint64_t state = 88172645463325252ULL;
+    char key[128];
+
+    bench_keys_init(keys, "urls", n, sizeof(key));
+
+    for(size_t i = 0; i < n; ++i)
+    {
+        size_t len;
+
+        switch(i % 3)
+        {
+            case 0:
+                len = snprintf(key, sizeof(key), "/api/v1/%s/%zu",
+                    resources[i/3 % 5], i/15);
+                break;
+            case 1:
+                len = snprintf(key, sizeof(key), "/api/v1/%s/%zu/history?page=%zu&limit=50",
+                    resources[i/3 % 5], i/15, (size_t)(bench_rand(&state) % 100));
+                break;
+            default:
+                len = snprintf(key, sizeof(key), "/static/%s/app.%08zx.js",
+                    resources[i/3 % 5], i);
+                break;
+        }
+        bench_keys_add(keys, key, len);
+    }
+}
+
+/**
+ * little endian 32 bit integers counting up
+ */
+static void bench_keys_integers(bench_keys *keys, size_t n)
+{
+    bench_keys_init(keys, "integers", n, sizeof(uint32_t));
+
+    for(uint32_t i = 0; i < n; ++i)
+    {
+        bench_keys_add(keys, &i, sizeof(i));
+    }
+}
+
+static void bench_speed(const bench_function *f)
+{
+    static const size_t lens[] = {1, 2, 3, 4, 7, 8, 12, 16, 24, 32, 48, 64,
+        128, 256, 512, 1024, 4096};
+    size_t bufsize = 4096 + 64;
+    uint8_t *buf = malloc(bufsize);
+    uint64_t state = 88172645463325252ULL;
+    char param[32];
+
+    for(size_t i = 0; i < bufsize; ++i)
+    {
+        buf[i] = bench_rand(&state);
+    }
+
+    for(size_t l = 0; l < sizeof(lens)/sizeof(lens[0]); ++l)
+    {
+        size_t len = lens[l];
+        size_t ops = min(4000000, ((size_t)256 << 20)/len);
+        uint32_t sink = 0;
+        double start = bench_now();
+
+        /* keys move through the buffer so no two in a row are the same */
+        for(size_t i = 0; i < ops; ++i)
+        {
+            sink += f->fn(buf + (i & 63), len, sink);
+        }
+
+        double seconds = bench_now() - start;
+        snprintf(param, sizeof(param), "len/%zu", len);
+        bench_report(f->name, param, ops, seconds);
+        bench_metric(f->name, param, "MB/s", len*ops/seconds/(1 << 20));
+
+        if(sink == 0x12345678)
+        {
+            printf("\n");
+        }
+    }
+
+    free(buf);
+}
+
+/**
+ * the probability of each output bit flipping for each flipped input bit
+ * should be one half, report the furthest from it as a bias from 0 to 1.
+ * with 2000 samples chance alone puts the worst of them near 0.09.
+ */
+static void bench_avalanche(const bench_function *f, size_t len)
+{
+    const size_t samples = 2000;
+    uint32_t *flips = calloc(len*8*32, sizeof(uint32_t));
+    uint8_t key[64];
+    uint64_t state = 88172645463325252ULL;
+    double worst = 0;
+    char param[32];
+
+    for(size_t s = 0; s < samples; ++s)
+    {
+        for(size_t i = 0; i < len; ++i)
+        {
+            key[i] = bench_rand(&state);
+        }
+
+        uint32_t h = f->fn(key, len, 0);
+
+        for(size_t bit = 0; bit < len*8; ++bit)
+        {
+            key[bit/8] ^= 1 << (bit % 8);
+            uint32_t d = h ^ f->fn(key, len, 0);
+            key[bit/8] ^= 1 << (bit % 8);
+
+            for(int out = 0; out < 32; ++out)
+            {
+                flips[bit*32 + out] += (d >> out) & 1;
+            }
+        }
+    }
+
+    for(size_t i = 0; i < len*8*32; ++i)
+    {
+        double bias = fabs(2.0*flips[i]/samples - 1.0);
+        worst = bias > worst ? bias : worst;
+    }
+
+    snprintf(param, sizeof(param), "len/%zu", len);
+    bench_metric(f->name, param, "avalanche_bias", worst);
+    free(flips);
+}
+
+static int bench_cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * chi-square of the keys over bins chosen by the low bits of their hash
+ * as octo_hash chooses them, and full hash collisions
+ */
+static void bench_distribution(const bench_function *f, const bench_keys *keys)
+{
+    size_t n_bins = 1;
+    uint32_t *hashes = malloc(sizeof(uint32_t)*keys->n);
+    char param[32];
+
+    while(n_bins*4 <= keys->n)
+    {
+        n_bins *= 2;
+    }
+
+    uint32_t *bins = calloc(n_bins, sizeof(uint32_t));
+
+    for(size_t i = 0; i < keys->n; ++i)
+    {
+        hashes[i] = f->fn(keys->data + keys->offsets[i], keys->lens[i], 0);
+        bins[hashes[i] & (n_bins - 1)] += 1;
+    }
+
+    double expected = (double)keys->n/n_bins;
+    double chi2 = 0;
+    for(size_t i = 0; i < n_bins; ++i)
+    {
+        chi2 += (bins[i] - expected)*(bins[i] - expected)/expected;
+    }
+
+    qsort(hashes, keys->n, sizeof(uint32_t), bench_cmp_u32);
+    size_t collisions = 0;
+    for(size_t i = 1; i < keys->n; ++i)
+    {
+        collisions += hashes[i] == hashes[i - 1];
+    }
+
+    snprintf(param, sizeof(param), "%s/%zu", keys->name, keys->n);
+    bench_metric(f->name, param, "chi2_score",
+        (chi2 - (n_bins - 1))/sqrt(2.0*(n_bins - 1)));
+    bench_metric(f->name, param, "collisions", collisions);
+    bench_metric(f->name, param, "collisions_expected",
+        (double)keys->n*(keys->n - 1)/2/4294967296.0);
+
+    free(bins);
+    free(hashes);
+}
+
+int main(int argc, char **argv)
+{
+    bench_keys key_sets[4];
+
+    bench_keys_headers(&key_sets[0], 2000);
+    bench_keys_urls(&key_sets[1], 1000000);
+    bench_keys_integers(&key_sets[2], 1000000);
+    bench_keys_headers(&key_sets[3], 200000);
+
+    for(size_t i = 0; i < BENCH_N_FUNCTIONS; ++i)
+    {
+        bench_speed(&bench_functions[i]);
+    }
+
+    for(size_t i = 0; i < BENCH_N_FUNCTIONS; ++i)
+    {
+        bench_avalanche(&bench_functions[i], 4);
+        bench_avalanche(&bench_functions[i], 16);
+        bench_avalanche(&bench_functions[i], 64);
+
+        for(size_t k = 0; k < 4; ++k)
+        {
+            bench_distribution(&bench_functions[i], &key_sets[k]);
+        }
+    }
+
+    for(size_t k = 0; k < 4; ++k)
+    {
+        bench_keys_destroy(&key_sets[k]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <octonaut/hash_function.h>
+#include <octonaut/hash.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "bench.h"
+
+/**
+ * batches of random lookups one octo_hash_get at a time against
+ * octo_hash_get_many at table sizes from within L2 to far beyond it
+ */
+
+#define BENCH_LOOKUPS 4000000
+#define BENCH_BATCH 32
+
+typedef struct bench_entry
+{
+    uint64_t key;
+    octo_hash_entry hash;
+} bench_entry;
+
+static void bench_size(size_t count)
+{
+    bench_entry *entries = malloc(sizeof(bench_entry)*count);
+    uint64_t *keys = malloc(sizeof(uint64_t)*BENCH_LOOKUPS);
+    void *keyptrs[BENCH_BATCH];
+    size_t keylens[BENCH_BATCH];
+    octo_hash_entry *out[BENCH_BATCH];
+    uint64_t state = 88172645463325252ULL;
+    size_t found = 0;
+    char param[32];
+    double start;
+    octo_hash hash;
+
+    octo_hash_init(&hash, octo_default_hash_function, 0, 4);
+
+    for(size_t i = 0; i < count; ++i)
+    {
+        entries[i].key = i;
+        octo_hash_entry_init(&entries[i].hash, &entries[i].key, sizeof(uint64_t));
+        octo_hash_put(&hash, &entries[i].hash);
+    }
+
+    for(size_t i = 0; i < BENCH_LOOKUPS; ++i)
+    {
+        keys[i] = bench_rand(&state) % count;
+    }
+
+    for(size_t i = 0; i < BENCH_BATCH; ++i)
+    {
+        keylens[i] = sizeof(uint64_t);
+    }
+
+    snprintf(param, sizeof(param), "entries/%zu", count);
+
+    start = bench_now();
+    for(size_t i = 0; i < BENCH_LOOKUPS; ++i)
+    {
+        found += octo_hash_get(&hash, &keys[i], sizeof(uint64_t)) != NULL;
+    }
+    bench_report("octo_hash_get", param, BENCH_LOOKUPS, bench_now() - start);
+
+    start = bench_now();
+    for(size_t i = 0; i < BENCH_LOOKUPS; i += BENCH_BATCH)
+    {
+        for(size_t j = 0; j < BENCH_BATCH; ++j)
+        {
+            keyptrs[j] = &keys[i + j];
+        }
+        found += octo_hash_get_many(&hash, keyptrs, keylens, BENCH_BATCH, out);
+    }
+    bench_report("octo_hash_get_many", param, BENCH_LOOKUPS, bench_now() - start);
+
+    if(found != BENCH_LOOKUPS*2)
+    {
+        fprintf(stderr, "lookups found %zu of %d entries\n", found, BENCH_LOOKUPS*2);
+        exit(1);
+    }
+
+    octo_hash_destroy(&hash);
+    free(keys);
+    free(entries);
+}
+
+int main(int argc, char **argv)
+{
+    for(size_t count = 1 << 12; count <= 1 << 22; count <<= 2)
+    {
+        bench_size(count);
+    }
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <octonaut/hash_function.h>
+#include <octonaut/hash.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+
+/**
+ * header name lookups in an octo_hash of a request's worth of headers
+ * with the longer hash functions against the default, which inlines
+ * octo_hash_short for keys of up to 16 bytes
+ */
+
+#define BENCH_LOOKUPS 10000000
+
+static const char *bench_headers[] = {
+    "Host", "User-Agent", "Accept", "Accept-Language", "Accept-Encoding",
+    "Connection", "Cookie", "Referer", "Content-Type", "Content-Length",
+    "Cache-Control", "If-None-Match", "Authorization", "Origin", "Pragma",
+    "Upgrade", "TE", "Via", "X-Request-Id", "X-Forwarded-For"
+};
+
+#define BENCH_N_HEADERS (sizeof(bench_headers)/sizeof(bench_headers[0]))
+
+static void bench_function(const char *name, octo_hash_function hash_function)
+{
+    octo_hash_entry entries[BENCH_N_HEADERS];
+    size_t lens[BENCH_N_HEADERS];
+    uint64_t state = 88172645463325252ULL;
+    uint32_t *picks = malloc(sizeof(uint32_t)*BENCH_LOOKUPS);
+    size_t found = 0;
+    char param[32];
+    double start;
+    octo_hash hash;
+
+    octo_hash_init(&hash, hash_function, 0, 4);
+
+    for(size_t i = 0; i < BENCH_N_HEADERS; ++i)
+    {
+        lens[i] = strlen(bench_headers[i]);
+        octo_hash_entry_init(&entries[i], (void *)bench_headers[i], lens[i]);
+        octo_hash_put(&hash, &entries[i]);
+    }
+
+    for(size_t i = 0; i < BENCH_LOOKUPS; ++i)
+    {
+        picks[i] = bench_rand(&state) % BENCH_N_HEADERS;
+    }
+
+    snprintf(param, sizeof(param), "headers/%zu", BENCH_N_HEADERS);
+
+    start = bench_now();
+    for(size_t i = 0; i < BENCH_LOOKUPS; ++i)
+    {
+        uint32_t pick = picks[i];
+        found += octo_hash_get(&hash, (void *)bench_headers[pick], lens[pick]) != NULL;
+    }
+    bench_report(name, param, BENCH_LOOKUPS, bench_now() - start);
+
+    start = bench_now();
+    for(size_t i = 0; i < BENCH_LOOKUPS; ++i)
+    {
+        uint32_t pick = picks[i];
+        found += octo_hash_hash(&hash, (void *)bench_headers[pick], lens[pick]) != 0;
+    }
+    bench_report(name, "hash_only", BENCH_LOOKUPS, bench_now() - start);
+
+    if(found < BENCH_LOOKUPS)
+    {
+        fprintf(stderr, "lookups found %zu of %d headers\n", found, BENCH_LOOKUPS);
+        exit(1);
+    }
+
+    octo_hash_destroy(&hash);
+    free(picks);
+}
+
+int main(int argc, char **argv)
+{
+    bench_function("octo_hash_murmur3_x64", octo_hash_murmur3_x64);
+    bench_function("octo_hash_wyhash", octo_hash_wyhash);
+    bench_function("octo_default_hash_function", octo_default_hash_function);
+
+    return 0;
+}
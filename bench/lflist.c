@@ -0,0 +1,273 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <octonaut/common.h>
+#include <octonaut/list.h>
+#include <octonaut/lflist.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "bench.h"
+
+/**
+ * hand offs between threads through the lock free containers against an
+ * octo_list behind a mutex
+ *
+ * stack: every thread pops a node and pushes it back
+ * mpsc: producer threads push nodes that one consumer pops
+ * spsc: one producer passes 64 byte records to one consumer
+ */
+
+#define BENCH_OPS 2000000
+#define BENCH_NODES 1024
+
+typedef struct bench_node
+{
+    uint64_t value;
+    octo_lfstack_node stack;
+    octo_mpsc_node queue;
+    octo_list list;
+} bench_node;
+
+typedef struct bench_thread
+{
+    pthread_t thread;
+    bool locked;
+    size_t ops;
+    bench_node *nodes;
+} bench_thread;
+
+static pthread_mutex_t bench_mutex = PTHREAD_MUTEX_INITIALIZER;
+static octo_list bench_list;
+static octo_lfstack bench_stack;
+static octo_mpsc bench_queue;
+
+static void bench_run(const char *name, size_t n_threads, void *(*worker)(void *),
+        bench_thread *threads, void (*consume)(size_t ops, bool locked), bool locked)
+{
+    char param[32];
+    double start = bench_now();
+
+    for(size_t t = 0; t < n_threads; ++t)
+    {
+        threads[t].locked = locked;
+        pthread_create(&threads[t].thread, NULL, worker, &threads[t]);
+    }
+    if(consume)
+    {
+        consume(BENCH_OPS, locked);
+    }
+    for(size_t t = 0; t < n_threads; ++t)
+    {
+        pthread_join(threads[t].thread, NULL);
+    }
+
+    snprintf(param, sizeof(param), "threads/%zu", n_threads);
+    bench_report(name, param, BENCH_OPS, bench_now() - start);
+}
+
+static void * bench_stack_worker(void *arg)
+{
+    bench_thread *t = arg;
+
+    for(size_t i = 0; i < t->ops; ++i)
+    {
+        if(t->locked)
+        {
+            pthread_mutex_lock(&bench_mutex);
+            octo_list *item = octo_list_pop(&bench_list);
+            if(item != &bench_list)
+            {
+                octo_list_push(&bench_list, item);
+            }
+            pthread_mutex_unlock(&bench_mutex);
+        }
+        else
+        {
+            octo_lfstack_node *node = octo_lfstack_pop(&bench_stack);
+            if(node != NULL)
+            {
+                octo_lfstack_push(&bench_stack, node);
+            }
+        }
+    }
+    return NULL;
+}
+
+static void bench_stack_threads(size_t n_threads, bench_node *nodes)
+{
+    bench_thread *threads = calloc(n_threads, sizeof(bench_thread));
+
+    octo_list_init(&bench_list);
+    octo_lfstack_init(&bench_stack);
+    for(size_t i = 0; i < BENCH_NODES; ++i)
+    {
+        octo_list_push(&bench_list, &nodes[i].list);
+        octo_lfstack_push(&bench_stack, &nodes[i].stack);
+    }
+    for(size_t t = 0; t < n_threads; ++t)
+    {
+        threads[t].ops = BENCH_OPS/n_threads;
+    }
+
+    bench_run("octo_list_mutex_stack", n_threads, bench_stack_worker, threads, NULL, true);
+    bench_run("octo_lfstack", n_threads, bench_stack_worker, threads, NULL, false);
+    free(threads);
+}
+
+static void * bench_mpsc_producer(void *arg)
+{
+    bench_thread *t = arg;
+
+    for(size_t i = 0; i < t->ops; ++i)
+    {
+        if(t->locked)
+        {
+            pthread_mutex_lock(&bench_mutex);
+            octo_list_push(&bench_list, &t->nodes[i].list);
+            pthread_mutex_unlock(&bench_mutex);
+        }
+        else
+        {
+            octo_mpsc_push(&bench_queue, &t->nodes[i].queue);
+        }
+    }
+    return NULL;
+}
+
+static void bench_mpsc_consume(size_t ops, bool locked)
+{
+    for(size_t popped = 0; popped < ops;)
+    {
+        bool found;
+
+        if(locked)
+        {
+            pthread_mutex_lock(&bench_mutex);
+            found = octo_list_pop(&bench_list) != &bench_list;
+            pthread_mutex_unlock(&bench_mutex);
+        }
+        else
+        {
+            found = octo_mpsc_pop(&bench_queue) != NULL;
+        }
+
+        if(found)
+        {
+            popped += 1;
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+}
+
+static void bench_mpsc_threads(size_t n_threads, bench_node *nodes)
+{
+    bench_thread *threads = calloc(n_threads, sizeof(bench_thread));
+
+    for(size_t t = 0; t < n_threads; ++t)
+    {
+        threads[t].ops = BENCH_OPS/n_threads;
+        threads[t].nodes = nodes + t*threads[t].ops;
+    }
+
+    octo_list_init(&bench_list);
+    bench_run("octo_list_mutex_queue", n_threads, bench_mpsc_producer, threads,
+        bench_mpsc_consume, true);
+    octo_mpsc_init(&bench_queue);
+    bench_run("octo_mpsc", n_threads, bench_mpsc_producer, threads,
+        bench_mpsc_consume, false);
+    free(threads);
+}
+
+typedef struct bench_record
+{
+    uint64_t words[8];
+} bench_record;
+
+static octo_spsc bench_ring;
+
+static void * bench_spsc_producer(void *arg)
+{
+    bench_thread *t = arg;
+
+    for(size_t i = 0; i < t->ops;)
+    {
+        bench_record *record = octo_spsc_reserve(&bench_ring);
+        if(record == NULL)
+        {
+            sched_yield();
+            continue;
+        }
+        record->words[0] = i++;
+        octo_spsc_commit(&bench_ring);
+    }
+    return NULL;
+}
+
+static void bench_spsc_consume(size_t ops, bool locked)
+{
+    for(size_t i = 0; i < ops;)
+    {
+        bench_record *record = octo_spsc_peek(&bench_ring);
+        if(record == NULL)
+        {
+            sched_yield();
+            continue;
+        }
+        if(record->words[0] != i++)
+        {
+            fprintf(stderr, "spsc record out of order\n");
+            exit(1);
+        }
+        octo_spsc_release(&bench_ring);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bench_node *nodes = calloc(BENCH_OPS, sizeof(bench_node));
+    bench_thread producer = {.ops = BENCH_OPS};
+
+    for(size_t n_threads = 1; n_threads <= 16; n_threads *= 2)
+    {
+        bench_stack_threads(n_threads, nodes);
+    }
+
+    for(size_t n_threads = 1; n_threads <= 16; n_threads *= 2)
+    {
+        bench_mpsc_threads(n_threads, nodes);
+    }
+
+    octo_spsc_init(&bench_ring, 1024, sizeof(bench_record));
+    bench_run("octo_spsc", 1, bench_spsc_producer, &producer, bench_spsc_consume, false);
+    octo_spsc_destroy(&bench_ring);
+
+    free(nodes);
+    return 0;
+}
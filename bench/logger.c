@@ -0,0 +1,186 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <octonaut/logger.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "bench.h"
+
+/**
+ * time spent in octo_logger_log by the logging thread, writing lines
+ * straight away against queueing them to an octo_log_writer
+ *
+ * file: lines go to a temporary file
+ * slow: lines go to a pipe read 4KB at a time with a 1ms pause between
+ *       reads, like a loaded disk or a log shipper falling behind
+ *
+ * the cost of the time on a line is measured by logging to no outputs,
+ * against formatting it afresh for each line with localtime_r and
+ * strftime.
+ *
+ * the worst single call is reported along with the mean, it is how long
+ * an event loop logging the line would have been stalled. the cpu time
+ * of the logging thread alone is reported too, on a machine with fewer
+ * cores than threads the writer's time is otherwise part of the mean.
+ */
+
+#define BENCH_LINES 200000
+
+static int bench_slow_fd;
+
+static void * bench_slow_reader(void *arg)
+{
+    char buf[4096];
+
+    while(read(bench_slow_fd, buf, sizeof(buf)) > 0)
+    {
+        usleep(1000);
+    }
+    return NULL;
+}
+
+static double bench_thread_cpu()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+static void bench_log(const char *name, const char *param, octo_logger *logger, size_t lines)
+{
+    double worst = 0.0;
+    double cpu = bench_thread_cpu();
+    double start = bench_now();
+
+    for(size_t i = 0; i < lines; ++i)
+    {
+        double call = bench_now();
+        octo_plogger_info(logger, "request %zu done in %d us", i, 125);
+        call = bench_now() - call;
+        worst = call > worst ? call : worst;
+    }
+
+    bench_report(name, param, lines, bench_now() - start);
+    bench_metric(name, param, "cpu ns/op", (bench_thread_cpu() - cpu)*1e9/lines);
+    bench_metric(name, param, "worst us", worst*1e6);
+}
+
+static void bench_sink(const char *param, bool slow)
+{
+    const char *modes[] = { "sync", "async_drop", "async_block" };
+
+    for(int mode = 0; mode < 3; ++mode)
+    {
+        octo_logger logger;
+        octo_log_writer writer;
+        pthread_t reader;
+        FILE *stream;
+        char name[64];
+        size_t lines = slow ? BENCH_LINES/20 : BENCH_LINES;
+
+        if(slow)
+        {
+            int fds[2];
+            if(pipe(fds) != 0)
+            {
+                return;
+            }
+            bench_slow_fd = fds[0];
+            stream = fdopen(fds[1], "w");
+            pthread_create(&reader, NULL, bench_slow_reader, NULL);
+        }
+        else
+        {
+            stream = tmpfile();
+        }
+
+        octo_logger_init(&logger, "bench");
+        octo_logger_add_output(&logger, LOG_INFO, stream, false);
+        if(mode > 0)
+        {
+            octo_log_writer_init(&writer, 4096, mode == 1 ? LOG_DROP : LOG_BLOCK);
+            octo_logger_set_writer(&logger, &writer);
+        }
+
+        snprintf(name, sizeof(name), "octo_logger_%s", modes[mode]);
+        bench_log(name, param, &logger, lines);
+
+        octo_logger_destroy(&logger);
+        if(mode > 0)
+        {
+            octo_log_writer_destroy(&writer);
+            bench_metric(name, param, "dropped", octo_log_writer_dropped(&writer));
+        }
+
+        if(slow)
+        {
+            pthread_join(reader, NULL);
+            close(bench_slow_fd);
+        }
+    }
+}
+
+static void bench_when()
+{
+    octo_logger logger;
+    char when[80];
+    double start = bench_now();
+
+    for(size_t i = 0; i < BENCH_LINES; ++i)
+    {
+        time_t now = time(NULL);
+        struct tm ts;
+        localtime_r(&now, &ts);
+        strftime(when, sizeof(when), "%a %Y-%m-%d %H:%M:%S %Z", &ts);
+        __asm__ __volatile__("" : : "r"(when) : "memory");
+    }
+    bench_report("strftime", "seconds", BENCH_LINES, bench_now() - start);
+
+    octo_logger_init(&logger, "bench");
+    for(int precision = 0; precision <= 6; precision += 3)
+    {
+        char param[32];
+        snprintf(param, sizeof(param), "digits/%d", precision);
+        octo_logger_set_precision(&logger, precision);
+
+        start = bench_now();
+        for(size_t i = 0; i < BENCH_LINES; ++i)
+        {
+            octo_plogger_info(&logger, "request %zu done in %d us", i, 125);
+        }
+        bench_report("octo_logger_when", param, BENCH_LINES, bench_now() - start);
+    }
+    octo_logger_destroy(&logger);
+}
+
+int main(int argc, char **argv)
+{
+    bench_when();
+    bench_sink("file", false);
+    bench_sink("slow", true);
+    return 0;
+}
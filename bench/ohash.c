@@ -0,0 +1,180 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <octonaut/hash_function.h>
+#include <octonaut/hash.h>
+#include <octonaut/ohash.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+
+/**
+ * lookups of the chained octo_hash against the open addressing
+ * octo_ohash with integer and short string keys at sizes from in cache to
+ * well beyond it
+ */
+
+typedef struct bench_entry
+{
+    char key[24];
+    octo_hash_entry hash;
+} bench_entry;
+
+static bench_entry * bench_entries(size_t count, bool strings)
+{
+    bench_entry *entries = malloc(sizeof(bench_entry)*count*2);
+
+    /* the second half are keys that are never put for missed lookups */
+    for(size_t i = 0; i < count*2; ++i)
+    {
+        size_t keylen = sizeof(uint32_t);
+
+        if(strings)
+        {
+            keylen = snprintf(entries[i].key, sizeof(entries[i].key),
+                "session-%zu", i);
+        }
+        else
+        {
+            uint32_t key = i;
+            memcpy(entries[i].key, &key, sizeof(key));
+        }
+        octo_hash_entry_init(&entries[i].hash, entries[i].key, keylen);
+    }
+
+    return entries;
+}
+
+static void bench_shuffle(size_t *order, size_t count)
+{
+    uint64_t state = 88172645463325252ULL;
+
+    for(size_t i = 0; i < count; ++i)
+    {
+        order[i] = i;
+    }
+    for(size_t i = count - 1; i > 0; --i)
+    {
+        size_t j = bench_rand(&state) % (i + 1);
+        size_t t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+}
+
+static void bench_tables(size_t count, bool strings)
+{
+    bench_entry *entries = bench_entries(count, strings);
+    size_t *order = malloc(sizeof(size_t)*count);
+    size_t pow2size = 0;
+    size_t found = 0;
+    char param[64];
+    double start;
+
+    while(((size_t)1 << pow2size) < count)
+    {
+        pow2size++;
+    }
+
+    bench_shuffle(order, count);
+    snprintf(param, sizeof(param), "%s/%zu", strings ? "string" : "u32", count);
+
+    octo_hash chained;
+    octo_hash_init(&chained, octo_default_hash_function, 0, pow2size);
+    octo_ohash open;
+    octo_ohash_init(&open, octo_default_hash_function, 0, pow2size + 1);
+
+    start = bench_now();
+    for(size_t i = 0; i < count; ++i)
+    {
+        octo_hash_put(&chained, &entries[order[i]].hash);
+    }
+    bench_report("octo_hash_put", param, count, bench_now() - start);
+
+    start = bench_now();
+    for(size_t i = 0; i < count; ++i)
+    {
+        octo_ohash_put(&open, &entries[order[i]].hash);
+    }
+    bench_report("octo_ohash_put", param, count, bench_now() - start);
+
+    bench_shuffle(order, count);
+
+    start = bench_now();
+    for(size_t i = 0; i < count; ++i)
+    {
+        bench_entry *e = &entries[order[i]];
+        found += octo_hash_get(&chained, e->key, e->hash.keylen) != NULL;
+    }
+    bench_report("octo_hash_get_hit", param, count, bench_now() - start);
+
+    start = bench_now();
+    for(size_t i = 0; i < count; ++i)
+    {
+        bench_entry *e = &entries[order[i]];
+        found += octo_ohash_get(&open, e->key, e->hash.keylen) != NULL;
+    }
+    bench_report("octo_ohash_get_hit", param, count, bench_now() - start);
+
+    start = bench_now();
+    for(size_t i = 0; i < count; ++i)
+    {
+        bench_entry *e = &entries[count + order[i]];
+        found += octo_hash_get(&chained, e->key, e->hash.keylen) != NULL;
+    }
+    bench_report("octo_hash_get_miss", param, count, bench_now() - start);
+
+    start = bench_now();
+    for(size_t i = 0; i < count; ++i)
+    {
+        bench_entry *e = &entries[count + order[i]];
+        found += octo_ohash_get(&open, e->key, e->hash.keylen) != NULL;
+    }
+    bench_report("octo_ohash_get_miss", param, count, bench_now() - start);
+
+    if(found != count*2)
+    {
+        fprintf(stderr, "lookups found %zu of %zu entries\n", found, count*2);
+        exit(1);
+    }
+
+    octo_hash_destroy(&chained);
+    octo_ohash_destroy(&open);
+    free(order);
+    free(entries);
+}
+
+int main(int argc, char **argv)
+{
+    size_t counts[] = {1000, 100000, 4000000};
+
+    for(size_t i = 0; i < sizeof(counts)/sizeof(counts[0]); ++i)
+    {
+        bench_tables(counts[i], false);
+        bench_tables(counts[i], true);
+    }
+
+    return 0;
+}
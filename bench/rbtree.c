@@ -0,0 +1,250 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <octonaut/common.h>
+#include <octonaut/rbtree.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "bench.h"
+
+/**
+ * request timeouts kept in an octo_rbtree against a binary heap of the
+ * same requests, each request knowing its place in the heap so it can
+ * be cancelled
+ *
+ * schedule: add every request with a random deadline
+ * reschedule: push a random request's deadline back, as activity on a
+ * connection does
+ * expire: take the earliest request out until none are left
+ */
+
+typedef struct bench_request
+{
+    double deadline;
+    size_t heap_index;
+    octo_rbtree_entry timeout;
+} bench_request;
+
+static bool bench_deadline_eq(octo_rbtree_entry *lh, octo_rbtree_entry *rh)
+{
+    return (ptr_offset(lh, bench_request, timeout))->deadline ==
+        (ptr_offset(rh, bench_request, timeout))->deadline;
+}
+
+static bool bench_deadline_lt(octo_rbtree_entry *lh, octo_rbtree_entry *rh)
+{
+    return (ptr_offset(lh, bench_request, timeout))->deadline <
+        (ptr_offset(rh, bench_request, timeout))->deadline;
+}
+
+typedef struct bench_heap
+{
+    bench_request **items;
+    size_t size;
+} bench_heap;
+
+static inline void bench_heap_set(bench_heap *heap, size_t i, bench_request *r)
+{
+    heap->items[i] = r;
+    r->heap_index = i;
+}
+
+static void bench_heap_up(bench_heap *heap, size_t i)
+{
+    bench_request *r = heap->items[i];
+
+    while(i > 0)
+    {
+        size_t parent = (i - 1)/2;
+        if(heap->items[parent]->deadline <= r->deadline)
+        {
+            break;
+        }
+        bench_heap_set(heap, i, heap->items[parent]);
+        i = parent;
+    }
+    bench_heap_set(heap, i, r);
+}
+
+static void bench_heap_down(bench_heap *heap, size_t i)
+{
+    bench_request *r = heap->items[i];
+
+    for(;;)
+    {
+        size_t child = 2*i + 1;
+        if(child >= heap->size)
+        {
+            break;
+        }
+        if(child + 1 < heap->size && heap->items[child + 1]->deadline < heap->items[child]->deadline)
+        {
+            child += 1;
+        }
+        if(r->deadline <= heap->items[child]->deadline)
+        {
+            break;
+        }
+        bench_heap_set(heap, i, heap->items[child]);
+        i = child;
+    }
+    bench_heap_set(heap, i, r);
+}
+
+static void bench_heap_insert(bench_heap *heap, bench_request *r)
+{
+    heap->items[heap->size] = r;
+    heap->size += 1;
+    bench_heap_up(heap, heap->size - 1);
+}
+
+static void bench_heap_remove(bench_heap *heap, bench_request *r)
+{
+    size_t i = r->heap_index;
+
+    heap->size -= 1;
+    if(i == heap->size)
+    {
+        return;
+    }
+
+    /* the last item fills the hole and moves whichever way it belongs */
+    bench_request *moved = heap->items[heap->size];
+    bench_heap_set(heap, i, moved);
+    bench_heap_up(heap, i);
+    bench_heap_down(heap, moved->heap_index);
+}
+
+static void bench_size(size_t count)
+{
+    bench_request *requests = malloc(sizeof(bench_request)*count);
+    uint32_t *picks = malloc(sizeof(uint32_t)*count);
+    double *initial = malloc(sizeof(double)*count);
+    double *deadlines = malloc(sizeof(double)*count);
+    uint64_t state = 88172645463325252ULL;
+    bench_heap heap = {malloc(sizeof(bench_request *)*count), 0};
+    octo_rbtree tree;
+    char param[32];
+    double start;
+    double last;
+
+    octo_rbtree_init(&tree, bench_deadline_eq, bench_deadline_lt);
+    snprintf(param, sizeof(param), "pending/%zu", count);
+
+    for(size_t i = 0; i < count; ++i)
+    {
+        initial[i] = (bench_rand(&state) % 30000000)/1000.0;
+        requests[i].deadline = initial[i];
+        picks[i] = bench_rand(&state) % count;
+        deadlines[i] = 30000.0 + (bench_rand(&state) % 30000000)/1000.0;
+    }
+
+    start = bench_now();
+    for(size_t i = 0; i < count; ++i)
+    {
+        octo_rbtree_insert(&tree, &requests[i].timeout);
+    }
+    bench_report("octo_rbtree_schedule", param, count, bench_now() - start);
+
+    start = bench_now();
+    for(size_t i = 0; i < count; ++i)
+    {
+        bench_request *r = &requests[picks[i]];
+        octo_rbtree_remove(&tree, &r->timeout);
+        r->deadline += deadlines[i];
+        octo_rbtree_insert(&tree, &r->timeout);
+    }
+    bench_report("octo_rbtree_reschedule", param, count, bench_now() - start);
+
+    last = 0.0;
+    start = bench_now();
+    for(size_t i = 0; i < count; ++i)
+    {
+        octo_rbtree_entry *first = octo_rbtree_first(&tree);
+        bench_request *r = ptr_offset(first, bench_request, timeout);
+        if(r->deadline < last)
+        {
+            fprintf(stderr, "rbtree expired out of order\n");
+            exit(1);
+        }
+        last = r->deadline;
+        octo_rbtree_remove(&tree, first);
+    }
+    bench_report("octo_rbtree_expire", param, count, bench_now() - start);
+
+    /* the same deadlines again for the heap */
+    for(size_t i = 0; i < count; ++i)
+    {
+        requests[i].deadline = initial[i];
+    }
+
+    start = bench_now();
+    for(size_t i = 0; i < count; ++i)
+    {
+        bench_heap_insert(&heap, &requests[i]);
+    }
+    bench_report("binary_heap_schedule", param, count, bench_now() - start);
+
+    start = bench_now();
+    for(size_t i = 0; i < count; ++i)
+    {
+        bench_request *r = &requests[picks[i]];
+        bench_heap_remove(&heap, r);
+        r->deadline += deadlines[i];
+        bench_heap_insert(&heap, r);
+    }
+    bench_report("binary_heap_reschedule", param, count, bench_now() - start);
+
+    last = 0.0;
+    start = bench_now();
+    for(size_t i = 0; i < count; ++i)
+    {
+        bench_request *r = heap.items[0];
+        if(r->deadline < last)
+        {
+            fprintf(stderr, "heap expired out of order\n");
+            exit(1);
+        }
+        last = r->deadline;
+        bench_heap_remove(&heap, r);
+    }
+    bench_report("binary_heap_expire", param, count, bench_now() - start);
+
+    octo_rbtree_destroy(&tree);
+    free(heap.items);
+    free(deadlines);
+    free(initial);
+    free(picks);
+    free(requests);
+}
+
+int main(int argc, char **argv)
+{
+    for(size_t count = 1000; count <= 1000000; count *= 10)
+    {
+        bench_size(count);
+    }
+
+    return 0;
+}
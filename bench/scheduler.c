@@ -0,0 +1,180 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <octonaut/common.h>
+#include <octonaut/scheduler.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <ev.h>
+
+#include "bench.h"
+
+/**
+ * connection timeouts as one ev_timer per connection against one
+ * octo_scheduler for all of them, from 10k to 1M connections
+ *
+ * schedule: give every connection a timeout
+ * reschedule: push a random connection's timeout back, as activity on it
+ * does, with ev_timer_again for the ev_timers
+ * cancel: close every connection before its timeout
+ * expire: run the loop until every connection has timed out
+ */
+
+typedef struct bench_conn
+{
+    ev_timer timer;
+    octo_scheduler_entry timeout;
+} bench_conn;
+
+static size_t bench_fired;
+
+static void bench_timer_cb(EV_P_ ev_timer *watcher, int revents)
+{
+    bench_fired += 1;
+}
+
+static void bench_timeout_cb(octo_scheduler *scheduler, octo_scheduler_entry *entry)
+{
+    bench_fired += 1;
+}
+
+static void bench_size(struct ev_loop *loop, size_t count)
+{
+    bench_conn *conns = malloc(sizeof(bench_conn)*count);
+    double *afters = malloc(sizeof(double)*count);
+    uint32_t *picks = malloc(sizeof(uint32_t)*count);
+    uint64_t state = 88172645463325252ULL;
+    octo_scheduler scheduler;
+    char param[32];
+    double start;
+
+    octo_scheduler_init(&scheduler, loop, count);
+    snprintf(param, sizeof(param), "pending/%zu", count);
+
+    for(size_t i = 0; i < count; ++i)
+    {
+        ev_timer_init(&conns[i].timer, bench_timer_cb, 0.0, 0.0);
+        octo_scheduler_entry_init(&conns[i].timeout, bench_timeout_cb);
+        afters[i] = 30.0 + (bench_rand(&state) % 30000)/1000.0;
+        picks[i] = bench_rand(&state) % count;
+    }
+    ev_now_update(loop);
+
+    /* per connection ev_timers */
+    start = bench_now();
+    for(size_t i = 0; i < count; ++i)
+    {
+        ev_timer_set(&conns[i].timer, afters[i], 0.0);
+        ev_timer_start(loop, &conns[i].timer);
+    }
+    bench_report("ev_timer_schedule", param, count, bench_now() - start);
+
+    start = bench_now();
+    for(size_t i = 0; i < count; ++i)
+    {
+        ev_timer *timer = &conns[picks[i]].timer;
+        timer->repeat = afters[i] + 10.0;
+        ev_timer_again(loop, timer);
+    }
+    bench_report("ev_timer_reschedule", param, count, bench_now() - start);
+
+    start = bench_now();
+    for(size_t i = 0; i < count; ++i)
+    {
+        ev_timer_stop(loop, &conns[i].timer);
+    }
+    bench_report("ev_timer_cancel", param, count, bench_now() - start);
+
+    /* one scheduler */
+    start = bench_now();
+    for(size_t i = 0; i < count; ++i)
+    {
+        octo_scheduler_add(&scheduler, &conns[i].timeout, afters[i]);
+    }
+    bench_report("octo_scheduler_schedule", param, count, bench_now() - start);
+
+    start = bench_now();
+    for(size_t i = 0; i < count; ++i)
+    {
+        octo_scheduler_add(&scheduler, &conns[picks[i]].timeout, afters[i] + 10.0);
+    }
+    bench_report("octo_scheduler_reschedule", param, count, bench_now() - start);
+
+    start = bench_now();
+    for(size_t i = 0; i < count; ++i)
+    {
+        octo_scheduler_cancel(&scheduler, &conns[i].timeout);
+    }
+    bench_report("octo_scheduler_cancel", param, count, bench_now() - start);
+
+    /* every timeout already due in a random order, so the loop fires
+     * them all in one go without waiting */
+    for(size_t i = 0; i < count; ++i)
+    {
+        afters[i] = -((bench_rand(&state) % 50000)/1e6);
+    }
+
+    ev_now_update(loop);
+    bench_fired = 0;
+    for(size_t i = 0; i < count; ++i)
+    {
+        ev_timer_set(&conns[i].timer, afters[i], 0.0);
+        ev_timer_start(loop, &conns[i].timer);
+    }
+    start = bench_now();
+    ev_run(loop, 0);
+    bench_report("ev_timer_expire", param, bench_fired, bench_now() - start);
+
+    ev_now_update(loop);
+    bench_fired = 0;
+    for(size_t i = 0; i < count; ++i)
+    {
+        octo_scheduler_add(&scheduler, &conns[i].timeout, afters[i]);
+    }
+    start = bench_now();
+    ev_run(loop, 0);
+    bench_report("octo_scheduler_expire", param, bench_fired, bench_now() - start);
+
+    if(bench_fired != count)
+    {
+        fprintf(stderr, "only %zu of %zu timeouts fired\n", bench_fired, count);
+        exit(1);
+    }
+
+    octo_scheduler_destroy(&scheduler);
+    free(picks);
+    free(afters);
+    free(conns);
+}
+
+int main(int argc, char **argv)
+{
+    struct ev_loop *loop = EV_DEFAULT;
+
+    for(size_t count = 10000; count <= 1000000; count *= 10)
+    {
+        bench_size(loop, count);
+    }
+
+    return 0;
+}
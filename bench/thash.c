@@ -0,0 +1,163 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <octonaut/hash_function.h>
+#include <octonaut/hash.h>
+#include <octonaut/thash.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+
+/**
+ * lookups in tables defined with OCTO_HASH_DEFINE against the generic
+ * octo_hash for integer and short string keys
+ */
+
+#define BENCH_LOOKUPS 4000000
+
+static inline uint32_t bench_str_hash_fn(const char *key)
+{
+    return octo_default_hash_function(key, strlen(key), 0);
+}
+
+static inline bool bench_str_eq_fn(const char *a, const char *b)
+{
+    return strcmp(a, b) == 0;
+}
+
+OCTO_HASH_DEFINE(bench_u32_hash, uint32_t, octo_thash_u32, octo_thash_eq)
+OCTO_HASH_DEFINE(bench_str_hash, const char *, bench_str_hash_fn, bench_str_eq_fn)
+
+typedef struct bench_entry
+{
+    uint32_t key;
+    char name[24];
+    octo_hash_entry hash;
+    bench_u32_hash_entry u32_hash;
+    bench_str_hash_entry str_hash;
+} bench_entry;
+
+static void bench_size(size_t count)
+{
+    bench_entry *entries = malloc(sizeof(bench_entry)*count);
+    uint32_t *keys = malloc(sizeof(uint32_t)*BENCH_LOOKUPS);
+    uint64_t state = 88172645463325252ULL;
+    size_t found = 0;
+    char param[32];
+    double start;
+
+    octo_hash generic_u32;
+    octo_hash generic_str;
+    bench_u32_hash typed_u32;
+    bench_str_hash typed_str;
+
+    /* the generic string table needs entries of its own */
+    octo_hash_entry *str_entries = malloc(sizeof(octo_hash_entry)*count);
+
+    octo_hash_init(&generic_u32, octo_default_hash_function, 0, 4);
+    octo_hash_init(&generic_str, octo_default_hash_function, 0, 4);
+    bench_u32_hash_init(&typed_u32, 4);
+    bench_str_hash_init(&typed_str, 4);
+
+    for(size_t i = 0; i < count; ++i)
+    {
+        bench_entry *e = &entries[i];
+
+        e->key = i;
+        snprintf(e->name, sizeof(e->name), "conn-%zu", i);
+        octo_hash_entry_init(&e->hash, &e->key, sizeof(e->key));
+        octo_hash_put(&generic_u32, &e->hash);
+        octo_hash_entry_init(&str_entries[i], e->name, strlen(e->name));
+        octo_hash_put(&generic_str, &str_entries[i]);
+        bench_u32_hash_entry_init(&e->u32_hash, e->key);
+        bench_u32_hash_put(&typed_u32, &e->u32_hash);
+        bench_str_hash_entry_init(&e->str_hash, e->name);
+        bench_str_hash_put(&typed_str, &e->str_hash);
+    }
+
+    for(size_t i = 0; i < BENCH_LOOKUPS; ++i)
+    {
+        keys[i] = bench_rand(&state) % count;
+    }
+
+    snprintf(param, sizeof(param), "u32/%zu", count);
+
+    start = bench_now();
+    for(size_t i = 0; i < BENCH_LOOKUPS; ++i)
+    {
+        found += octo_hash_get(&generic_u32, &keys[i], sizeof(uint32_t)) != NULL;
+    }
+    bench_report("octo_hash_get", param, BENCH_LOOKUPS, bench_now() - start);
+
+    start = bench_now();
+    for(size_t i = 0; i < BENCH_LOOKUPS; ++i)
+    {
+        found += bench_u32_hash_get(&typed_u32, keys[i]) != NULL;
+    }
+    bench_report("OCTO_HASH_DEFINE_get", param, BENCH_LOOKUPS, bench_now() - start);
+
+    snprintf(param, sizeof(param), "string/%zu", count);
+
+    start = bench_now();
+    for(size_t i = 0; i < BENCH_LOOKUPS; ++i)
+    {
+        const char *name = entries[keys[i]].name;
+        found += octo_hash_get(&generic_str, (void *)name, strlen(name)) != NULL;
+    }
+    bench_report("octo_hash_get", param, BENCH_LOOKUPS, bench_now() - start);
+
+    start = bench_now();
+    for(size_t i = 0; i < BENCH_LOOKUPS; ++i)
+    {
+        found += bench_str_hash_get(&typed_str, entries[keys[i]].name) != NULL;
+    }
+    bench_report("OCTO_HASH_DEFINE_get", param, BENCH_LOOKUPS, bench_now() - start);
+
+    if(found != BENCH_LOOKUPS*4)
+    {
+        fprintf(stderr, "lookups found %zu of %d entries\n", found, BENCH_LOOKUPS*4);
+        exit(1);
+    }
+
+    octo_hash_destroy(&generic_u32);
+    octo_hash_destroy(&generic_str);
+    bench_u32_hash_destroy(&typed_u32);
+    bench_str_hash_destroy(&typed_str);
+    free(str_entries);
+    free(keys);
+    free(entries);
+}
+
+int main(int argc, char **argv)
+{
+    size_t counts[] = {1000, 100000, 1000000};
+
+    for(size_t i = 0; i < sizeof(counts)/sizeof(counts[0]); ++i)
+    {
+        bench_size(counts[i]);
+    }
+
+    return 0;
+}
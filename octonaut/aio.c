@@ -26,6 +26,8 @@
 #include <unistd.h>
 #include <errno.h>
 #include <assert.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
 
 #include "aio.h"
 
@@ -50,13 +52,26 @@ static void octo_aio_readable(EV_P_ ev_io *watcher, int revents)
  */
 static void octo_aio_writtable(EV_P_ ev_io *watcher, int revents)
 {
-    /* if the buffer is not empty, copy data from the buffer
-     * to the fd
+    /* if the buffer is not empty, write the buffered chunks
+     * straight to the fd without copying them out first, chunks
+     * spilled to disk are sent from the file by the kernel
      */
-    uint8_t buffer[4096];
+    struct iovec iov[OCTO_AIO_IOVECS];
     octo_aio *aio = (octo_aio*)watcher->data;
-    size_t len = octo_buffer_peek(&aio->write_buffer, buffer, 4096);
-    ssize_t result = write(aio->fd, buffer, len);
+    ssize_t result = 0;
+    int fd = -1;
+    off_t offset = 0;
+    size_t len = 0;
+
+    if(octo_buffer_peekfile(&aio->write_buffer, &fd, &offset, &len))
+    {
+        result = sendfile(aio->fd, fd, &offset, len);
+    }
+    else
+    {
+        size_t iovcnt = octo_buffer_peekv(&aio->write_buffer, iov, OCTO_AIO_IOVECS);
+        result = writev(aio->fd, iov, iovcnt);
+    }
 
     if(result == -1 && errno != EAGAIN)
     {
@@ -64,7 +79,7 @@ static void octo_aio_writtable(EV_P_ ev_io *watcher, int revents)
     }
     else if(result != -1)
     {
-        octo_buffer_drain(&aio->write_buffer, len);
+        octo_buffer_drain(&aio->write_buffer, result);
     }
 
     if(octo_buffer_size(&aio->write_buffer) == 0)
@@ -115,6 +130,71 @@ ssize_t octo_aio_write(octo_aio *aio, void *data, size_t len)
     return aio->write(aio->write_ctx, data, len);
 }
 
+ssize_t octo_aio_write_ref(octo_aio *aio, void *rawdata, size_t len,
+        octo_buffer_release_cb release, void *ctx)
+{
+    /*
+     * same as a direct write except what can't be written right away
+     * is buffered by reference, the memory is released once the last
+     * of it has been written out
+     */
+
+    assert((ssize_t)len != -1);
+
+    uint8_t *data = (uint8_t*)rawdata;
+    ssize_t result = 0;
+
+    if(aio->write != octo_aio_direct_write && aio->write != octo_aio_buffered_write)
+    {
+        /* a write function of the user's own doesn't know about
+         * references, hand it the memory like octo_aio_write would and
+         * release it once the writer is done with it */
+        result = aio->write(aio->write_ctx, data, len);
+        if(result != -1 && release != NULL)
+        {
+            release(ctx, data, len);
+        }
+        return result;
+    }
+
+    if(aio->write == octo_aio_direct_write)
+    {
+        result = write(aio->fd, data, len);
+
+        if(result == -1)
+        {
+            if(errno != EAGAIN)
+            {
+                perror("write");
+                return result;
+            }
+            result = 0;
+        }
+
+        if(result == len)
+        {
+            if(release != NULL)
+            {
+                release(ctx, data, len);
+            }
+            return result;
+        }
+
+        ev_io_start(aio->loop, &aio->write_watcher);
+        aio->write = octo_aio_buffered_write;
+    }
+
+    /* the buffer was empty if anything was written directly so draining
+     * what was written only skips the front of this reference */
+    if(octo_buffer_write_ref(&aio->write_buffer, data, len, release, ctx) != len)
+    {
+        return -1;
+    }
+    octo_buffer_drain(&aio->write_buffer, result);
+
+    return len;
+}
+
 ssize_t octo_aio_buffered_write(void *ctx, void *data, size_t len)
 {
     /*
@@ -151,8 +231,8 @@ ssize_t octo_aio_direct_write(void *ctx, void *rawdata, size_t len)
         {
             ev_io_start(aio->loop, &aio->write_watcher);
             aio->write = octo_aio_buffered_write;
+            /* may be less than len when the buffer is over budget */
             result = aio->write(aio, data, len);
-            assert(result == len);
             return result;
         }
         else
@@ -167,8 +247,7 @@ ssize_t octo_aio_direct_write(void *ctx, void *rawdata, size_t len)
         ev_io_start(aio->loop, &aio->write_watcher);
         aio->write = octo_aio_buffered_write;
         size_t bresult = aio->write(aio, &data[result], len - result);
-        assert(bresult == (len - result));
-        return len;
+        return result + bresult;
     }
 
     return result;
@@ -30,6 +30,11 @@
 
 #include "buffer.h"
 
+/**
+ * most buffered chunks handed to a single writev
+ */
+#define OCTO_AIO_IOVECS 16
+
 /**
  * octo_aio 
  *
@@ -63,11 +68,28 @@ void octo_aio_destroy(octo_aio *s);
 void octo_aio_start(octo_aio *s);
 void octo_aio_stop(octo_aio *s);
 ssize_t octo_aio_write(octo_aio *s, void *data, size_t len);
+
+/**
+ * write memory that must not be copied, such as a mapped file or a
+ * cached response. whatever can't be written immediately is buffered by
+ * reference and release is called once the memory is no longer needed.
+ *
+ * when the write function has been replaced the memory is handed to it
+ * like octo_aio_write does and released as soon as it returns.
+ *
+ * returns len, or -1 on error in which case release is not called. a
+ * replaced write function's result is returned as is.
+ */
+ssize_t octo_aio_write_ref(octo_aio *s, void *data, size_t len,
+        octo_buffer_release_cb release, void *ctx);
 void octo_aio_close(octo_aio *s);
 
 /**
  * buffered and direct write functions, the defaults but can be
  * changed as desired!
+ *
+ * both return less than len when the write buffer is attached to a
+ * budget that has run out.
  */
 ssize_t octo_aio_buffered_write(void *ctx, void *data, size_t len);
 ssize_t octo_aio_direct_write(void *ctx, void *data, size_t len);
@@ -23,8 +23,41 @@
 #ifndef OCTO_ARRAY_H
 #define OCTO_ARRAY_H
 
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#include "common.h"
+
+/**
+ * growable arrays specialized for an item type at compile time.
+ *
+ * OCTO_ARRAY_DEFINE(name, type, inline_capacity) defines an array type
+ * name of type items along with static inline functions name_init,
+ * name_destroy, name_size, name_capacity, name_data, name_at,
+ * name_reserve, name_push, name_pop, name_append, name_insert,
+ * name_remove, name_swap_remove, and name_clear.
+ *
+ * the first inline_capacity items, at least 1, are kept in the array
+ * struct itself so small arrays never allocate. past that the items move
+ * to the heap and the capacity doubles whenever it runs out, so pushes
+ * are amortized constant time. items are stored by value one after the
+ * other, nothing is allocated per item.
+ *
+ * pointers in to the array are only good until it next grows, and an
+ * array using its inline items must not be copied or moved by value.
+ *
+ * OCTO_ARRAY_DEFINE_SORTED(name, type, lt_fn) adds name_lower_bound and
+ * name_insert_sorted to an array already defined, keeping it ordered by
+ * lt_fn(const type *a, const type *b), which returns true if a comes
+ * before b and is called directly so it inlines. an item is inserted
+ * after any equal to it.
+ */
+
 /**
- * intrusive resizeable array
+ * size and capacity in items shared by every array type
  */
 typedef struct octo_array
 {
@@ -32,4 +65,234 @@ typedef struct octo_array
     size_t capacity;
 } octo_array;
 
+/**
+ * make room for at least capacity items, moving them from the inline
+ * items to the heap the first time
+ *
+ * returns false if no memory could be allocated or capacity items don't
+ * fit in memory at all, leaving the items as they were.
+ */
+static inline bool octo_array_grow(octo_array *array, void **items,
+        void *inline_items, size_t item_size, size_t capacity)
+{
+    size_t new_capacity = SIZE_MAX;
+    void *new_items;
+
+    if(capacity <= array->capacity)
+    {
+        return true;
+    }
+    if(capacity > SIZE_MAX/item_size)
+    {
+        return false;
+    }
+    if(array->capacity <= SIZE_MAX/2)
+    {
+        new_capacity = array->capacity*2;
+    }
+    if(new_capacity < capacity || new_capacity > SIZE_MAX/item_size)
+    {
+        new_capacity = capacity;
+    }
+
+    if(*items == inline_items)
+    {
+        new_items = malloc(new_capacity*item_size);
+        if(new_items != NULL)
+        {
+            memcpy(new_items, inline_items, array->size*item_size);
+        }
+    }
+    else
+    {
+        new_items = realloc(*items, new_capacity*item_size);
+    }
+
+    if(new_items == NULL)
+    {
+        return false;
+    }
+
+    *items = new_items;
+    array->capacity = new_capacity;
+    return true;
+}
+
+/**
+ * iterate over the items of an array with pos pointing to each in turn
+ */
+#define octo_array_foreach(pos, arr) \
+    for(pos = (arr)->items; pos < (arr)->items + (arr)->array.size; ++pos)
+
+#define OCTO_ARRAY_DEFINE(name, type, inline_capacity) \
+\
+typedef struct name \
+{ \
+    octo_array array; \
+    type *items; \
+    type inline_items[inline_capacity]; \
+} name; \
+\
+static inline void name##_init(name *arr) \
+{ \
+    arr->array.size = 0; \
+    arr->array.capacity = inline_capacity; \
+    arr->items = arr->inline_items; \
+} \
+\
+static inline void name##_destroy(name *arr) \
+{ \
+    if(arr->items != arr->inline_items) \
+    { \
+        free(arr->items); \
+    } \
+    name##_init(arr); \
+} \
+\
+static inline size_t name##_size(const name *arr) \
+{ \
+    return arr->array.size; \
+} \
+\
+static inline size_t name##_capacity(const name *arr) \
+{ \
+    return arr->array.capacity; \
+} \
+\
+static inline type * name##_data(name *arr) \
+{ \
+    return arr->items; \
+} \
+\
+static inline type * name##_at(name *arr, size_t i) \
+{ \
+    assert(i < arr->array.size); \
+    return &arr->items[i]; \
+} \
+\
+static inline bool name##_reserve(name *arr, size_t capacity) \
+{ \
+    return octo_array_grow(&arr->array, (void **)&arr->items, \
+        arr->inline_items, sizeof(type), capacity); \
+} \
+\
+static inline bool name##_push(name *arr, type item) \
+{ \
+    if(arr->array.size == arr->array.capacity \
+            && !name##_reserve(arr, arr->array.size + 1)) \
+    { \
+        return false; \
+    } \
+    arr->items[arr->array.size] = item; \
+    arr->array.size += 1; \
+    return true; \
+} \
+\
+static inline bool name##_pop(name *arr, type *item) \
+{ \
+    if(arr->array.size == 0) \
+    { \
+        return false; \
+    } \
+    arr->array.size -= 1; \
+    *item = arr->items[arr->array.size]; \
+    return true; \
+} \
+\
+static inline bool name##_append(name *arr, const type *items, size_t n) \
+{ \
+    /* items may be the array's own, found again once it has grown */ \
+    uintptr_t from = (uintptr_t)items; \
+    uintptr_t start = (uintptr_t)arr->items; \
+    bool own = from >= start && from < start + arr->array.size*sizeof(type); \
+    size_t offset = (from - start)/sizeof(type); \
+    if(n > SIZE_MAX - arr->array.size \
+            || !name##_reserve(arr, arr->array.size + n)) \
+    { \
+        return false; \
+    } \
+    if(own) \
+    { \
+        items = &arr->items[offset]; \
+    } \
+    memcpy(&arr->items[arr->array.size], items, n*sizeof(type)); \
+    arr->array.size += n; \
+    return true; \
+} \
+\
+static inline bool name##_insert(name *arr, size_t i, type item) \
+{ \
+    assert(i <= arr->array.size); \
+    if(arr->array.size == arr->array.capacity \
+            && !name##_reserve(arr, arr->array.size + 1)) \
+    { \
+        return false; \
+    } \
+    memmove(&arr->items[i + 1], &arr->items[i], \
+        (arr->array.size - i)*sizeof(type)); \
+    arr->items[i] = item; \
+    arr->array.size += 1; \
+    return true; \
+} \
+\
+static inline void name##_remove(name *arr, size_t i) \
+{ \
+    assert(i < arr->array.size); \
+    arr->array.size -= 1; \
+    memmove(&arr->items[i], &arr->items[i + 1], \
+        (arr->array.size - i)*sizeof(type)); \
+} \
+\
+static inline void name##_swap_remove(name *arr, size_t i) \
+{ \
+    assert(i < arr->array.size); \
+    arr->array.size -= 1; \
+    arr->items[i] = arr->items[arr->array.size]; \
+} \
+\
+static inline void name##_clear(name *arr) \
+{ \
+    arr->array.size = 0; \
+}
+
+#define OCTO_ARRAY_DEFINE_SORTED(name, type, lt_fn) \
+\
+static inline size_t name##_lower_bound(const name *arr, const type *item) \
+{ \
+    size_t lo = 0; \
+    size_t hi = arr->array.size; \
+    while(lo < hi) \
+    { \
+        size_t mid = lo + (hi - lo)/2; \
+        if(lt_fn(&arr->items[mid], item)) \
+        { \
+            lo = mid + 1; \
+        } \
+        else \
+        { \
+            hi = mid; \
+        } \
+    } \
+    return lo; \
+} \
+\
+static inline bool name##_insert_sorted(name *arr, type item) \
+{ \
+    size_t lo = 0; \
+    size_t hi = arr->array.size; \
+    while(lo < hi) \
+    { \
+        size_t mid = lo + (hi - lo)/2; \
+        if(lt_fn(&item, &arr->items[mid])) \
+        { \
+            hi = mid; \
+        } \
+        else \
+        { \
+            lo = mid + 1; \
+        } \
+    } \
+    return name##_insert(arr, lo, item); \
+}
+
 #endif
@@ -20,10 +20,14 @@
  * THE SOFTWARE.
  */
 
+#define _GNU_SOURCE
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 
 #include "buffer.h"
 
@@ -59,6 +63,43 @@ static inline octo_buffer_chunk * octo_buffer_chunk_alloc(size_t len)
     item->start = 0;
     item->size = 0;
     item->capacity = len;
+    item->data = item->storage;
+    item->release = NULL;
+    item->release_ctx = NULL;
+    item->fd = -1;
+    item->file_offset = 0;
+
+    return item;
+}
+
+/**
+ * alloc a buffer item referencing external memory rather than its
+ * own storage.
+ *
+ * the item is always full so writes never land in external memory.
+ * start is where the referenced bytes begin within data.
+ */
+static inline octo_buffer_chunk * octo_buffer_chunk_ref(uint8_t *data,
+        size_t start, size_t len, octo_buffer_release_cb release, void *ctx)
+{
+    octo_buffer_chunk *item;
+
+    item = malloc(sizeof(octo_buffer_chunk));
+
+    if(item == NULL)
+    {
+        perror("malloc");
+        return NULL;
+    }
+
+    item->start = start;
+    item->size = len;
+    item->capacity = start + len;
+    item->data = data;
+    item->release = release;
+    item->release_ctx = ctx;
+    item->fd = -1;
+    item->file_offset = 0;
 
     return item;
 }
@@ -71,9 +112,127 @@ static inline octo_buffer_chunk * octo_buffer_chunk_alloc(size_t len)
 static inline void octo_buffer_chunk_free(octo_buffer_chunk *item)
 {
     octo_list_remove(&item->list);
+    if(item->release != NULL)
+    {
+        item->release(item->release_ctx, item->data, item->capacity);
+    }
     free(item);
 }
 
+/**
+ * add len bytes to the memory used by a budget and its parents
+ */
+static inline void octo_buffer_budget_charge(octo_buffer_budget *budget, size_t len)
+{
+    while(budget != NULL)
+    {
+        __atomic_add_fetch(&budget->used, len, __ATOMIC_RELAXED);
+        budget = budget->parent;
+    }
+}
+
+/**
+ * remove len bytes from the memory used by a budget and its parents
+ */
+static inline void octo_buffer_budget_uncharge(octo_buffer_budget *budget, size_t len)
+{
+    while(budget != NULL)
+    {
+        __atomic_sub_fetch(&budget->used, len, __ATOMIC_RELAXED);
+        budget = budget->parent;
+    }
+}
+
+/**
+ * reserve between least and most bytes from a budget and its parents
+ *
+ * every budget up the chain takes what it can of the bytes its child got
+ * with a compare and swap of used, and gives back what its parents didn't
+ * take, so buffers on different threads sharing a parent can't both
+ * squeeze through the same bytes of it.
+ *
+ * returns the bytes reserved, 0 if fewer than least were left.
+ */
+static size_t octo_buffer_budget_reserve(octo_buffer_budget *budget, size_t least, size_t most)
+{
+    size_t used;
+    size_t take;
+    size_t got;
+
+    if(budget == NULL)
+    {
+        return most;
+    }
+
+    used = __atomic_load_n(&budget->used, __ATOMIC_RELAXED);
+    do
+    {
+        take = most;
+        if(budget->limit != 0)
+        {
+            take = used >= budget->limit ? 0 : min(most, budget->limit - used);
+        }
+        if(take == 0 || take < least)
+        {
+            return 0;
+        }
+    } while(!__atomic_compare_exchange_n(&budget->used, &used, used + take, true,
+        __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    got = octo_buffer_budget_reserve(budget->parent, least, take);
+    if(got < take)
+    {
+        __atomic_sub_fetch(&budget->used, take - got, __ATOMIC_RELAXED);
+    }
+    return got;
+}
+
+/**
+ * the innermost budget that has less than len bytes left, NULL if none
+ */
+static inline octo_buffer_budget * octo_buffer_budget_short(octo_buffer_budget *budget, size_t len)
+{
+    while(budget != NULL)
+    {
+        size_t used = __atomic_load_n(&budget->used, __ATOMIC_RELAXED);
+        if(budget->limit != 0 && (used >= budget->limit || budget->limit - used < len))
+        {
+            return budget;
+        }
+        budget = budget->parent;
+    }
+    return NULL;
+}
+
+/**
+ * chunk memory owned by the buffer, external memory isn't counted
+ */
+static inline size_t octo_buffer_chunk_owned(octo_buffer_chunk *item)
+{
+    if(item->data == item->storage)
+    {
+        return item->capacity;
+    }
+    return 0;
+}
+
+/**
+ * free a chunk of a buffer, returning its memory to the budget
+ */
+static inline void octo_buffer_free_chunk(octo_buffer *b, octo_buffer_chunk *item)
+{
+    octo_buffer_budget_uncharge(b->budget, octo_buffer_chunk_owned(item));
+    octo_buffer_chunk_free(item);
+}
+
+/**
+ * release callback for chunks created by octo_buffer_write_file
+ */
+static void octo_buffer_munmap(void *ctx, void *data, size_t len)
+{
+    munmap(data, len);
+}
+
 /**
  * item bytes used
  */
@@ -98,6 +257,230 @@ static inline size_t octo_buffer_chunk_remaining(octo_buffer_chunk *item)
     return item->capacity - (item->size + item->start);
 }
 
+/**
+ * copy len bytes from the start of an item, reading them back from disk
+ * if the item was spilled.
+ *
+ * return the number of bytes copied, short only if reading the file fails.
+ */
+static inline size_t octo_buffer_chunk_copy(octo_buffer_chunk *item, uint8_t *data, size_t len)
+{
+    ssize_t result;
+
+    if(item->fd == -1)
+    {
+        memcpy(data, &item->data[item->start], len);
+        return len;
+    }
+
+    result = pread(item->fd, data, len, item->file_offset + item->start);
+    if(result == -1)
+    {
+        perror("pread");
+        return 0;
+    }
+    return result;
+}
+
+/**
+ * alloc the next chunk for a write with len bytes left to copy and push
+ * it on to the head of the buffer, the chunk holds at least least bytes.
+ *
+ * a chunk is big enough for the rest of the write when the max chunk size
+ * allows, and every chunk allocated doubles the size of the next one.
+ *
+ * with a budget the chunk shrinks to what can be reserved of it, when
+ * that isn't enough for the write the exhausted callback of every budget
+ * short on memory gets one chance to free some first.
+ */
+static inline octo_buffer_chunk * octo_buffer_grow(octo_buffer *b, size_t len, size_t least)
+{
+    octo_buffer_chunk *item;
+    octo_buffer_budget *budget;
+    size_t chunk_size = max(least, max(b->chunk_size, min(len, b->chunk_max)));
+
+    if(b->budget != NULL)
+    {
+        budget = octo_buffer_budget_short(b->budget, min(len, chunk_size));
+        while(budget != NULL)
+        {
+            if(budget->exhausted != NULL)
+            {
+                budget->exhausted(budget->exhausted_ctx, budget, min(len, chunk_size));
+            }
+            budget = octo_buffer_budget_short(budget->parent, min(len, chunk_size));
+        }
+
+        chunk_size = octo_buffer_budget_reserve(b->budget, least, chunk_size);
+        if(chunk_size == 0)
+        {
+            return NULL;
+        }
+    }
+
+    item = octo_buffer_chunk_alloc(chunk_size);
+    if(item == NULL)
+    {
+        octo_buffer_budget_uncharge(b->budget, chunk_size);
+        return NULL;
+    }
+    octo_list_push(&b->buffer_list, &item->list);
+
+    if(b->chunk_size < b->chunk_max)
+    {
+        b->chunk_size = min(b->chunk_size*2, b->chunk_max);
+    }
+
+    return item;
+}
+
+/**
+ * true while the contents of the buffer live in its inline storage
+ */
+static inline bool octo_buffer_is_inline(const octo_buffer *b)
+{
+    return b->buffer_list.next == &b->buffer_list;
+}
+
+/**
+ * copy at most len bytes out of inline storage, return bytes copied
+ */
+static inline size_t octo_buffer_inline_peek(octo_buffer *b, uint8_t *data, size_t len)
+{
+    size_t copylen = min(len, b->size);
+    memcpy(data, &b->inline_data[b->inline_start], copylen);
+    return copylen;
+}
+
+/**
+ * remove at most len bytes from inline storage, return bytes removed
+ */
+static inline size_t octo_buffer_inline_drain(octo_buffer *b, size_t len)
+{
+    size_t drainlen = min(len, b->size);
+    b->inline_start += drainlen;
+    b->size -= drainlen;
+    if(b->size == 0)
+    {
+        b->inline_start = 0;
+    }
+    return drainlen;
+}
+
+/**
+ * move inline contents in to a chunk with room for len more bytes, the
+ * chunk may have less room than that under a budget but always holds the
+ * inline contents
+ */
+static inline octo_buffer_chunk * octo_buffer_inline_flush(octo_buffer *b, size_t len)
+{
+    octo_buffer_chunk *item = octo_buffer_grow(b, b->size + len, max(b->size, 1));
+    if(item == NULL)
+    {
+        return NULL;
+    }
+
+    memcpy(item->data, &b->inline_data[b->inline_start], b->size);
+    item->size = b->size;
+    b->inline_start = 0;
+
+    return item;
+}
+
+/**
+ * remove len bytes from the start of an item, freeing it once empty
+ */
+static inline void octo_buffer_consume(octo_buffer *b, octo_buffer_chunk *item, size_t len)
+{
+    item->start += len;
+    item->size -= len;
+
+    if(item->fd != -1)
+    {
+        b->spilled -= len;
+    }
+
+    if(octo_buffer_chunk_size(item) == 0)
+    {
+        octo_buffer_free_chunk(b, item);
+    }
+}
+
+/**
+ * write an item out to the spill file and put a chunk referencing the
+ * file in its place.
+ */
+static bool octo_buffer_spill_chunk(octo_buffer *b, octo_buffer_chunk *item)
+{
+    octo_buffer_chunk *spilled;
+    size_t written = 0;
+    ssize_t result;
+
+    /* nothing on disk is still readable, start the file over */
+    if(b->spilled == 0 && b->spill_end != 0)
+    {
+        if(ftruncate(b->spill_fd, 0) == 0)
+        {
+            b->spill_end = 0;
+        }
+    }
+
+    spilled = octo_buffer_chunk_ref(NULL, 0, item->size, NULL, NULL);
+    if(spilled == NULL)
+    {
+        return false;
+    }
+
+    while(written < item->size)
+    {
+        result = pwrite(b->spill_fd, &item->data[item->start + written],
+            item->size - written, b->spill_end + written);
+        if(result == -1)
+        {
+            perror("pwrite");
+            free(spilled);
+            return false;
+        }
+        written += result;
+    }
+
+    spilled->fd = b->spill_fd;
+    spilled->file_offset = b->spill_end;
+    b->spill_end += item->size;
+    b->spilled += item->size;
+
+    /* the spilled chunk takes the place of the item in the list */
+    octo_list_add(&item->list, &spilled->list);
+    octo_buffer_free_chunk(b, item);
+
+    return true;
+}
+
+/**
+ * spill the oldest chunks in memory until no more than the threshold is,
+ * the newest chunk is left alone as it is still being written to.
+ */
+static void octo_buffer_spill_oldest(octo_buffer *b)
+{
+    octo_list *head = octo_list_head(&b->buffer_list);
+    octo_list *tail = octo_list_tail(&b->buffer_list);
+    octo_list *prev;
+
+    while(b->size - b->spilled > b->spill_threshold && tail != head)
+    {
+        octo_buffer_chunk *item = ptr_offset(tail, octo_buffer_chunk, list);
+        prev = tail->prev;
+
+        if(item->fd == -1 && octo_buffer_chunk_owned(item) > 0
+            && !octo_buffer_spill_chunk(b, item))
+        {
+            return;
+        }
+
+        tail = prev;
+    }
+}
+
 void octo_buffer_init(octo_buffer *b, size_t chunk_size)
 {
     octo_list_init(&b->buffer_list);
@@ -109,7 +492,278 @@ void octo_buffer_init(octo_buffer *b, size_t chunk_size)
     {
         b->chunk_size = DEFAULT_CHUNK_SIZE;
     }
+    b->chunk_base = b->chunk_size;
+    b->chunk_max = max(b->chunk_size, OCTO_BUFFER_CHUNK_MAX);
     b->size = 0;
+    b->activity = 0;
+    b->inline_start = 0;
+    b->budget = NULL;
+    octo_list_init(&b->budget_list);
+    b->spill_threshold = 0;
+    b->spilled = 0;
+    b->spill_fd = -1;
+    b->spill_end = 0;
+}
+
+bool octo_buffer_set_spill(octo_buffer *b, size_t threshold, const char *dir)
+{
+    char path[4096];
+
+    if(dir == NULL)
+    {
+        dir = P_tmpdir;
+    }
+
+    if(b->spill_fd == -1 && threshold > 0)
+    {
+        b->spill_fd = open(dir, O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+
+        /* not every filesystem has O_TMPFILE, unlink a named file instead */
+        if(b->spill_fd == -1)
+        {
+            snprintf(path, sizeof(path), "%s/octo_buffer.XXXXXX", dir);
+            b->spill_fd = mkostemp(path, O_CLOEXEC);
+            if(b->spill_fd == -1)
+            {
+                perror("mkostemp");
+                return false;
+            }
+            unlink(path);
+        }
+    }
+
+    b->spill_threshold = threshold;
+    return true;
+}
+
+void octo_buffer_set_chunk_max(octo_buffer *b, size_t chunk_max)
+{
+    b->chunk_max = max(b->chunk_size, chunk_max);
+}
+
+void octo_buffer_hint(octo_buffer *b, size_t len)
+{
+    if(len > 0)
+    {
+        b->chunk_size = max(b->chunk_size, min(len, b->chunk_max));
+    }
+}
+
+/**
+ * chunk memory owned by a buffer
+ */
+static size_t octo_buffer_owned(octo_buffer *b)
+{
+    octo_buffer_chunk *pos;
+    octo_buffer_chunk *next;
+    size_t owned = 0;
+
+    octo_list_foreach(pos, next, &b->buffer_list, list)
+    {
+        owned += octo_buffer_chunk_owned(pos);
+    }
+
+    return owned;
+}
+
+void octo_buffer_attach(octo_buffer *b, octo_buffer_budget *budget)
+{
+    octo_buffer_detach(b);
+
+    b->budget = budget;
+    octo_list_append(&budget->buffers, &b->budget_list);
+    octo_buffer_budget_charge(budget, octo_buffer_owned(b));
+}
+
+void octo_buffer_detach(octo_buffer *b)
+{
+    if(b->budget == NULL)
+    {
+        return;
+    }
+
+    octo_buffer_budget_uncharge(b->budget, octo_buffer_owned(b));
+    octo_list_remove(&b->budget_list);
+    b->budget = NULL;
+}
+
+void octo_buffer_budget_init(octo_buffer_budget *budget,
+        octo_buffer_budget *parent, size_t limit)
+{
+    budget->parent = parent;
+    budget->limit = limit;
+    budget->used = 0;
+    budget->exhausted = NULL;
+    budget->exhausted_ctx = NULL;
+    octo_list_init(&budget->buffers);
+    octo_list_init(&budget->children);
+    octo_list_init(&budget->child_list);
+
+    if(parent != NULL)
+    {
+        octo_list_append(&parent->children, &budget->child_list);
+    }
+}
+
+void octo_buffer_budget_destroy(octo_buffer_budget *budget)
+{
+    octo_buffer *pos;
+    octo_buffer *next;
+    octo_buffer_budget *child;
+    octo_buffer_budget *nchild;
+
+    octo_list_foreach(pos, next, &budget->buffers, budget_list)
+    {
+        octo_buffer_detach(pos);
+    }
+
+    octo_list_foreach(child, nchild, &budget->children, child_list)
+    {
+        octo_buffer_budget_uncharge(budget, child->used);
+        octo_list_remove(&child->child_list);
+        child->parent = NULL;
+    }
+
+    octo_list_remove(&budget->child_list);
+    octo_buffer_budget_uncharge(budget->parent, budget->used);
+    budget->parent = NULL;
+    budget->used = 0;
+}
+
+void octo_buffer_budget_set_cb(octo_buffer_budget *budget,
+        octo_buffer_budget_cb exhausted, void *ctx)
+{
+    budget->exhausted = exhausted;
+    budget->exhausted_ctx = ctx;
+}
+
+size_t octo_buffer_budget_used(const octo_buffer_budget *budget)
+{
+    return __atomic_load_n(&budget->used, __ATOMIC_RELAXED);
+}
+
+size_t octo_buffer_budget_available(const octo_buffer_budget *budget)
+{
+    size_t available = SIZE_MAX;
+
+    while(budget != NULL)
+    {
+        size_t used = octo_buffer_budget_used(budget);
+        if(budget->limit != 0)
+        {
+            available = min(available, used < budget->limit ? budget->limit - used : 0);
+        }
+        budget = budget->parent;
+    }
+
+    return available;
+}
+
+octo_buffer * octo_buffer_budget_largest(octo_buffer_budget *budget)
+{
+    octo_buffer *pos;
+    octo_buffer *next;
+    octo_buffer *largest = NULL;
+    octo_buffer_budget *child;
+    octo_buffer_budget *nchild;
+
+    octo_list_foreach(pos, next, &budget->buffers, budget_list)
+    {
+        if(largest == NULL || octo_buffer_size(pos) > octo_buffer_size(largest))
+        {
+            largest = pos;
+        }
+    }
+
+    octo_list_foreach(child, nchild, &budget->children, child_list)
+    {
+        pos = octo_buffer_budget_largest(child);
+        if(pos != NULL && (largest == NULL || octo_buffer_size(pos) > octo_buffer_size(largest)))
+        {
+            largest = pos;
+        }
+    }
+
+    return largest;
+}
+
+octo_buffer_budget * octo_buffer_budget_largest_child(octo_buffer_budget *budget)
+{
+    octo_buffer_budget *child;
+    octo_buffer_budget *next;
+    octo_buffer_budget *largest = NULL;
+
+    octo_list_foreach(child, next, &budget->children, child_list)
+    {
+        if(largest == NULL || octo_buffer_budget_used(child) > octo_buffer_budget_used(largest))
+        {
+            largest = child;
+        }
+    }
+
+    return largest;
+}
+
+size_t octo_buffer_trim(octo_buffer *b)
+{
+    octo_buffer_chunk *pos;
+    octo_buffer_chunk *next;
+    octo_buffer_chunk *item;
+    uint8_t residual[OCTO_BUFFER_INLINE_SIZE];
+    size_t released = 0;
+
+    b->chunk_size = b->chunk_base;
+
+    if(octo_buffer_is_inline(b))
+    {
+        return released;
+    }
+
+    /* few enough bytes left to keep them inline */
+    if(b->size <= OCTO_BUFFER_INLINE_SIZE)
+    {
+        if(octo_buffer_peek(b, residual, b->size) != b->size)
+        {
+            return released;
+        }
+
+        released = octo_buffer_owned(b);
+        octo_list_foreach(pos, next, &b->buffer_list, list)
+        {
+            octo_buffer_free_chunk(b, pos);
+        }
+
+        memcpy(b->inline_data, residual, b->size);
+        b->inline_start = 0;
+        b->spilled = 0;
+        return released;
+    }
+
+    /* shrink chunks that are mostly slack to fit their contents */
+    octo_list_foreach(pos, next, &b->buffer_list, list)
+    {
+        if(octo_buffer_chunk_owned(pos) == 0
+            || octo_buffer_chunk_size(pos) >= octo_buffer_chunk_capacity(pos)/2)
+        {
+            continue;
+        }
+
+        item = octo_buffer_chunk_alloc(octo_buffer_chunk_size(pos));
+        if(item == NULL)
+        {
+            break;
+        }
+
+        memcpy(item->data, &pos->data[pos->start], pos->size);
+        item->size = pos->size;
+        released += octo_buffer_chunk_capacity(pos) - octo_buffer_chunk_capacity(item);
+
+        octo_list_add(&pos->list, &item->list);
+        octo_buffer_free_chunk(b, pos);
+        octo_buffer_budget_charge(b->budget, octo_buffer_chunk_capacity(item));
+    }
+
+    return released;
 }
 
 void octo_buffer_destroy(octo_buffer *b)
@@ -119,11 +773,22 @@ void octo_buffer_destroy(octo_buffer *b)
 
     octo_list_foreach(pos, next, &b->buffer_list, list)
     {
-        octo_buffer_chunk_free(pos);
+        octo_buffer_free_chunk(b, pos);
     }
 
+    octo_buffer_detach(b);
     octo_list_destroy(&b->buffer_list);
     b->size = 0;
+    b->inline_start = 0;
+
+    if(b->spill_fd != -1)
+    {
+        close(b->spill_fd);
+        b->spill_fd = -1;
+    }
+    b->spill_threshold = 0;
+    b->spilled = 0;
+    b->spill_end = 0;
 }
 
 size_t octo_buffer_size(const octo_buffer *b)
@@ -131,26 +796,73 @@ size_t octo_buffer_size(const octo_buffer *b)
     return b->size;
 }
 
+size_t octo_buffer_activity(const octo_buffer *b)
+{
+    return b->activity;
+}
+
+size_t octo_buffer_chunks(const octo_buffer *b)
+{
+    return octo_list_size(&b->buffer_list);
+}
+
+void octo_buffer_get_stats(const octo_buffer *b, octo_buffer_stats *stats)
+{
+    octo_list *pos = b->buffer_list.next;
+    size_t used = 0;
+
+    stats->size = b->size;
+    stats->chunks = 0;
+    stats->capacity = 0;
+
+    while(pos != &b->buffer_list)
+    {
+        octo_buffer_chunk *item = ptr_offset(pos, octo_buffer_chunk, list);
+        stats->chunks += 1;
+        if(item->fd == -1)
+        {
+            stats->capacity += octo_buffer_chunk_capacity(item);
+            used += octo_buffer_chunk_size(item);
+        }
+        pos = pos->next;
+    }
+
+    stats->slack = stats->capacity - used;
+    stats->spilled = b->spilled;
+}
+
 size_t octo_buffer_write(octo_buffer *b, void *rawdata, size_t len)
 {
     uint8_t *data = (uint8_t *)rawdata;
     size_t copylen = 0;
     size_t copied = 0;
     octo_buffer_chunk *item = NULL;
-    octo_list *head = octo_list_head(&b->buffer_list);
 
-    if(head != &b->buffer_list)
-    {
-        item = ptr_offset(head, octo_buffer_chunk, list);
-    }
-    else
+    b->activity += 1;
+
+    if(octo_buffer_is_inline(b))
     {
-        item = octo_buffer_chunk_alloc(b->chunk_size);
+        if(b->size + len <= OCTO_BUFFER_INLINE_SIZE)
+        {
+            if(b->inline_start + b->size + len > OCTO_BUFFER_INLINE_SIZE)
+            {
+                memmove(b->inline_data, &b->inline_data[b->inline_start], b->size);
+                b->inline_start = 0;
+            }
+            memcpy(&b->inline_data[b->inline_start + b->size], data, len);
+            b->size += len;
+            return len;
+        }
+
+        item = octo_buffer_inline_flush(b, len);
         if(item == NULL)
         {
             return copied;
         }
-        octo_list_push(&b->buffer_list, &item->list);
+    }
+    else
+    {
+        item = ptr_offset(octo_list_head(&b->buffer_list), octo_buffer_chunk, list);
     }
 
     while(copied < len)
@@ -166,24 +878,108 @@ size_t octo_buffer_write(octo_buffer *b, void *rawdata, size_t len)
 
         if(copied < len)
         {
-            item = octo_buffer_chunk_alloc(b->chunk_size);
+            item = octo_buffer_grow(b, len-copied, 1);
             if(item == NULL)
             {
-                return copied;
+                break;
             }
-            octo_list_push(&b->buffer_list, &item->list);
         }
     }
 
     b->size += copied;
+
+    if(b->spill_threshold > 0)
+    {
+        octo_buffer_spill_oldest(b);
+    }
+
     return copied;
 }
 
+size_t octo_buffer_write_ref(octo_buffer *b, void *data, size_t len,
+        octo_buffer_release_cb release, void *ctx)
+{
+    octo_buffer_chunk *item = NULL;
+
+    b->activity += 1;
+
+    if(len == 0)
+    {
+        return 0;
+    }
+
+    if(octo_buffer_is_inline(b) && b->size > 0 && octo_buffer_inline_flush(b, 0) == NULL)
+    {
+        return 0;
+    }
+
+    item = octo_buffer_chunk_ref((uint8_t *)data, 0, len, release, ctx);
+    if(item == NULL)
+    {
+        return 0;
+    }
+    octo_list_push(&b->buffer_list, &item->list);
+
+    b->size += len;
+    return len;
+}
+
+size_t octo_buffer_write_file(octo_buffer *b, int fd, off_t offset, size_t len)
+{
+    octo_buffer_chunk *item = NULL;
+    off_t page = sysconf(_SC_PAGESIZE);
+    off_t aligned = offset & ~(page - 1);
+    size_t start = offset - aligned;
+    void *map;
+
+    b->activity += 1;
+
+    if(len == 0)
+    {
+        return 0;
+    }
+
+    if(octo_buffer_is_inline(b) && b->size > 0 && octo_buffer_inline_flush(b, 0) == NULL)
+    {
+        return 0;
+    }
+
+    /* mmap offsets must be page aligned, the chunk start skips the
+     * leading bytes of the page that were not asked for */
+    map = mmap(NULL, start + len, PROT_READ, MAP_SHARED, fd, aligned);
+    if(map == MAP_FAILED)
+    {
+        perror("mmap");
+        return 0;
+    }
+
+    item = octo_buffer_chunk_ref((uint8_t *)map, start, len,
+            octo_buffer_munmap, NULL);
+    if(item == NULL)
+    {
+        munmap(map, start + len);
+        return 0;
+    }
+    octo_list_push(&b->buffer_list, &item->list);
+
+    b->size += len;
+    return len;
+}
+
 size_t octo_buffer_read(octo_buffer *b, void *rawdata, size_t len)
 {
     uint8_t *data = (uint8_t *)rawdata;
     size_t copied = 0;
     size_t copylen = 0;
+    size_t wanted = 0;
+
+    b->activity += 1;
+
+    if(octo_buffer_is_inline(b))
+    {
+        copied = octo_buffer_inline_peek(b, data, len);
+        return octo_buffer_inline_drain(b, copied);
+    }
 
     while(copied < len)
     {
@@ -195,16 +991,15 @@ size_t octo_buffer_read(octo_buffer *b, void *rawdata, size_t len)
         }
 
         octo_buffer_chunk *item = ptr_offset(tail, octo_buffer_chunk, list);
-        copylen = min(len-copied, octo_buffer_chunk_size(item));
-        memcpy(&data[copied], &item->data[item->start], copylen);
+        wanted = min(len-copied, octo_buffer_chunk_size(item));
+        copylen = octo_buffer_chunk_copy(item, &data[copied], wanted);
         copied += copylen;
 
-        item->start += copylen;
-        item->size -= copylen;
+        octo_buffer_consume(b, item, copylen);
 
-        if(octo_buffer_chunk_size(item) == 0)
+        if(copylen < wanted)
         {
-            octo_buffer_chunk_free(item);
+            break;
         }
     }
 
@@ -217,37 +1012,91 @@ size_t octo_buffer_peek(octo_buffer *b, void *rawdata, size_t len)
     uint8_t *data = (uint8_t *)rawdata;
     size_t copied = 0;
     size_t copylen = 0;
+    size_t wanted = 0;
 
-    octo_list *tail = octo_list_tail(&b->buffer_list);
-    octo_buffer_chunk *item = ptr_offset(tail, octo_buffer_chunk, list);
-
-    if(tail == &b->buffer_list)
+    if(octo_buffer_is_inline(b))
     {
-        return 0;
+        return octo_buffer_inline_peek(b, data, len);
     }
 
-    while(copied < len)
+    octo_list *tail = octo_list_tail(&b->buffer_list);
+
+    while(copied < len && tail != &b->buffer_list)
     {
-        copylen = min(len-copied, octo_buffer_chunk_size(item));
-        memcpy(&data[copied], &item->data[item->start], copylen);
+        octo_buffer_chunk *item = ptr_offset(tail, octo_buffer_chunk, list);
+        wanted = min(len-copied, octo_buffer_chunk_size(item));
+        copylen = octo_buffer_chunk_copy(item, &data[copied], wanted);
         copied += copylen;
 
-        if(copied >= octo_buffer_chunk_size(item))
+        if(copylen < wanted)
         {
-            tail = tail->prev;
-            if(tail != &b->buffer_list)
-            {
-                item = ptr_offset(tail, octo_buffer_chunk, list);
-            }
-            else
-            {
-                return copied;
-            }
+            break;
         }
+
+        tail = tail->prev;
     }
 
     return copied;
+}
+
+size_t octo_buffer_peekv(octo_buffer *b, struct iovec *iov, size_t iovcnt)
+{
+    size_t filled = 0;
+    octo_list *tail = octo_list_tail(&b->buffer_list);
+
+    if(octo_buffer_is_inline(b))
+    {
+        if(iovcnt == 0 || b->size == 0)
+        {
+            return 0;
+        }
+        iov[0].iov_base = &b->inline_data[b->inline_start];
+        iov[0].iov_len = b->size;
+        return 1;
+    }
+
+    while(filled < iovcnt && tail != &b->buffer_list)
+    {
+        octo_buffer_chunk *item = ptr_offset(tail, octo_buffer_chunk, list);
 
+        if(item->fd != -1)
+        {
+            break;
+        }
+
+        if(octo_buffer_chunk_size(item) > 0)
+        {
+            iov[filled].iov_base = &item->data[item->start];
+            iov[filled].iov_len = octo_buffer_chunk_size(item);
+            filled += 1;
+        }
+
+        tail = tail->prev;
+    }
+
+    return filled;
+}
+
+bool octo_buffer_peekfile(octo_buffer *b, int *fd, off_t *offset, size_t *len)
+{
+    octo_list *tail = octo_list_tail(&b->buffer_list);
+    octo_buffer_chunk *item;
+
+    if(tail == &b->buffer_list)
+    {
+        return false;
+    }
+
+    item = ptr_offset(tail, octo_buffer_chunk, list);
+    if(item->fd == -1)
+    {
+        return false;
+    }
+
+    *fd = item->fd;
+    *offset = item->file_offset + item->start;
+    *len = octo_buffer_chunk_size(item);
+    return true;
 }
 
 size_t octo_buffer_drain(octo_buffer *b, size_t len)
@@ -255,6 +1104,13 @@ size_t octo_buffer_drain(octo_buffer *b, size_t len)
     size_t drained = 0;
     size_t drainlen = 0;
 
+    b->activity += 1;
+
+    if(octo_buffer_is_inline(b))
+    {
+        return octo_buffer_inline_drain(b, len);
+    }
+
     while(drained < len)
     {
         octo_list *tail = octo_list_tail(&b->buffer_list);
@@ -268,13 +1124,7 @@ size_t octo_buffer_drain(octo_buffer *b, size_t len)
         drainlen = min(len-drained, octo_buffer_chunk_size(item));
         drained += drainlen;
 
-        item->start += drainlen;
-        item->size -= drainlen;
-
-        if(octo_buffer_chunk_size(item) == 0)
-        {
-            octo_buffer_chunk_free(item);
-        }
+        octo_buffer_consume(b, item, drainlen);
     }
 
     b->size -= drained;
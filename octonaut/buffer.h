@@ -26,10 +26,26 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
 #include "list.h"
 
+/**
+ * called once a buffer no longer references a chunk of external memory
+ *
+ * data and len are the region originally handed to the buffer.
+ */
+typedef void (*octo_buffer_release_cb)(void *ctx, void *data, size_t len);
+
 /**
  * fast read/write buffer for network IO
+ *
+ * a chunk either owns its storage (data points at storage) or references
+ * external memory such as an mmap'd file region, in which case release is
+ * called when the chunk is freed.
+ *
+ * a chunk spilled to disk has no data, its bytes are in the spill file
+ * fd starting at file_offset.
  */
 typedef struct octo_buffer_chunk
 {
@@ -37,17 +53,110 @@ typedef struct octo_buffer_chunk
     size_t start;
     size_t size;
     size_t capacity;
-    uint8_t data[];
+    uint8_t *data;
+    octo_buffer_release_cb release;
+    void *release_ctx;
+    int fd;
+    off_t file_offset;
+    uint8_t storage[];
 } octo_buffer_chunk;
 
+/**
+ * largest chunk a buffer grows to by default
+ */
+#define OCTO_BUFFER_CHUNK_MAX 65536
+
+/**
+ * bytes stored inside the buffer itself before any chunk is allocated
+ */
+#ifndef OCTO_BUFFER_INLINE_SIZE
+#define OCTO_BUFFER_INLINE_SIZE 32
+#endif
+
+typedef struct octo_buffer_budget octo_buffer_budget;
+
+/**
+ * chunks start at chunk_size bytes and double with each new chunk up to
+ * chunk_max bytes so large payloads don't turn in to long lists of small
+ * allocations while small buffers stay small.
+ *
+ * while the buffer has no chunks its contents live in inline_data starting
+ * at inline_start, small buffers such as header fields never allocate.
+ * the first write that doesn't fit moves them in to a chunk.
+ *
+ * a buffer attached to a budget only grows while the budget allows it.
+ *
+ * with spilling enabled the oldest chunks are moved to an unlinked
+ * temporary file once more than spill_threshold bytes are in memory.
+ *
+ * activity counts the writes, reads and drains of the buffer so a buffer
+ * that is busy can be told apart from one that sits at the same size.
+ */
 typedef struct octo_buffer
 {
     octo_list buffer_list;
+    size_t chunk_base;
     size_t chunk_size;
+    size_t chunk_max;
     size_t size;
+    size_t activity;
     size_t items; 
+    size_t inline_start;
+    octo_buffer_budget *budget;
+    octo_list budget_list;
+    size_t spill_threshold;
+    size_t spilled;
+    int spill_fd;
+    off_t spill_end;
+    uint8_t inline_data[OCTO_BUFFER_INLINE_SIZE];
 } octo_buffer;
 
+/**
+ * called when a write needs more memory than a budget has left
+ *
+ * the callback may free memory, by shedding or draining the largest
+ * consumers of the budget, after which the write tries again once.
+ */
+typedef void (*octo_buffer_budget_cb)(void *ctx, octo_buffer_budget *budget,
+        size_t wanted);
+
+/**
+ * limit on the chunk memory held by a set of buffers
+ *
+ * budgets nest, a per connection budget may have a per worker budget as
+ * its parent which in turn may have a process wide one, and memory counts
+ * against every budget up the chain. a limit of 0 is unlimited.
+ *
+ * used is updated atomically so a parent budget may be shared by threads,
+ * attaching and detaching buffers and children is not thread safe.
+ */
+struct octo_buffer_budget
+{
+    octo_buffer_budget *parent;
+    size_t limit;
+    size_t used;
+    octo_buffer_budget_cb exhausted;
+    void *exhausted_ctx;
+    octo_list buffers;
+    octo_list children;
+    octo_list child_list;
+};
+
+/**
+ * buffer memory usage
+ *
+ * capacity and slack count chunks in memory only, slack is chunk capacity
+ * that holds no readable bytes. spilled is the readable bytes on disk.
+ */
+typedef struct octo_buffer_stats
+{
+    size_t size;
+    size_t chunks;
+    size_t capacity;
+    size_t slack;
+    size_t spilled;
+} octo_buffer_stats;
+
 /**
  * initialize the stack buffers
  */
@@ -58,11 +167,105 @@ void octo_init_buffer();
  */
 void octo_buffer_init(octo_buffer *b, size_t chunk_size);
 
+/**
+ * set the largest chunk size the buffer may grow to
+ *
+ * a max no larger than the initial chunk size disables growth.
+ */
+void octo_buffer_set_chunk_max(octo_buffer *b, size_t chunk_max);
+
+/**
+ * hint that about len more bytes are going to be written, for example
+ * from a Content-Length, so the next chunk is sized to fit them. a hint
+ * never shrinks the chunk size.
+ */
+void octo_buffer_hint(octo_buffer *b, size_t len);
+
+/**
+ * count the chunk memory of a buffer against a budget and its parents,
+ * detaching it from any previous budget.
+ *
+ * writes that would exceed the budget are partially accepted.
+ */
+void octo_buffer_attach(octo_buffer *b, octo_buffer_budget *budget);
+
+/**
+ * stop counting a buffer against its budget
+ */
+void octo_buffer_detach(octo_buffer *b);
+
+/**
+ * initialize a budget of limit bytes, parent may be NULL
+ */
+void octo_buffer_budget_init(octo_buffer_budget *budget,
+        octo_buffer_budget *parent, size_t limit);
+
+/**
+ * destroy a budget, detaching its buffers and child budgets
+ */
+void octo_buffer_budget_destroy(octo_buffer_budget *budget);
+
+/**
+ * set the callback for when the budget runs out
+ */
+void octo_buffer_budget_set_cb(octo_buffer_budget *budget,
+        octo_buffer_budget_cb exhausted, void *ctx);
+
+/**
+ * bytes of chunk memory counted against the budget
+ */
+size_t octo_buffer_budget_used(const octo_buffer_budget *budget);
+
+/**
+ * bytes that may still be allocated under the budget and all its parents
+ */
+size_t octo_buffer_budget_available(const octo_buffer_budget *budget);
+
+/**
+ * the attached buffer holding the most bytes, NULL if there are none
+ */
+octo_buffer * octo_buffer_budget_largest(octo_buffer_budget *budget);
+
+/**
+ * the child budget using the most memory, NULL if there are none
+ */
+octo_buffer_budget * octo_buffer_budget_largest_child(octo_buffer_budget *budget);
+
+/**
+ * spill the oldest chunks of the buffer to an unlinked temporary file in
+ * dir, or the default temporary directory when dir is NULL, whenever more
+ * than threshold bytes are held in memory. a threshold of 0 stops spilling
+ * any more chunks.
+ *
+ * spilled bytes are read back transparently and may be sent straight
+ * from the file, see octo_buffer_peekfile.
+ *
+ * returns false if the temporary file could not be created.
+ */
+bool octo_buffer_set_spill(octo_buffer *b, size_t threshold, const char *dir);
+
+/**
+ * release memory an idle buffer doesn't need
+ *
+ * contents small enough are moved to inline storage and every chunk is
+ * freed, otherwise chunks using less than half their capacity are
+ * shrunk to fit. chunk growth starts over from the initial chunk size.
+ *
+ * returns the number of bytes of chunk memory released.
+ */
+size_t octo_buffer_trim(octo_buffer *b);
+
 /**
  * destroy a buffer
  */
 void octo_buffer_destroy(octo_buffer *b);
 
+/**
+ * count of writes, reads and drains done on the buffer, any change means
+ * the buffer was used in between
+ */
+size_t octo_buffer_activity(const octo_buffer *b);
+
 /**
  * size of the buffer in bytes
  */
@@ -73,13 +276,42 @@ size_t octo_buffer_size(const octo_buffer *b);
  */
 size_t octo_buffer_chunks(const octo_buffer *b);
 
+/**
+ * fill in memory usage stats of the buffer
+ */
+void octo_buffer_get_stats(const octo_buffer *b, octo_buffer_stats *stats);
+
 /**
  * write to the buffer from a memory location at most len bytes
  *
- * return number of bytes written
+ * return number of bytes written, less than len when memory or the
+ * budget of the buffer runs out.
  */
 size_t octo_buffer_write(octo_buffer *b, void *data, size_t len);
 
+/**
+ * append len bytes of external memory to the buffer without copying it.
+ *
+ * the memory must stay valid and unmodified until release is called with
+ * ctx, data, and len, which happens once every byte has been read or
+ * drained or the buffer is destroyed. release may be NULL.
+ *
+ * return number of bytes added, 0 on failure in which case the caller
+ * still owns the memory.
+ */
+size_t octo_buffer_write_ref(octo_buffer *b, void *data, size_t len,
+        octo_buffer_release_cb release, void *ctx);
+
+/**
+ * append len bytes of a file starting at offset to the buffer by mapping
+ * the region read only rather than copying it.
+ *
+ * the file descriptor may be closed once this returns.
+ *
+ * return number of bytes added, 0 on failure.
+ */
+size_t octo_buffer_write_file(octo_buffer *b, int fd, off_t offset, size_t len);
+
 /**
  * read from the buffer to a memory location at most len bytes.
  *
@@ -97,6 +329,26 @@ size_t octo_buffer_read(octo_buffer *b, void *data, size_t len);
  */
 size_t octo_buffer_peek(octo_buffer *b, void *data, size_t len);
 
+/**
+ * peek in to the buffer without copying by filling in at most iovcnt
+ * iovecs pointing at the chunks of the buffer in order, stopping at the
+ * first chunk spilled to disk.
+ *
+ * the iovecs are valid until the buffer is next read, drained, or destroyed.
+ *
+ * return the number of iovecs filled in.
+ */
+size_t octo_buffer_peekv(octo_buffer *b, struct iovec *iov, size_t iovcnt);
+
+/**
+ * check if the oldest bytes of the buffer are spilled to disk, if so
+ * fill in the file descriptor, offset, and length of those bytes so they
+ * can be handed to sendfile or splice before draining them.
+ *
+ * octo_buffer_peekv stops short of spilled bytes.
+ */
+bool octo_buffer_peekfile(octo_buffer *b, int *fd, off_t *offset, size_t *len);
+
 /**
  * remove from the buffer at most len bytes.
  *
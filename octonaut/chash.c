@@ -0,0 +1,162 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "common.h"
+
+#include "chash.h"
+
+/**
+ * the shard for a hash, chosen by the top bits as the bins in a shard
+ * are chosen by the bottom bits
+ */
+static inline octo_chash_shard * octo_chash_shard_get(octo_chash *hashtable, uint32_t keyhash)
+{
+    if(hashtable->shard_bits == 0)
+    {
+        return hashtable->shards;
+    }
+    return &hashtable->shards[keyhash >> (32 - hashtable->shard_bits)];
+}
+
+bool octo_chash_init(octo_chash *hashtable, octo_hash_function hash_function,
+        uint32_t seed, size_t shard_bits, size_t pow2size)
+{
+    size_t n_shards = (size_t)1 << shard_bits;
+
+    assert(shard_bits < 16);
+    hashtable->hash_function = hash_function;
+    hashtable->hash_seed = seed;
+    hashtable->shard_bits = shard_bits;
+
+    if(posix_memalign((void **)&hashtable->shards, __alignof__(octo_chash_shard),
+            sizeof(octo_chash_shard)*n_shards) != 0)
+    {
+        hashtable->shards = NULL;
+        return false;
+    }
+
+    for(size_t i = 0; i < n_shards; ++i)
+    {
+        pthread_rwlock_init(&hashtable->shards[i].lock, NULL);
+        octo_hash_init(&hashtable->shards[i].hash, hash_function, seed, pow2size);
+    }
+
+    return true;
+}
+
+void octo_chash_destroy(octo_chash *hashtable)
+{
+    size_t n_shards = (size_t)1 << hashtable->shard_bits;
+
+    for(size_t i = 0; i < n_shards; ++i)
+    {
+        octo_hash_destroy(&hashtable->shards[i].hash);
+        pthread_rwlock_destroy(&hashtable->shards[i].lock);
+    }
+
+    free(hashtable->shards);
+    hashtable->shards = NULL;
+    hashtable->hash_function = NULL;
+    hashtable->hash_seed = 0;
+    hashtable->shard_bits = 0;
+}
+
+size_t octo_chash_size(octo_chash *hashtable)
+{
+    size_t n_shards = (size_t)1 << hashtable->shard_bits;
+    size_t size = 0;
+
+    for(size_t i = 0; i < n_shards; ++i)
+    {
+        pthread_rwlock_rdlock(&hashtable->shards[i].lock);
+        size += octo_hash_size(&hashtable->shards[i].hash);
+        pthread_rwlock_unlock(&hashtable->shards[i].lock);
+    }
+
+    return size;
+}
+
+bool octo_chash_has(octo_chash *hashtable, void *key, size_t keylen)
+{
+    return octo_chash_get(hashtable, key, keylen) != NULL;
+}
+
+bool octo_chash_put(octo_chash *hashtable, octo_hash_entry *entry)
+{
+    uint32_t keyhash = hashtable->hash_function(entry->key, entry->keylen, hashtable->hash_seed);
+    octo_chash_shard *shard = octo_chash_shard_get(hashtable, keyhash);
+    bool putted;
+
+    pthread_rwlock_wrlock(&shard->lock);
+    putted = octo_hash_put_h(&shard->hash, entry, keyhash);
+    pthread_rwlock_unlock(&shard->lock);
+
+    return putted;
+}
+
+octo_hash_entry * octo_chash_get(octo_chash *hashtable, void *key, size_t keylen)
+{
+    uint32_t keyhash = hashtable->hash_function(key, keylen, hashtable->hash_seed);
+    octo_chash_shard *shard = octo_chash_shard_get(hashtable, keyhash);
+    octo_hash_entry *entry;
+
+    /* get never moves bins so lookups can share the shard */
+    pthread_rwlock_rdlock(&shard->lock);
+    entry = octo_hash_get_h(&shard->hash, key, keylen, keyhash);
+    pthread_rwlock_unlock(&shard->lock);
+
+    return entry;
+}
+
+bool octo_chash_apply(octo_chash *hashtable, void *key, size_t keylen,
+        octo_chash_apply_cb fn, void *ctx)
+{
+    uint32_t keyhash = hashtable->hash_function(key, keylen, hashtable->hash_seed);
+    octo_chash_shard *shard = octo_chash_shard_get(hashtable, keyhash);
+    octo_hash_entry *entry;
+
+    pthread_rwlock_rdlock(&shard->lock);
+    entry = octo_hash_get_h(&shard->hash, key, keylen, keyhash);
+    if(entry)
+    {
+        fn(entry, ctx);
+    }
+    pthread_rwlock_unlock(&shard->lock);
+
+    return entry != NULL;
+}
+
+octo_hash_entry * octo_chash_pop(octo_chash *hashtable, void *key, size_t keylen)
+{
+    uint32_t keyhash = hashtable->hash_function(key, keylen, hashtable->hash_seed);
+    octo_chash_shard *shard = octo_chash_shard_get(hashtable, keyhash);
+    octo_hash_entry *entry;
+
+    pthread_rwlock_wrlock(&shard->lock);
+    entry = octo_hash_pop_h(&shard->hash, key, keylen, keyhash);
+    pthread_rwlock_unlock(&shard->lock);
+
+    return entry;
+}
@@ -0,0 +1,122 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef OCTO_CHASH_H
+#define OCTO_CHASH_H
+
+#include "hash_function.h"
+#include "hash.h"
+
+#include <stdbool.h>
+#include <pthread.h>
+
+/**
+ * intrusive concurrent hash table store shared between threads.
+ *
+ * entries are spread over a power of 2 number of shards by the top bits
+ * of their hash, each shard an octo_hash behind its own read write lock.
+ * threads only contend when they touch the same shard and lookups in a
+ * shard run side by side.
+ *
+ * entries are owned by the caller as with octo_hash. an entry returned
+ * by get may be popped by another thread at any time, so either entries
+ * outlive every thread that may have looked them up or the entry is used
+ * with octo_chash_apply while its shard is locked.
+ */
+
+/**
+ * a shard of the table on its own cache lines
+ */
+typedef struct octo_chash_shard
+{
+    pthread_rwlock_t lock;
+    octo_hash hash;
+} __attribute__((aligned(64))) octo_chash_shard;
+
+/**
+ * concurrent hash table
+ */
+typedef struct octo_chash
+{
+    octo_hash_function hash_function;
+    uint32_t hash_seed;
+    uint32_t shard_bits;
+    octo_chash_shard *shards;
+} octo_chash;
+
+/**
+ * called with an entry while its shard is locked for reading
+ */
+typedef void (*octo_chash_apply_cb)(octo_hash_entry *entry, void *ctx);
+
+/**
+ * initialize a hash table with 2^shard_bits shards of 2^pow2size bins
+ * each to begin with
+ *
+ * returns false if the shards could not be allocated
+ */
+bool octo_chash_init(octo_chash *hashtable, octo_hash_function hash_function,
+        uint32_t seed, size_t shard_bits, size_t pow2size);
+
+/**
+ * destroy a hash table
+ */
+void octo_chash_destroy(octo_chash *hashtable);
+
+/**
+ * size of a hash table
+ */
+size_t octo_chash_size(octo_chash *hashtable);
+
+/**
+ * check if a hash table has a key
+ */
+bool octo_chash_has(octo_chash *hashtable, void *key, size_t keylen);
+
+/**
+ * put an entry in to the hash table
+ *
+ * returns true if put succeeded, false if the key already existed
+ */
+bool octo_chash_put(octo_chash *hashtable, octo_hash_entry *entry);
+
+/**
+ * get an entry from the hash table
+ */
+octo_hash_entry * octo_chash_get(octo_chash *hashtable,
+        void *key, size_t keylen);
+
+/**
+ * call fn with the entry for a key while it can't be popped
+ *
+ * returns false without calling fn if the key isn't in the table
+ */
+bool octo_chash_apply(octo_chash *hashtable, void *key, size_t keylen,
+        octo_chash_apply_cb fn, void *ctx);
+
+/**
+ * get and remove an entry from the hash table
+ */
+octo_hash_entry * octo_chash_pop(octo_chash *hashtable,
+        void *key, size_t keylen);
+
+#endif
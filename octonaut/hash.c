@@ -39,11 +39,11 @@ static inline uint32_t octo_hash_nbin(uint32_t bins, uint32_t keyhash)
 /**
  * find an entry in a bin or return NULL
  */
-static inline octo_hash_entry * octo_hash_bin_get(octo_hash_entry *entry, void *key, size_t keylen)
+static inline octo_hash_entry * octo_hash_bin_get(octo_hash_entry *entry, uint32_t keyhash, void *key, size_t keylen)
 {
     while(entry != NULL)
     {
-        if(keylen != entry->keylen)
+        if(keyhash != entry->hash || keylen != entry->keylen)
         {
             entry = entry->next;
             continue;
@@ -58,11 +58,177 @@ static inline octo_hash_entry * octo_hash_bin_get(octo_hash_entry *entry, void *
     return NULL;
 }
 
+/**
+ * obtain the bin a key is in, the old bin if it has yet to be moved
+ */
+static inline octo_hash_entry ** octo_hash_bin(octo_hash *hashtable, uint32_t keyhash)
+{
+    if(hashtable->old_bins != NULL)
+    {
+        uint32_t nbin = octo_hash_nbin(hashtable->n_old_bins, keyhash);
+
+        if(nbin >= hashtable->migrate_bin)
+        {
+            return &hashtable->old_bins[nbin];
+        }
+    }
+
+    return &hashtable->hash_bins[octo_hash_nbin(hashtable->n_hash_bins, keyhash)];
+}
+
+/**
+ * start resizing to a new number of bins, if the new bins can't be
+ * allocated the table carries on with the bins it has
+ */
+static void octo_hash_resize(octo_hash *hashtable, uint32_t n_bins)
+{
+    octo_hash_entry **bins = calloc(n_bins, sizeof(octo_hash_entry *));
+
+    if(bins == NULL)
+    {
+        return;
+    }
+
+    assert(power_of_two(n_bins));
+    hashtable->old_bins = hashtable->hash_bins;
+    hashtable->n_old_bins = hashtable->n_hash_bins;
+    hashtable->migrate_bin = 0;
+    hashtable->hash_bins = bins;
+    hashtable->n_hash_bins = n_bins;
+}
+
+/**
+ * move a few old bins to the new bins, freeing the old bins once they
+ * are all moved
+ */
+static void octo_hash_migrate(octo_hash *hashtable)
+{
+    if(hashtable->old_bins == NULL)
+    {
+        return;
+    }
+
+    for(int i = 0; i < OCTO_HASH_MIGRATE_BINS
+            && hashtable->migrate_bin < hashtable->n_old_bins; ++i)
+    {
+        octo_hash_entry *entry = hashtable->old_bins[hashtable->migrate_bin];
+
+        while(entry != NULL)
+        {
+            octo_hash_entry *next = entry->next;
+            uint32_t nbin = octo_hash_nbin(hashtable->n_hash_bins, entry->hash);
+
+            entry->next = hashtable->hash_bins[nbin];
+            hashtable->hash_bins[nbin] = entry;
+            entry = next;
+        }
+
+        hashtable->old_bins[hashtable->migrate_bin] = NULL;
+        hashtable->migrate_bin += 1;
+    }
+
+    if(hashtable->migrate_bin == hashtable->n_old_bins)
+    {
+        free(hashtable->old_bins);
+        hashtable->old_bins = NULL;
+        hashtable->n_old_bins = 0;
+        hashtable->migrate_bin = 0;
+    }
+}
+
+/**
+ * find an entry in a bin counting the entries compared for the sampler
+ */
+static octo_hash_entry * octo_hash_bin_sample(octo_hash *hashtable, octo_hash_entry *entry,
+        uint32_t keyhash, void *key, size_t keylen)
+{
+    size_t probes = 0;
+
+    while(entry != NULL)
+    {
+        probes += 1;
+        if(keyhash == entry->hash && keylen == entry->keylen
+                && memcmp(entry->key, key, keylen) == 0)
+        {
+            break;
+        }
+        entry = entry->next;
+    }
+
+    hashtable->sample_count = 0;
+    hashtable->sample_cb(hashtable->sample_ctx, hashtable, probes, entry != NULL);
+    return entry;
+}
+
+/**
+ * add the chains of some bins to the stats
+ */
+static void octo_hash_stats_bins(octo_hash_entry **bins, uint32_t from, uint32_t to,
+        octo_hash_stats *stats, double *hit_probes)
+{
+    for(uint32_t i = from; i < to; ++i)
+    {
+        size_t length = 0;
+
+        for(octo_hash_entry *entry = bins[i]; entry != NULL; entry = entry->next)
+        {
+            length += 1;
+        }
+
+        /* the entries in a chain take 1 to length compares to find */
+        *hit_probes += (double)length*(length + 1)/2;
+        stats->chains[min(length, OCTO_HASH_STATS_CHAINS - 1)] += 1;
+        stats->longest_chain = max(stats->longest_chain, length);
+        stats->bins += 1;
+    }
+}
+
+/**
+ * hash every entry again with a new hash function and seed, all at once
+ * as lookups can't find a key under two hashes
+ */
+static void octo_hash_rekey(octo_hash *hashtable, octo_hash_function hash_function, uint32_t seed)
+{
+    octo_hash_iterator iter;
+    octo_hash_entry *entries = NULL;
+    size_t size = hashtable->size;
+
+    for(octo_hash_entry *entry = octo_hash_iter(hashtable, &iter); entry != NULL;
+            entry = octo_hash_iternext(&iter))
+    {
+        octo_hash_iterremove(&iter);
+        entry->next = entries;
+        entries = entry;
+    }
+
+    free(hashtable->old_bins);
+    hashtable->old_bins = NULL;
+    hashtable->n_old_bins = 0;
+    hashtable->migrate_bin = 0;
+    hashtable->hash_function = hash_function;
+    hashtable->hash_seed = seed;
+
+    while(entries != NULL)
+    {
+        octo_hash_entry *entry = entries;
+        uint32_t nbin;
+
+        entries = entry->next;
+        entry->hash = hash_function(entry->key, entry->keylen, seed);
+        nbin = octo_hash_nbin(hashtable->n_hash_bins, entry->hash);
+        entry->next = hashtable->hash_bins[nbin];
+        hashtable->hash_bins[nbin] = entry;
+    }
+
+    hashtable->size = size;
+}
+
 inline void octo_hash_entry_init(octo_hash_entry *entry, void *key,
         size_t keylen)
 {
     entry->key = key;
     entry->keylen = keylen;
+    entry->hash = 0;
     entry->next = NULL;
 }
 
@@ -72,6 +238,15 @@ inline void octo_hash_init(octo_hash *hashtable, octo_hash_function hash_functio
     hashtable->hash_function = hash_function;
     hashtable->hash_seed = seed;
     hashtable->n_hash_bins = (1<<pow2size);
+    hashtable->min_hash_bins = hashtable->n_hash_bins;
+    hashtable->n_old_bins = 0;
+    hashtable->migrate_bin = 0;
+    hashtable->old_bins = NULL;
+    hashtable->sample_cb = NULL;
+    hashtable->sample_ctx = NULL;
+    hashtable->sample_rate = 0;
+    hashtable->sample_count = 0;
+    hashtable->flood_chain = 0;
     hashtable->hash_bins = malloc(sizeof(octo_hash_entry *)*hashtable->n_hash_bins);
 
     for(size_t i = 0; i < hashtable->n_hash_bins; ++i)
@@ -89,8 +264,15 @@ inline void octo_hash_destroy(octo_hash *hashtable)
     hashtable->hash_function = NULL;
     hashtable->hash_seed = 0;
     hashtable->n_hash_bins = 0;
+    hashtable->min_hash_bins = 0;
+    hashtable->n_old_bins = 0;
+    hashtable->migrate_bin = 0;
     free(hashtable->hash_bins);
     hashtable->hash_bins = NULL;
+    free(hashtable->old_bins);
+    hashtable->old_bins = NULL;
+    hashtable->sample_cb = NULL;
+    hashtable->sample_ctx = NULL;
     hashtable->size = 0;
 }
 
@@ -99,60 +281,174 @@ inline size_t octo_hash_size(const octo_hash *hashtable)
     return hashtable->size;
 }
 
-inline bool octo_hash_has(octo_hash *hashtable, void *key, size_t keylen)
+inline void octo_hash_get_stats(const octo_hash *hashtable, octo_hash_stats *stats)
+{
+    double hit_probes = 0;
+
+    memset(stats, 0, sizeof(octo_hash_stats));
+    stats->size = hashtable->size;
+
+    octo_hash_stats_bins(hashtable->hash_bins, 0, hashtable->n_hash_bins,
+        stats, &hit_probes);
+    if(hashtable->old_bins != NULL)
+    {
+        octo_hash_stats_bins(hashtable->old_bins, hashtable->migrate_bin,
+            hashtable->n_old_bins, stats, &hit_probes);
+    }
+
+    /* a missed lookup compares every entry in a bin chosen at random */
+    stats->load_factor = (double)stats->size/stats->bins;
+    stats->probes_miss = stats->load_factor;
+    stats->probes_hit = stats->size ? hit_probes/stats->size : 0;
+}
+
+inline void octo_hash_set_flood_guard(octo_hash *hashtable, size_t max_chain)
 {
-    uint32_t keyhash = hashtable->hash_function(key, keylen, hashtable->hash_seed);
-    uint32_t nbin = octo_hash_nbin(hashtable->n_hash_bins, keyhash);
-    octo_hash_entry *entry = hashtable->hash_bins[nbin];
-    return (bool)octo_hash_bin_get(entry, key, keylen);
+    hashtable->flood_chain = max_chain;
 }
 
-inline bool octo_hash_put(octo_hash *hashtable, octo_hash_entry *entry)
+inline void octo_hash_set_sampler(octo_hash *hashtable, octo_hash_sample_cb cb,
+        void *ctx, uint32_t rate)
 {
-    uint32_t keyhash = hashtable->hash_function(entry->key, entry->keylen, hashtable->hash_seed);
-    uint32_t nbin = octo_hash_nbin(hashtable->n_hash_bins, keyhash);
-    octo_hash_entry *head = hashtable->hash_bins[nbin];
+    hashtable->sample_cb = cb;
+    hashtable->sample_ctx = ctx;
+    hashtable->sample_rate = max(rate, 1);
+    hashtable->sample_count = 0;
+}
 
-    if(head == NULL)
+inline uint32_t octo_hash_hash(const octo_hash *hashtable, void *key, size_t keylen)
+{
+    /* short keys skip the call through the default function, a flooded
+     * table has moved on to siphash and always makes the call */
+    if(hashtable->hash_function == octo_default_hash_function && keylen <= OCTO_HASH_SHORT_MAX)
     {
-        hashtable->size += 1;
-        hashtable->hash_bins[nbin] = entry;
-        return true;
+        return octo_hash_short(key, keylen, hashtable->hash_seed);
     }
+    return hashtable->hash_function(key, keylen, hashtable->hash_seed);
+}
 
-    octo_hash_entry *existing = octo_hash_bin_get(head, entry->key, entry->keylen);
+inline bool octo_hash_has(octo_hash *hashtable, void *key, size_t keylen)
+{
+    return (bool)octo_hash_get(hashtable, key, keylen);
+}
 
-    if(existing)
+inline bool octo_hash_put(octo_hash *hashtable, octo_hash_entry *entry)
+{
+    return octo_hash_put_h(hashtable, entry,
+        octo_hash_hash(hashtable, entry->key, entry->keylen));
+}
+
+inline bool octo_hash_put_h(octo_hash *hashtable, octo_hash_entry *entry, uint32_t keyhash)
+{
+    octo_hash_migrate(hashtable);
+
+    octo_hash_entry **bin = octo_hash_bin(hashtable, keyhash);
+    octo_hash_entry *head = *bin;
+
+    if(head != NULL && octo_hash_bin_get(head, keyhash, entry->key, entry->keylen))
     {
         return false;
     }
 
-    hashtable->hash_bins[nbin] = entry;
+    entry->hash = keyhash;
+    *bin = entry;
     entry->next = head;
 
     hashtable->size += 1;
+
+    if(hashtable->flood_chain && hashtable->hash_function != octo_hash_siphash13)
+    {
+        size_t chain = 0;
+
+        for(octo_hash_entry *cur = entry; cur != NULL; cur = cur->next)
+        {
+            chain += 1;
+        }
+
+        if(chain > hashtable->flood_chain)
+        {
+            octo_hash_rekey(hashtable, octo_hash_siphash13, octo_hash_random_seed());
+        }
+    }
+
+    if(hashtable->old_bins == NULL && hashtable->size > hashtable->n_hash_bins
+            && hashtable->n_hash_bins < (1u<<31))
+    {
+        octo_hash_resize(hashtable, hashtable->n_hash_bins*2);
+    }
     return true;
 }
 
 inline octo_hash_entry * octo_hash_get(octo_hash *hashtable, void *key, size_t keylen)
 {
-    uint32_t keyhash = hashtable->hash_function(key, keylen, hashtable->hash_seed);
-    uint32_t nbin = octo_hash_nbin(hashtable->n_hash_bins, keyhash);
-    octo_hash_entry *entry = hashtable->hash_bins[nbin]; 
+    return octo_hash_get_h(hashtable, key, keylen,
+        octo_hash_hash(hashtable, key, keylen));
+}
+
+inline octo_hash_entry * octo_hash_get_h(octo_hash *hashtable, void *key, size_t keylen, uint32_t keyhash)
+{
+    octo_hash_entry *entry = *octo_hash_bin(hashtable, keyhash);
+
+    if(hashtable->sample_cb != NULL
+            && ++hashtable->sample_count >= hashtable->sample_rate)
+    {
+        return octo_hash_bin_sample(hashtable, entry, keyhash, key, keylen);
+    }
+
+    return octo_hash_bin_get(entry, keyhash, key, keylen);
+}
+
+inline size_t octo_hash_get_many(octo_hash *hashtable, void **keys,
+        const size_t *keylens, size_t n, octo_hash_entry **out)
+{
+    octo_hash_entry **bins[OCTO_HASH_BATCH];
+    uint32_t keyhashes[OCTO_HASH_BATCH];
+    size_t found = 0;
+
+    for(size_t start = 0; start < n; start += OCTO_HASH_BATCH)
+    {
+        size_t batch = min(n - start, OCTO_HASH_BATCH);
+
+        for(size_t i = 0; i < batch; ++i)
+        {
+            keyhashes[i] = octo_hash_hash(hashtable, keys[start + i], keylens[start + i]);
+            bins[i] = octo_hash_bin(hashtable, keyhashes[i]);
+            __builtin_prefetch(bins[i]);
+        }
+
+        for(size_t i = 0; i < batch; ++i)
+        {
+            __builtin_prefetch(*bins[i]);
+        }
+
+        for(size_t i = 0; i < batch; ++i)
+        {
+            out[start + i] = octo_hash_bin_get(*bins[i], keyhashes[i],
+                keys[start + i], keylens[start + i]);
+            found += out[start + i] != NULL;
+        }
+    }
 
-    return octo_hash_bin_get(entry, key, keylen);
+    return found;
 }
 
 inline octo_hash_entry * octo_hash_pop(octo_hash *hashtable, void *key, size_t keylen)
 {
-    uint32_t keyhash = hashtable->hash_function(key, keylen, hashtable->hash_seed);
-    uint32_t nbin = octo_hash_nbin(hashtable->n_hash_bins, keyhash);
-    octo_hash_entry *cur = hashtable->hash_bins[nbin];
+    return octo_hash_pop_h(hashtable, key, keylen,
+        octo_hash_hash(hashtable, key, keylen));
+}
+
+inline octo_hash_entry * octo_hash_pop_h(octo_hash *hashtable, void *key, size_t keylen, uint32_t keyhash)
+{
+    octo_hash_migrate(hashtable);
+
+    octo_hash_entry **bin = octo_hash_bin(hashtable, keyhash);
+    octo_hash_entry *cur = *bin;
     octo_hash_entry *prev = NULL;
 
     while(cur != NULL)
     {
-        if(keylen != cur->keylen)
+        if(keyhash != cur->hash || keylen != cur->keylen)
         {
             prev = cur;
             cur = cur->next;
@@ -167,11 +463,17 @@ inline octo_hash_entry * octo_hash_pop(octo_hash *hashtable, void *key, size_t k
             }
             else
             {
-                hashtable->hash_bins[nbin] = cur->next;
+                *bin = cur->next;
             }
 
             cur->next = NULL;
             hashtable->size -= 1;
+
+            if(hashtable->old_bins == NULL && hashtable->n_hash_bins > hashtable->min_hash_bins
+                    && hashtable->size < hashtable->n_hash_bins/8)
+            {
+                octo_hash_resize(hashtable, hashtable->n_hash_bins/2);
+            }
             return cur;
         }
         prev = cur;
@@ -180,3 +482,110 @@ inline octo_hash_entry * octo_hash_pop(octo_hash *hashtable, void *key, size_t k
 
     return NULL;
 }
+
+/**
+ * find the first entry in the current or a later bin, carrying on to
+ * the bins yet to be moved while resizing
+ */
+static octo_hash_entry * octo_hash_iter_seek(octo_hash_iterator *iter)
+{
+    octo_hash *hashtable = iter->hashtable;
+
+    for(;;)
+    {
+        for(; iter->bin < iter->n_bins; ++iter->bin)
+        {
+            if(iter->bins[iter->bin] != NULL)
+            {
+                iter->link = &iter->bins[iter->bin];
+                iter->entry = *iter->link;
+
+                /* start loading the next chain while this one is walked */
+                if(iter->bin + 1 < iter->n_bins)
+                {
+                    __builtin_prefetch(iter->bins[iter->bin + 1]);
+                }
+                return iter->entry;
+            }
+        }
+
+        if(iter->bins != hashtable->hash_bins || hashtable->old_bins == NULL)
+        {
+            iter->link = NULL;
+            iter->entry = NULL;
+            return NULL;
+        }
+
+        iter->bins = hashtable->old_bins;
+        iter->n_bins = hashtable->n_old_bins;
+        iter->bin = hashtable->migrate_bin;
+    }
+}
+
+inline octo_hash_entry * octo_hash_iter(octo_hash *hashtable, octo_hash_iterator *iter)
+{
+    iter->hashtable = hashtable;
+    iter->bins = hashtable->hash_bins;
+    iter->n_bins = hashtable->n_hash_bins;
+    iter->bin = 0;
+    iter->link = NULL;
+    iter->entry = NULL;
+    return octo_hash_iter_seek(iter);
+}
+
+inline octo_hash_entry * octo_hash_iternext(octo_hash_iterator *iter)
+{
+    if(iter->link == NULL)
+    {
+        return NULL;
+    }
+
+    /* a removed entry has already been unlinked from link */
+    if(iter->entry != NULL)
+    {
+        iter->link = &iter->entry->next;
+    }
+
+    if(*iter->link != NULL)
+    {
+        iter->entry = *iter->link;
+        __builtin_prefetch(iter->entry->next);
+        return iter->entry;
+    }
+
+    iter->bin += 1;
+    return octo_hash_iter_seek(iter);
+}
+
+inline void octo_hash_iterremove(octo_hash_iterator *iter)
+{
+    octo_hash_entry *entry = iter->entry;
+
+    assert(entry != NULL);
+    *iter->link = entry->next;
+    entry->next = NULL;
+    iter->entry = NULL;
+    iter->hashtable->size -= 1;
+}
+
+inline void octo_hash_clear(octo_hash *hashtable, octo_hash_clear_cb fn)
+{
+    octo_hash_iterator iter;
+    octo_hash_entry *entry = octo_hash_iter(hashtable, &iter);
+
+    while(entry != NULL)
+    {
+        octo_hash_iterremove(&iter);
+        if(fn)
+        {
+            fn(entry);
+        }
+        entry = octo_hash_iternext(&iter);
+    }
+
+    /* nothing is left to move so the old bins can go now */
+    free(hashtable->old_bins);
+    hashtable->old_bins = NULL;
+    hashtable->n_old_bins = 0;
+    hashtable->migrate_bin = 0;
+}
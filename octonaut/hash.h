@@ -29,7 +29,7 @@
 
 
 /**
- * intrusive fixed size chained hash table store.
+ * intrusive chained hash table store.
  *
  * choice of hash function is up to the creator of the store.
  * this takes care of retrieving, storing, and removing entries.
@@ -38,25 +38,94 @@
  * and asserts that the hash table really is power of 2.
  * modulus operations are very very slow, making hash bin lookups slow!
  *
- * This hash table is never resized to simplify things. Chaining
- * is used instead of open addressing. Perhaps an open addressing
- * version could be made pretty easily.
+ * the table doubles once it holds more entries than bins and halves,
+ * never below the initial size, once it holds fewer than 1/8. rather
+ * than rehashing everything at once the old bins are kept while a few of
+ * them at a time are moved to the new bins on each put and pop, so no
+ * single operation pays for the whole table. lookups find a key in the
+ * old bins until its bin has been moved.
  *
+ * the hash of each key is kept in its entry when put, chains are walked
+ * comparing hashes before keys and resizing never hashes a key again.
+ *
+ * Chaining is used instead of open addressing, see octo_ohash for an
+ * open addressing table.
+ *
+ */
+
+/**
+ * number of old bins moved to the new bins on each put and pop while
+ * resizing, enough to finish before the next resize is due even when
+ * shrinking down to nothing
  */
+#ifndef OCTO_HASH_MIGRATE_BINS
+#define OCTO_HASH_MIGRATE_BINS 16
+#endif
+
+/**
+ * number of keys octo_hash_get_many has in flight at once
+ */
+#ifndef OCTO_HASH_BATCH
+#define OCTO_HASH_BATCH 16
+#endif
 
+/**
+ * number of chain lengths counted by octo_hash_get_stats, the last
+ * counting every chain at least that long
+ */
+#ifndef OCTO_HASH_STATS_CHAINS
+#define OCTO_HASH_STATS_CHAINS 8
+#endif
+
+typedef struct octo_hash octo_hash;
 typedef struct octo_hash_entry octo_hash_entry;
 
+/**
+ * called with the number of entries a sampled lookup compared and
+ * whether it found its key
+ */
+typedef void (*octo_hash_sample_cb)(void *ctx, const octo_hash *hashtable,
+        size_t probes, bool found);
+
 /**
  * hash table
  */
-typedef struct octo_hash
+struct octo_hash
 {
     octo_hash_function hash_function;
     uint32_t hash_seed;
     uint32_t n_hash_bins;
+    uint32_t min_hash_bins;
+    uint32_t n_old_bins;
+    uint32_t migrate_bin;
     size_t size;
     octo_hash_entry **hash_bins;
-} octo_hash;
+    octo_hash_entry **old_bins;
+    octo_hash_sample_cb sample_cb;
+    void *sample_ctx;
+    uint32_t sample_rate;
+    uint32_t sample_count;
+    size_t flood_chain;
+};
+
+/**
+ * hash table chain lengths
+ *
+ * bins counts the old bins still to be moved while resizing. chains[n]
+ * is the number of bins holding n entries. probes_hit and probes_miss
+ * are the average number of entries compared by a lookup that finds its
+ * key and one that doesn't, given the chains as they are.
+ */
+typedef struct octo_hash_stats
+{
+    size_t size;
+    size_t bins;
+    double load_factor;
+    size_t longest_chain;
+    size_t chains[OCTO_HASH_STATS_CHAINS];
+    double probes_hit;
+    double probes_miss;
+} octo_hash_stats;
 
 /**
  * intrusive entry in the hash table
@@ -64,10 +133,29 @@ typedef struct octo_hash
 struct octo_hash_entry
 {
     struct octo_hash_entry *next;
+    uint32_t hash;
     size_t keylen;
     void *key;
 };
 
+/**
+ * iterator over the entries in a hash table
+ */
+typedef struct octo_hash_iterator
+{
+    octo_hash *hashtable;
+    octo_hash_entry **bins;
+    uint32_t n_bins;
+    uint32_t bin;
+    octo_hash_entry **link;
+    octo_hash_entry *entry;
+} octo_hash_iterator;
+
+/**
+ * called with each entry cleared from a hash table
+ */
+typedef void (*octo_hash_clear_cb)(octo_hash_entry *entry);
+
 /**
  * initialize a hash entry
  */
@@ -77,10 +165,10 @@ void octo_hash_entry_init(octo_hash_entry *entry, void *key,
 /**
  * initialize a hash entry using C99 struct initialization
  */
-#define octo_hash_entry_sinit(key, keylen) { .next = NULL, .key = key, .keylen = keylen }
+#define octo_hash_entry_sinit(key, keylen) { .next = NULL, .hash = 0, .key = key, .keylen = keylen }
 
 /**
- * initialize a hash table
+ * initialize a hash table with 2^pow2size bins to begin with
  */
 void octo_hash_init(octo_hash *hashtable,
         octo_hash_function hash_function, uint32_t seed, size_t pow2size);
@@ -95,6 +183,38 @@ void octo_hash_destroy(octo_hash *hashtable);
  */
 size_t octo_hash_size(const octo_hash *hashtable);
 
+/**
+ * obtain chain length statistics of a hash table by walking every bin
+ */
+void octo_hash_get_stats(const octo_hash *hashtable, octo_hash_stats *stats);
+
+/**
+ * call cb with the cost of every rate-th lookup, or stop sampling
+ * lookups if cb is NULL
+ *
+ * lookups that are not sampled only pay for counting them. sampled
+ * tables must not be shared between threads with octo_chash.
+ */
+void octo_hash_set_sampler(octo_hash *hashtable, octo_hash_sample_cb cb,
+        void *ctx, uint32_t rate);
+
+/**
+ * guard a table of untrusted keys against being flooded with colliding
+ * keys, once a put makes a chain longer than max_chain every entry is
+ * hashed again with octo_hash_siphash13 and a random seed. 0 turns the
+ * guard off.
+ *
+ * hashes from octo_hash_hash are only good until the next put on a
+ * guarded table, and guarded tables must not be octo_chash shards.
+ */
+void octo_hash_set_flood_guard(octo_hash *hashtable, size_t max_chain);
+
+/**
+ * hash a key the way the hash table does, for use with the _h functions
+ * when a key is looked up more than once or its hash is already known
+ */
+uint32_t octo_hash_hash(const octo_hash *hashtable, void *key, size_t keylen);
+
 /**
  * check if a hash table has a key
  */
@@ -107,16 +227,76 @@ bool octo_hash_has(octo_hash *hashtable, void *key, size_t keylen);
  */
 bool octo_hash_put(octo_hash *hashtable, octo_hash_entry *entry);
 
+/**
+ * put an entry in to the hash table given the hash of its key
+ */
+bool octo_hash_put_h(octo_hash *hashtable, octo_hash_entry *entry,
+        uint32_t keyhash);
+
 /**
  * get an entry from the hash table
  */
 octo_hash_entry * octo_hash_get(octo_hash *hashtable,
         void *key, size_t keylen);
 
+/**
+ * get an entry from the hash table given the hash of its key
+ */
+octo_hash_entry * octo_hash_get_h(octo_hash *hashtable,
+        void *key, size_t keylen, uint32_t keyhash);
+
+/**
+ * get the entries for n keys at once, filling in out[i] with the entry
+ * for keys[i] or NULL
+ *
+ * keys are hashed first, then their bins and the first entry of each bin
+ * are prefetched before any are compared, so the cache misses for a batch
+ * of keys overlap rather than following one another.
+ *
+ * returns the number of entries found
+ */
+size_t octo_hash_get_many(octo_hash *hashtable, void **keys,
+        const size_t *keylens, size_t n, octo_hash_entry **out);
+
 /**
  * get and remove an entry from the hash table
  */
 octo_hash_entry * octo_hash_pop(octo_hash *hashtable,
         void *key, size_t keylen);
 
+/**
+ * get and remove an entry from the hash table given the hash of its key
+ */
+octo_hash_entry * octo_hash_pop_h(octo_hash *hashtable,
+        void *key, size_t keylen, uint32_t keyhash);
+
+/**
+ * start iterating over a hash table
+ *
+ * entries come bin by bin in no particular order. nothing may be put
+ * or popped while iterating, use octo_hash_iterremove to remove entries.
+ *
+ * returns the first entry or NULL if the table is empty
+ */
+octo_hash_entry * octo_hash_iter(octo_hash *hashtable,
+        octo_hash_iterator *iter);
+
+/**
+ * move an iterator to the next entry
+ *
+ * returns the next entry or NULL once every entry has been visited
+ */
+octo_hash_entry * octo_hash_iternext(octo_hash_iterator *iter);
+
+/**
+ * remove the current entry of an iterator from its hash table,
+ * octo_hash_iternext then carries on with the entry after it
+ */
+void octo_hash_iterremove(octo_hash_iterator *iter);
+
+/**
+ * remove every entry from a hash table, calling fn with each if given
+ */
+void octo_hash_clear(octo_hash *hashtable, octo_hash_clear_cb fn);
+
 #endif
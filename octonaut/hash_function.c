@@ -20,6 +20,17 @@
  * THE SOFTWARE.
  */
 
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <endian.h>
+#include <sys/random.h>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <nmmintrin.h>
+#endif
+
 #include "hash_function.h"
 
 #define rotl32(num,amount) (((num) << (amount)) | ((num) >> (32 - (amount))))
@@ -185,6 +196,386 @@ uint32_t octo_hash_murmur3_x64(const void *vkey, const size_t keylen, const uint
     h1 += h2;
     h2 += h1;
 
-    uint32_t* hash = (uint32_t*)&h1;
-    return hash[0];
+    return (uint32_t)h1;
+}
+
+/**
+ * unaligned native order reads
+ */
+static inline uint64_t wyhash_r8(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t wyhash_r4(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t wyhash_r3(const uint8_t *p, size_t k)
+{
+    return (((uint64_t)p[0]) << 16) | (((uint64_t)p[k >> 1]) << 8) | p[k - 1];
+}
+
+static inline uint64_t wyhash_mix(uint64_t a, uint64_t b)
+{
+    octo_hash_mum(&a, &b);
+    return a ^ b;
+}
+
+static const uint64_t wyhash_secret[4] = {
+    0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL,
+    0x8ebc6af09c88c6e3ULL, 0x589965cc75374cc3ULL
+};
+
+/**
+ * wyhash 64 bit hash function
+ */
+uint32_t octo_hash_wyhash(const void *vkey, const size_t keylen, const uint32_t seed)
+{
+    const uint8_t *p = (const uint8_t *)vkey;
+    const uint64_t *secret = wyhash_secret;
+    uint64_t h = wyhash_mix(seed ^ secret[0], secret[1]);
+    uint64_t a, b;
+
+    if(keylen <= 16)
+    {
+        if(keylen >= 4)
+        {
+            /* two overlapping pairs of 4 byte reads cover 4 to 16 bytes */
+            a = (wyhash_r4(p) << 32) | wyhash_r4(p + ((keylen >> 3) << 2));
+            b = (wyhash_r4(p + keylen - 4) << 32) | wyhash_r4(p + keylen - 4 - ((keylen >> 3) << 2));
+        }
+        else if(keylen > 0)
+        {
+            a = wyhash_r3(p, keylen);
+            b = 0;
+        }
+        else
+        {
+            a = b = 0;
+        }
+    }
+    else
+    {
+        size_t i = keylen;
+
+        if(i > 48)
+        {
+            uint64_t h1 = h, h2 = h;
+            do
+            {
+                h = wyhash_mix(wyhash_r8(p) ^ secret[1], wyhash_r8(p + 8) ^ h);
+                h1 = wyhash_mix(wyhash_r8(p + 16) ^ secret[2], wyhash_r8(p + 24) ^ h1);
+                h2 = wyhash_mix(wyhash_r8(p + 32) ^ secret[3], wyhash_r8(p + 40) ^ h2);
+                p += 48;
+                i -= 48;
+            } while(i > 48);
+            h ^= h1 ^ h2;
+        }
+
+        while(i > 16)
+        {
+            h = wyhash_mix(wyhash_r8(p) ^ secret[1], wyhash_r8(p + 8) ^ h);
+            i -= 16;
+            p += 16;
+        }
+
+        a = wyhash_r8(p + i - 16);
+        b = wyhash_r8(p + i - 8);
+    }
+
+    a ^= secret[1];
+    b ^= h;
+    octo_hash_mum(&a, &b);
+    h = wyhash_mix(a ^ secret[0] ^ keylen, b ^ secret[1]);
+
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+/**
+ * crc32c lookup table for cpus without the crc32 instruction, filled in
+ * at startup
+ */
+static uint32_t crc32c_table[256];
+
+static uint32_t crc32c_table_update(uint32_t crc, const uint8_t *p, size_t len)
+{
+    while(len--)
+    {
+        crc = crc32c_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42_update(uint32_t crc, const uint8_t *p, size_t len)
+{
+    uint64_t crc64 = crc;
+
+    for(; len >= 8; p += 8, len -= 8)
+    {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        crc64 = _mm_crc32_u64(crc64, v);
+    }
+
+    crc = (uint32_t)crc64;
+    if(len >= 4)
+    {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        crc = _mm_crc32_u32(crc, v);
+        p += 4;
+        len -= 4;
+    }
+
+    while(len--)
+    {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+#endif
+
+typedef uint32_t (*crc32c_update_fn)(uint32_t crc, const uint8_t *p, size_t len);
+
+static crc32c_update_fn crc32c_update = crc32c_table_update;
+
+/**
+ * crc32c hash function
+ */
+uint32_t octo_hash_crc32c(const void *key, const size_t keylen, const uint32_t seed)
+{
+    uint32_t h = ~crc32c_update(~seed, (const uint8_t *)key, keylen);
+
+    h ^= keylen;
+    murmur3_fmix32(h);
+    return h;
+}
+
+/**
+ * process key of the siphash functions, random unless set
+ */
+static uint64_t siphash_key[2];
+
+static inline uint64_t siphash_r8(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return le64toh(v);
+}
+
+static inline uint32_t siphash_r4(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return le32toh(v);
+}
+
+#define siphash_round(v0, v1, v2, v3) \
+    do {\
+        v0 += v1; v1 = rotl64(v1,13); v1 ^= v0; v0 = rotl64(v0,32);\
+        v2 += v3; v3 = rotl64(v3,16); v3 ^= v2;\
+        v0 += v3; v3 = rotl64(v3,21); v3 ^= v0;\
+        v2 += v1; v1 = rotl64(v1,17); v1 ^= v2; v2 = rotl64(v2,32);\
+    } while(0)
+
+#define halfsiphash_round(v0, v1, v2, v3) \
+    do {\
+        v0 += v1; v1 = rotl32(v1,5); v1 ^= v0; v0 = rotl32(v0,16);\
+        v2 += v3; v3 = rotl32(v3,8); v3 ^= v2;\
+        v0 += v3; v3 = rotl32(v3,7); v3 ^= v0;\
+        v2 += v1; v1 = rotl32(v1,13); v1 ^= v2; v2 = rotl32(v2,16);\
+    } while(0)
+
+/**
+ * siphash with c compression and d finalization rounds
+ */
+static inline uint64_t siphash(uint64_t k0, uint64_t k1, const uint8_t *p, size_t len,
+        int c, int d)
+{
+    uint64_t v0 = 0x736f6d6570736575ULL ^ k0;
+    uint64_t v1 = 0x646f72616e646f6dULL ^ k1;
+    uint64_t v2 = 0x6c7967656e657261ULL ^ k0;
+    uint64_t v3 = 0x7465646279746573ULL ^ k1;
+    uint64_t b = ((uint64_t)len) << 56;
+    const uint8_t *end = p + (len & ~(size_t)7);
+
+    for(; p != end; p += 8)
+    {
+        uint64_t m = siphash_r8(p);
+        v3 ^= m;
+        for(int i = 0; i < c; ++i)
+        {
+            siphash_round(v0, v1, v2, v3);
+        }
+        v0 ^= m;
+    }
+
+    for(int i = 0; i < (len & 7); ++i)
+    {
+        b |= ((uint64_t)p[i]) << (8*i);
+    }
+
+    v3 ^= b;
+    for(int i = 0; i < c; ++i)
+    {
+        siphash_round(v0, v1, v2, v3);
+    }
+    v0 ^= b;
+
+    v2 ^= 0xff;
+    for(int i = 0; i < d; ++i)
+    {
+        siphash_round(v0, v1, v2, v3);
+    }
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+/**
+ * halfsiphash with c compression and d finalization rounds, 32 bit output
+ */
+static inline uint32_t halfsiphash(uint32_t k0, uint32_t k1, const uint8_t *p, size_t len,
+        int c, int d)
+{
+    uint32_t v0 = k0;
+    uint32_t v1 = k1;
+    uint32_t v2 = 0x6c796765 ^ k0;
+    uint32_t v3 = 0x74656462 ^ k1;
+    uint32_t b = ((uint32_t)len) << 24;
+    const uint8_t *end = p + (len & ~(size_t)3);
+
+    for(; p != end; p += 4)
+    {
+        uint32_t m = siphash_r4(p);
+        v3 ^= m;
+        for(int i = 0; i < c; ++i)
+        {
+            halfsiphash_round(v0, v1, v2, v3);
+        }
+        v0 ^= m;
+    }
+
+    for(int i = 0; i < (len & 3); ++i)
+    {
+        b |= ((uint32_t)p[i]) << (8*i);
+    }
+
+    v3 ^= b;
+    for(int i = 0; i < c; ++i)
+    {
+        halfsiphash_round(v0, v1, v2, v3);
+    }
+    v0 ^= b;
+
+    v2 ^= 0xff;
+    for(int i = 0; i < d; ++i)
+    {
+        halfsiphash_round(v0, v1, v2, v3);
+    }
+
+    return v1 ^ v3;
+}
+
+uint32_t octo_hash_siphash13(const void *key, const size_t keylen, const uint32_t seed)
+{
+    return (uint32_t)siphash(siphash_key[0] ^ seed, siphash_key[1],
+        (const uint8_t *)key, keylen, 1, 3);
+}
+
+uint32_t octo_hash_halfsiphash13(const void *key, const size_t keylen, const uint32_t seed)
+{
+    return halfsiphash((uint32_t)siphash_key[0] ^ seed, (uint32_t)(siphash_key[0] >> 32),
+        (const uint8_t *)key, keylen, 1, 3);
+}
+
+void octo_hash_siphash_set_key(const uint8_t key[16])
+{
+    siphash_key[0] = siphash_r8(key);
+    siphash_key[1] = siphash_r8(key + 8);
+}
+
+void octo_hash_siphash_get_key(uint8_t key[16])
+{
+    uint64_t k0 = htole64(siphash_key[0]);
+    uint64_t k1 = htole64(siphash_key[1]);
+    memcpy(key, &k0, 8);
+    memcpy(key + 8, &k1, 8);
+}
+
+uint32_t octo_hash_random_seed()
+{
+    static uint64_t counter = 0;
+    uint64_t n = __atomic_add_fetch(&counter, 1, __ATOMIC_RELAXED);
+
+    /* a keyed hash of a counter is as unpredictable as the key */
+    return (uint32_t)siphash(siphash_key[0], siphash_key[1] ^ 0x5eed,
+        (const uint8_t *)&n, sizeof(n), 1, 3);
+}
+
+/**
+ * fill in the process key from the kernel, falling back on urandom
+ */
+static void siphash_key_init()
+{
+    uint8_t key[16];
+
+    if(getrandom(key, sizeof(key), 0) != sizeof(key))
+    {
+        FILE *urandom = fopen("/dev/urandom", "r");
+
+        if(urandom == NULL || fread(key, 1, sizeof(key), urandom) != sizeof(key))
+        {
+            perror("octo_hash: no random process key");
+            abort();
+        }
+        fclose(urandom);
+    }
+
+    octo_hash_siphash_set_key(key);
+}
+
+/**
+ * fill in the crc32c table and siphash key and pick the crc32c
+ * implementation with cpuid before main runs
+ */
+__attribute__((constructor))
+static void octo_hash_function_select()
+{
+    for(uint32_t i = 0; i < 256; ++i)
+    {
+        uint32_t crc = i;
+        for(int j = 0; j < 8; ++j)
+        {
+            crc = (crc >> 1) ^ (0x82f63b78 & -(crc & 1));
+        }
+        crc32c_table[i] = crc;
+    }
+
+    siphash_key_init();
+
+#if defined(__x86_64__)
+    unsigned int eax, ebx, ecx, edx;
+
+    if(__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_2))
+    {
+        crc32c_update = crc32c_sse42_update;
+    }
+#endif
+}
+
+uint32_t octo_default_hash_function(const void *key, const size_t keylen, const uint32_t seed)
+{
+    if(keylen <= OCTO_HASH_SHORT_MAX)
+    {
+        return octo_hash_short(key, keylen, seed);
+    }
+    return octo_hash_wyhash(key, keylen, seed);
 }
@@ -25,16 +25,163 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
+/**
+ * hash functions for octo_hash and friends
+ *
+ * every named function gives the same hash for the same key, length, and
+ * seed on every machine of the same byte order and in every version, so
+ * hashes may be persisted or shared between processes. the hardware and
+ * table implementations of crc32c give identical hashes.
+ *
+ * octo_default_hash_function is octo_hash_short for short keys and
+ * wyhash for the rest. its hashes may differ between versions and must
+ * never be persisted.
+ *
+ * the siphash functions are keyed with a random per-process key as well
+ * as the seed, so their hashes differ between processes unless the key
+ * is set with octo_hash_siphash_set_key. without the key, keys that
+ * collide can't be found, which keeps tables of untrusted keys from
+ * being flooded in to long chains.
+ */
 typedef uint32_t (*octo_hash_function)(const void *key, const size_t keylen, const uint32_t seed);
+
+/**
+ * murmurhash3 with 32 bit arithmetic
+ */
 uint32_t octo_hash_murmur3(const void *key, const size_t keylen, const uint32_t seed);
+
+/**
+ * murmurhash3 with 64 bit arithmetic, the low 32 bits of its 128 bit hash
+ */
 uint32_t octo_hash_murmur3_x64(const void *key, const size_t keylen, const uint32_t seed);
 
-#if __X86_64__
-#define     octo_default_hash_function octo_hash_murmur3_x64
+/**
+ * wyhash, 64 bit multiply and fold mixing 48 bytes a round, folded to
+ * 32 bits
+ */
+uint32_t octo_hash_wyhash(const void *key, const size_t keylen, const uint32_t seed);
+
+/**
+ * longest key octo_hash_short hashes
+ */
+#define OCTO_HASH_SHORT_MAX 16
+
+/**
+ * 64x64 bit multiply, the low half in a and the high half in b
+ */
+static inline void octo_hash_mum(uint64_t *a, uint64_t *b)
+{
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
 #else
-#define     octo_default_hash_function octo_hash_murmur3
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha*hb, rm0 = ha*lb, rm1 = hb*la, rl = la*lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
 #endif
+}
+
+/**
+ * hash of a key of at most OCTO_HASH_SHORT_MAX bytes, such as a header
+ * name, with two overlapping pairs of loads and two multiplies
+ *
+ * keys of 4 to 16 bytes are read with two overlapping pairs of 4 byte
+ * loads, one pair from each end, and shorter keys by their first,
+ * middle and last byte. the seed is mixed in to both operands of one
+ * 64x64 bit multiply, the length in to one, and the halves of the
+ * product are folded together and spread over the 32 bit hash by a
+ * second 64 bit multiply.
+ */
+static inline uint32_t octo_hash_short(const void *key, const size_t keylen, const uint32_t seed)
+{
+    const uint8_t *p = (const uint8_t *)key;
+    uint64_t a, b;
+
+    if(keylen >= 4)
+    {
+        /* 4 to 16 bytes are covered by two overlapping pairs of 4 byte
+         * loads, one pair from each end, without branching on length */
+        size_t mid = (keylen >> 3) << 2;
+        uint32_t w[4];
+        memcpy(&w[0], p, 4);
+        memcpy(&w[1], p + mid, 4);
+        memcpy(&w[2], p + keylen - 4, 4);
+        memcpy(&w[3], p + keylen - 4 - mid, 4);
+        a = ((uint64_t)w[0] << 32) | w[1];
+        b = ((uint64_t)w[2] << 32) | w[3];
+    }
+    else if(keylen > 0)
+    {
+        a = b = ((uint64_t)p[0] << 16) | ((uint64_t)p[keylen >> 1] << 8) | p[keylen - 1];
+    }
+    else
+    {
+        a = b = 0;
+    }
+
+    /* the seed goes in to both operands, were either one free of it a
+     * key making that operand 0 would zero the multiply under any seed */
+    a ^= 0xa0761d6478bd642fULL ^ seed;
+    b ^= 0xe7037ed1a0b428dbULL ^ ((uint64_t)seed << 32) ^ keylen;
+    octo_hash_mum(&a, &b);
+    a ^= b;
+    a ^= a >> 32;
+
+    return (uint32_t)((a * 0x9e3779b97f4a7c15ULL) >> 32);
+}
+
+/**
+ * crc32c (castagnoli) of the key seeded with seed, finished with the
+ * murmurhash3 mix as crc bits alone spread poorly over bins
+ *
+ * uses the SSE4.2 crc32 instruction when the cpu has it, which makes it
+ * fast for short keys. a crc is linear in the key, so keys that collide
+ * do so under every seed and are easy to make, it must not be used for
+ * tables of untrusted keys and is never picked by the default function.
+ */
+uint32_t octo_hash_crc32c(const void *key, const size_t keylen, const uint32_t seed);
+
+/**
+ * siphash-1-3 with the process key, the low 32 bits of its 64 bit hash
+ */
+uint32_t octo_hash_siphash13(const void *key, const size_t keylen, const uint32_t seed);
+
+/**
+ * halfsiphash-1-3 with the first 8 bytes of the process key, cheaper
+ * than siphash-1-3 on 32 bit machines
+ */
+uint32_t octo_hash_halfsiphash13(const void *key, const size_t keylen, const uint32_t seed);
+
+/**
+ * replace the random process key of the siphash functions, before any
+ * table using them is created
+ */
+void octo_hash_siphash_set_key(const uint8_t key[16]);
+
+/**
+ * copy out the process key of the siphash functions
+ */
+void octo_hash_siphash_get_key(uint8_t key[16]);
+
+/**
+ * a random seed that can't be guessed from earlier seeds
+ */
+uint32_t octo_hash_random_seed();
+
+/**
+ * octo_hash_short for keys of up to OCTO_HASH_SHORT_MAX bytes and wyhash
+ * for longer keys, both mix the seed in so which keys collide depends
+ * on it
+ */
+uint32_t octo_default_hash_function(const void *key, const size_t keylen, const uint32_t seed);
 
 #endif
 
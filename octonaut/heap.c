@@ -0,0 +1,255 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "heap.h"
+
+/**
+ * the root sits at index 3 so the children of node i, 4*i - 8 to
+ * 4*i - 5, always start at a multiple of 4 nodes and with 16 byte nodes
+ * fill one 64 byte cache line. index 0 marks an entry as in no heap.
+ */
+#define OCTO_HEAP_ROOT 3
+#define OCTO_HEAP_D 4
+
+#define octo_heap_parent(i) (((i) - OCTO_HEAP_ROOT - 1)/OCTO_HEAP_D + OCTO_HEAP_ROOT)
+#define octo_heap_child(i) (OCTO_HEAP_D*((i) - OCTO_HEAP_ROOT) + OCTO_HEAP_ROOT + 1)
+
+inline void octo_heap_entry_init(octo_heap_entry *entry)
+{
+    entry->index = 0;
+}
+
+inline bool octo_heap_entry_active(const octo_heap_entry *entry)
+{
+    return entry->index != 0;
+}
+
+inline bool octo_heap_init(octo_heap *heap, size_t capacity)
+{
+    capacity = max(capacity, OCTO_HEAP_D);
+    if(posix_memalign((void **)&heap->nodes, 64,
+                (capacity + OCTO_HEAP_ROOT)*sizeof(octo_heap_node)) != 0)
+    {
+        heap->nodes = NULL;
+        heap->size = 0;
+        heap->capacity = 0;
+        return false;
+    }
+    heap->size = 0;
+    heap->capacity = capacity;
+    return true;
+}
+
+inline void octo_heap_destroy(octo_heap *heap)
+{
+    free(heap->nodes);
+    heap->nodes = NULL;
+    heap->size = 0;
+    heap->capacity = 0;
+}
+
+inline size_t octo_heap_size(const octo_heap *heap)
+{
+    return heap->size;
+}
+
+inline bool octo_heap_empty(const octo_heap *heap)
+{
+    return heap->size == 0;
+}
+
+static inline void octo_heap_set(octo_heap *heap, size_t i, octo_heap_node node)
+{
+    heap->nodes[i] = node;
+    node.entry->index = i;
+}
+
+/**
+ * move the node at i up until its parent's key is no greater
+ */
+static void octo_heap_up(octo_heap *heap, size_t i)
+{
+    octo_heap_node node = heap->nodes[i];
+
+    while(i > OCTO_HEAP_ROOT)
+    {
+        size_t parent = octo_heap_parent(i);
+        if(heap->nodes[parent].key <= node.key)
+        {
+            break;
+        }
+        octo_heap_set(heap, i, heap->nodes[parent]);
+        i = parent;
+    }
+    octo_heap_set(heap, i, node);
+}
+
+/**
+ * move the node at i down until no child's key is less
+ */
+static void octo_heap_down(octo_heap *heap, size_t i)
+{
+    octo_heap_node node = heap->nodes[i];
+    size_t end = heap->size + OCTO_HEAP_ROOT;
+
+    for(;;)
+    {
+        size_t first = octo_heap_child(i);
+        size_t least;
+
+        if(first >= end)
+        {
+            break;
+        }
+
+        /* the four children share a cache line */
+        least = first;
+        if(first + OCTO_HEAP_D <= end)
+        {
+            if(heap->nodes[first + 1].key < heap->nodes[least].key) least = first + 1;
+            if(heap->nodes[first + 2].key < heap->nodes[least].key) least = first + 2;
+            if(heap->nodes[first + 3].key < heap->nodes[least].key) least = first + 3;
+        }
+        else
+        {
+            for(size_t c = first + 1; c < end; ++c)
+            {
+                if(heap->nodes[c].key < heap->nodes[least].key)
+                {
+                    least = c;
+                }
+            }
+        }
+
+        if(node.key <= heap->nodes[least].key)
+        {
+            break;
+        }
+        octo_heap_set(heap, i, heap->nodes[least]);
+        i = least;
+    }
+    octo_heap_set(heap, i, node);
+}
+
+inline bool octo_heap_push(octo_heap *heap, octo_heap_entry *entry, double key)
+{
+    assert(entry->index == 0);
+
+    if(heap->size == heap->capacity)
+    {
+        size_t capacity = heap->capacity*2;
+        octo_heap_node *nodes;
+
+        /* realloc doesn't keep the alignment */
+        if(posix_memalign((void **)&nodes, 64,
+                    (capacity + OCTO_HEAP_ROOT)*sizeof(octo_heap_node)) != 0)
+        {
+            return false;
+        }
+        memcpy(nodes, heap->nodes, (heap->size + OCTO_HEAP_ROOT)*sizeof(octo_heap_node));
+        free(heap->nodes);
+        heap->nodes = nodes;
+        heap->capacity = capacity;
+    }
+
+    size_t i = heap->size + OCTO_HEAP_ROOT;
+    heap->size += 1;
+    heap->nodes[i].key = key;
+    heap->nodes[i].entry = entry;
+    octo_heap_up(heap, i);
+    return true;
+}
+
+inline octo_heap_entry * octo_heap_top(const octo_heap *heap)
+{
+    return heap->size ? heap->nodes[OCTO_HEAP_ROOT].entry : NULL;
+}
+
+inline double octo_heap_top_key(const octo_heap *heap)
+{
+    assert(heap->size > 0);
+    return heap->nodes[OCTO_HEAP_ROOT].key;
+}
+
+inline double octo_heap_key(const octo_heap *heap, const octo_heap_entry *entry)
+{
+    assert(entry->index != 0);
+    return heap->nodes[entry->index].key;
+}
+
+inline octo_heap_entry * octo_heap_pop(octo_heap *heap)
+{
+    octo_heap_entry *entry = octo_heap_top(heap);
+
+    if(entry != NULL)
+    {
+        octo_heap_remove(heap, entry);
+    }
+    return entry;
+}
+
+inline void octo_heap_remove(octo_heap *heap, octo_heap_entry *entry)
+{
+    size_t i = entry->index;
+    size_t last = heap->size + OCTO_HEAP_ROOT - 1;
+
+    assert(i != 0);
+    heap->size -= 1;
+    entry->index = 0;
+
+    if(i == last)
+    {
+        return;
+    }
+
+    /* the last node fills the hole and moves whichever way it belongs */
+    heap->nodes[i] = heap->nodes[last];
+    if(i > OCTO_HEAP_ROOT && heap->nodes[i].key < heap->nodes[octo_heap_parent(i)].key)
+    {
+        octo_heap_up(heap, i);
+    }
+    else
+    {
+        octo_heap_down(heap, i);
+    }
+}
+
+inline void octo_heap_update(octo_heap *heap, octo_heap_entry *entry, double key)
+{
+    size_t i = entry->index;
+    double old_key = heap->nodes[i].key;
+
+    assert(i != 0);
+    heap->nodes[i].key = key;
+    if(key < old_key)
+    {
+        octo_heap_up(heap, i);
+    }
+    else
+    {
+        octo_heap_down(heap, i);
+    }
+}
@@ -0,0 +1,142 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef OCTO_HEAP_H
+#define OCTO_HEAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "common.h"
+
+/**
+ * intrusive 4-ary min-heap of entries keyed by a double, such as a
+ * deadline
+ *
+ * the heap is a single array of key and entry pairs, so sifting compares
+ * keys without following pointers to the entries. a node's four children
+ * are next to each other and the root is placed so every group of four
+ * starts on a 64 byte cache line, each level down costs one cache miss
+ * while the tree is half as deep as a binary heap's.
+ *
+ * each entry knows where it is in the array so it can be removed or
+ * given a new key in O(log n) without searching.
+ */
+
+/**
+ * heap entry, embed in the struct to be kept in the heap
+ */
+typedef struct octo_heap_entry
+{
+    size_t index;
+} octo_heap_entry;
+
+/**
+ * a key and its entry in the heap's array
+ */
+typedef struct octo_heap_node
+{
+    double key;
+    octo_heap_entry *entry;
+} octo_heap_node;
+
+/**
+ * heap of entries
+ */
+typedef struct octo_heap
+{
+    octo_heap_node *nodes;
+    size_t size;
+    size_t capacity;
+} octo_heap;
+
+/**
+ * initialize an entry that is in no heap
+ */
+void octo_heap_entry_init(octo_heap_entry *entry);
+
+/**
+ * test if an entry is in a heap
+ */
+bool octo_heap_entry_active(const octo_heap_entry *entry);
+
+/**
+ * initialize an empty heap with room for capacity entries to begin with
+ *
+ * returns false if no memory could be allocated.
+ */
+bool octo_heap_init(octo_heap *heap, size_t capacity);
+
+/**
+ * destroy a heap, its entries are left as they are for the caller
+ */
+void octo_heap_destroy(octo_heap *heap);
+
+/**
+ * number of entries in the heap
+ */
+size_t octo_heap_size(const octo_heap *heap);
+
+/**
+ * test if the heap is empty
+ */
+bool octo_heap_empty(const octo_heap *heap);
+
+/**
+ * add an entry with a key, growing the heap when full
+ *
+ * returns false if the heap could not grow.
+ */
+bool octo_heap_push(octo_heap *heap, octo_heap_entry *entry, double key);
+
+/**
+ * the entry with the least key, or NULL if the heap is empty
+ */
+octo_heap_entry * octo_heap_top(const octo_heap *heap);
+
+/**
+ * the least key, the heap must not be empty
+ */
+double octo_heap_top_key(const octo_heap *heap);
+
+/**
+ * the key of an entry in the heap
+ */
+double octo_heap_key(const octo_heap *heap, const octo_heap_entry *entry);
+
+/**
+ * remove and return the entry with the least key, or NULL if the heap is
+ * empty
+ */
+octo_heap_entry * octo_heap_pop(octo_heap *heap);
+
+/**
+ * remove an entry from the heap
+ */
+void octo_heap_remove(octo_heap *heap, octo_heap_entry *entry);
+
+/**
+ * give an entry in the heap a new key
+ */
+void octo_heap_update(octo_heap *heap, octo_heap_entry *entry, double key);
+
+#endif
@@ -34,9 +34,11 @@ void octo_http_header_free(octo_http_header *header)
 
 void octo_http_header_init(octo_http_header *header)
 {
+    octo_hash_entry_init(&header->header_hash, NULL, 0);
     octo_list_init(&header->header_list);
     octo_buffer_init(&header->field, 256);
     octo_buffer_init(&header->value, 256);
+    header->key = NULL;
 }
 
 void octo_http_header_destroy(octo_http_header *header)
@@ -44,6 +46,8 @@ void octo_http_header_destroy(octo_http_header *header)
     octo_list_destroy(&header->header_list);
     octo_buffer_destroy(&header->field);
     octo_buffer_destroy(&header->value);
+    free(header->key);
+    header->key = NULL;
 }
 
 octo_http_header * octo_http_header_new()
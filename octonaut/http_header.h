@@ -32,7 +32,8 @@
  */
 typedef struct octo_http_header
 {
-    /* part of two header containers */
+    /* part of two header containers, the headers table of a message
+     * and the list of headers repeating the field of the first one */
     octo_hash_entry header_hash;
     octo_list header_list;
 
@@ -40,6 +41,9 @@ typedef struct octo_http_header
     octo_buffer field;
     octo_buffer value;
 
+    /* copy of the field the header is hashed by once in a message */
+    uint8_t *key;
+
 } octo_http_header;
 
 /**
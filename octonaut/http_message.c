@@ -20,8 +20,28 @@
  * THE SOFTWARE.
  */
 
+#include "common.h"
+
 #include "http_message.h"
 
+/**
+ * delete a header cleared from the headers table along with the headers
+ * repeating its field
+ */
+static void octo_http_message_header_delete(octo_hash_entry *entry)
+{
+    octo_http_header *header = ptr_offset(entry, octo_http_header, header_hash);
+    octo_http_header *pos;
+    octo_http_header *next;
+
+    octo_list_foreach(pos, next, &header->header_list, header_list)
+    {
+        octo_list_remove(&pos->header_list);
+        octo_http_header_delete(pos);
+    }
+    octo_http_header_delete(header);
+}
+
 void octo_http_message_init(octo_http_message *message)
 {
     octo_list_init(&message->message_queue);
@@ -31,7 +51,8 @@ void octo_http_message_init(octo_http_message *message)
     octo_buffer_init(&message->query, 256);
     message->http_major_version = 0;
     message->http_minor_version = 0;
-    octo_hash_init(&message->headers, octo_default_hash_function, rand(), 6);
+    octo_hash_init(&message->headers, octo_default_hash_function, octo_hash_random_seed(), 6);
+    octo_hash_set_flood_guard(&message->headers, OCTO_HTTP_HEADER_CHAIN_MAX);
     octo_buffer_init(&message->body, 1024);
 }
 
@@ -45,15 +66,7 @@ void octo_http_message_destroy(octo_http_message *message)
     message->http_major_version = 0;
     message->http_minor_version = 0;
 
-    /*
-    octo_hash_iterator iter;
-    octo_http_header *header = octo_hash_iter(&message->headers, &iter);
-    do {
-        octo_http_header_free(header);
-        octo_hash_iternext(iter);
-    } while(header)
-    */
-
+    octo_hash_clear(&message->headers, octo_http_message_header_delete);
     octo_hash_destroy(&message->headers);
 
     octo_buffer_destroy(&message->body);
@@ -82,8 +95,34 @@ void octo_http_message_delete(octo_http_message *message)
     octo_http_message_free(message);
 }
 
-void octo_http_message_add_header(octo_http_message *message, octo_http_header *header)
+void octo_http_message_body_hint(octo_http_message *message, size_t content_length)
+{
+    octo_buffer_hint(&message->body, content_length);
+}
+
+bool octo_http_message_add_header(octo_http_message *message, octo_http_header *header)
 {
-    octo_hash_put(&message->headers, &header->header_hash);
+    size_t keylen = octo_buffer_size(&header->field);
+
+    /* the field may span chunks and its chunks move as the buffer is
+     * used, the header keeps a flat copy of it to be keyed by */
+    free(header->key);
+    header->key = malloc(max(keylen, 1));
+    if(header->key == NULL)
+    {
+        return false;
+    }
+    keylen = octo_buffer_peek(&header->field, header->key, keylen);
+
+    octo_hash_entry_init(&header->header_hash, header->key, keylen);
+    if(!octo_hash_put(&message->headers, &header->header_hash))
+    {
+        /* a field may repeat, such as Cookie, later headers are kept in
+         * order after the first one in the table */
+        octo_hash_entry *entry = octo_hash_get(&message->headers, header->key, keylen);
+        octo_http_header *first = ptr_offset(entry, octo_http_header, header_hash);
+        octo_list_append(&first->header_list, &header->header_list);
+    }
+    return true;
 }
 
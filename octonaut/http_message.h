@@ -31,6 +31,14 @@
 
 typedef enum http_method octo_http_method;
 
+/**
+ * longest chain of headers in a message before the header table switches
+ * to a keyed hash, header names come from untrusted clients
+ */
+#ifndef OCTO_HTTP_HEADER_CHAIN_MAX
+#define OCTO_HTTP_HEADER_CHAIN_MAX 8
+#endif
+
 /**
  * http message 
  *
@@ -81,11 +89,24 @@ octo_http_message * octo_http_message_new();
 void octo_http_message_delete(octo_http_message *message);
 
 /**
- * add a header to an http message
+ * add a header to an http message keyed by a copy of its field, the
+ * message deletes its headers when destroyed
+ *
+ * a header repeating the field of one already added isn't put in the
+ * table, it is appended to the header_list of the first header with
+ * that field.
+ *
+ * returns false if the key could not be allocated.
  */
-void octo_http_message_add_header(octo_http_message *message,
+bool octo_http_message_add_header(octo_http_message *message,
         octo_http_header *header);
 
+/**
+ * size the body buffer for an expected content length
+ */
+void octo_http_message_body_hint(octo_http_message *message,
+        size_t content_length);
+
 /**
  * pointer to the last header
  *
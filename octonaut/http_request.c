@@ -23,6 +23,7 @@
 #include <stdio.h>
 
 #include "http_request.h"
+#include "http_message.h"
 #include "common.h"
 
 enum octo_http_parser_state
@@ -48,6 +49,9 @@ static int request_message_begin(http_parser *parser)
 {
     octo_http_request *request = ptr_offset(parser, octo_http_request, parser);
     request->parser_state = PARSER_MESSAGE_BEGIN;
+
+    request->message = octo_http_message_new();
+    octo_list_append(&request->message_queue, &request->message->message_queue);
     return 0;
 }
 
@@ -104,6 +108,12 @@ static int request_headers_complete(http_parser *parser)
 
     octo_http_request *request = ptr_offset(parser, octo_http_request, parser);
     request->parser_state = PARSER_HEADERS_COMPLETE;
+
+    /* size the body of the message being parsed up front */
+    if(parser->content_length > 0)
+    {
+        octo_http_message_body_hint(request->message, parser->content_length);
+    }
     return 0;
 }
 
@@ -112,6 +122,8 @@ static int request_body(http_parser *parser,
 {
     octo_http_request *request = ptr_offset(parser, octo_http_request, parser);
     request->parser_state = PARSER_BODY;
+
+    octo_buffer_write(&request->message->body, (void *)body, len);
     return 0;
 }
 
@@ -119,6 +131,7 @@ static int request_message_complete(http_parser *parser)
 {
     octo_http_request *request = ptr_offset(parser, octo_http_request, parser);
     request->parser_state = PARSER_MESSAGE_COMPLETE;
+    request->message = NULL;
     return 0;
 }
 
@@ -139,13 +152,23 @@ parser_settings = {
 void octo_http_request_init(octo_http_request *request)
 {
     octo_list_init(&request->message_queue);
+    request->message = NULL;
     http_parser_init(&request->parser, HTTP_REQUEST);
     request->parser_state = PARSER_INIT;
 }
 
 void octo_http_request_destroy(octo_http_request *request)
 {
+    octo_http_message *pos;
+    octo_http_message *next;
+
+    octo_list_foreach(pos, next, &request->message_queue, message_queue)
+    {
+        octo_list_remove(&pos->message_queue);
+        octo_http_message_delete(pos);
+    }
     octo_list_destroy(&request->message_queue);
+    request->message = NULL;
     request->parser_state = PARSER_INIT;
 }
 
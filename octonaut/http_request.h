@@ -25,6 +25,7 @@
 
 #include "list.h"
 #include "hash.h"
+#include "http_message.h"
 
 #include "http_parser.h"
 
@@ -36,6 +37,9 @@ typedef struct octo_http_request
     /* http messages filled in as needed */
     octo_list message_queue;
 
+    /* the message being parsed, the tail of the queue */
+    octo_http_message *message;
+
     /* http parser and its state */
     int parser_state;
     http_parser parser;
@@ -0,0 +1,291 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "lflist.h"
+
+inline void octo_lfstack_init(octo_lfstack *stack)
+{
+    stack->top = NULL;
+    stack->pops = 0;
+}
+
+inline bool octo_lfstack_empty(octo_lfstack *stack)
+{
+    return __atomic_load_n(&stack->top, __ATOMIC_RELAXED) == NULL;
+}
+
+/**
+ * read the top and pop count of a stack
+ *
+ * the two halves are read separately, a torn read only fails the
+ * compare and swap that follows and is read again whole by it.
+ */
+static inline void octo_lfstack_load(octo_lfstack *stack, octo_lfstack *old)
+{
+    old->pops = __atomic_load_n(&stack->pops, __ATOMIC_ACQUIRE);
+    old->top = __atomic_load_n(&stack->top, __ATOMIC_ACQUIRE);
+}
+
+inline void octo_lfstack_push(octo_lfstack *stack, octo_lfstack_node *node)
+{
+    octo_lfstack old, new;
+
+    octo_lfstack_load(stack, &old);
+    do
+    {
+        __atomic_store_n(&node->next, old.top, __ATOMIC_RELAXED);
+        new.top = node;
+        new.pops = old.pops;
+    } while(!__atomic_compare_exchange(stack, &old, &new, true,
+                __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+}
+
+inline octo_lfstack_node * octo_lfstack_pop(octo_lfstack *stack)
+{
+    octo_lfstack old, new;
+
+    octo_lfstack_load(stack, &old);
+    do
+    {
+        if(old.top == NULL)
+        {
+            return NULL;
+        }
+        new.top = __atomic_load_n(&old.top->next, __ATOMIC_RELAXED);
+        new.pops = old.pops + 1;
+    } while(!__atomic_compare_exchange(stack, &old, &new, true,
+                __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+
+    return old.top;
+}
+
+inline octo_lfstack_node * octo_lfstack_pop_all(octo_lfstack *stack)
+{
+    octo_lfstack old, new;
+
+    octo_lfstack_load(stack, &old);
+    do
+    {
+        if(old.top == NULL)
+        {
+            return NULL;
+        }
+        new.top = NULL;
+        new.pops = old.pops + 1;
+    } while(!__atomic_compare_exchange(stack, &old, &new, true,
+                __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+
+    return old.top;
+}
+
+inline void octo_mpsc_init(octo_mpsc *queue)
+{
+    queue->stub.next = NULL;
+    queue->head = &queue->stub;
+    queue->tail = &queue->stub;
+}
+
+inline void octo_mpsc_push(octo_mpsc *queue, octo_mpsc_node *node)
+{
+    __atomic_store_n(&node->next, NULL, __ATOMIC_RELAXED);
+    octo_mpsc_node *prev = __atomic_exchange_n(&queue->head, node, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+}
+
+inline octo_mpsc_node * octo_mpsc_pop(octo_mpsc *queue)
+{
+    octo_mpsc_node *tail = queue->tail;
+    octo_mpsc_node *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+    /* step over the stub */
+    if(tail == &queue->stub)
+    {
+        if(next == NULL)
+        {
+            return NULL;
+        }
+        queue->tail = next;
+        tail = next;
+        next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    }
+
+    if(next != NULL)
+    {
+        queue->tail = next;
+        return tail;
+    }
+
+    /* a producer has swapped in a new head but not linked it yet */
+    if(tail != __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE))
+    {
+        return NULL;
+    }
+
+    /* the tail is the last node, put the stub back behind it so the tail
+     * can be handed out without emptying the queue */
+    octo_mpsc_push(queue, &queue->stub);
+    next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if(next != NULL)
+    {
+        queue->tail = next;
+        return tail;
+    }
+
+    return NULL;
+}
+
+inline bool octo_mpsc_empty(octo_mpsc *queue)
+{
+    return queue->tail == &queue->stub &&
+        __atomic_load_n(&queue->stub.next, __ATOMIC_ACQUIRE) == NULL;
+}
+
+/**
+ * round up to a power of 2
+ */
+static inline size_t octo_spsc_pow2(size_t x)
+{
+    size_t pow2 = 1;
+    while(pow2 < x)
+    {
+        pow2 <<= 1;
+    }
+    return pow2;
+}
+
+inline bool octo_spsc_init(octo_spsc *ring, size_t capacity, size_t record_size)
+{
+    capacity = octo_spsc_pow2(capacity);
+
+    if(posix_memalign((void **)&ring->records, 64, capacity*record_size) != 0)
+    {
+        return false;
+    }
+
+    ring->record_size = record_size;
+    ring->mask = capacity - 1;
+    ring->read_pos = 0;
+    ring->write_seen = 0;
+    ring->write_pos = 0;
+    ring->read_seen = 0;
+    return true;
+}
+
+inline void octo_spsc_destroy(octo_spsc *ring)
+{
+    free(ring->records);
+    ring->records = NULL;
+}
+
+inline size_t octo_spsc_capacity(const octo_spsc *ring)
+{
+    return ring->mask + 1;
+}
+
+inline size_t octo_spsc_size(octo_spsc *ring)
+{
+    size_t read_pos = __atomic_load_n(&ring->read_pos, __ATOMIC_ACQUIRE);
+    return __atomic_load_n(&ring->write_pos, __ATOMIC_ACQUIRE) - read_pos;
+}
+
+inline void * octo_spsc_reserve(octo_spsc *ring)
+{
+    if(ring->write_pos - ring->read_seen > ring->mask)
+    {
+        ring->read_seen = __atomic_load_n(&ring->read_pos, __ATOMIC_ACQUIRE);
+        if(ring->write_pos - ring->read_seen > ring->mask)
+        {
+            return NULL;
+        }
+    }
+    return ring->records + (ring->write_pos & ring->mask)*ring->record_size;
+}
+
+inline void octo_spsc_commit(octo_spsc *ring)
+{
+    __atomic_store_n(&ring->write_pos, ring->write_pos + 1, __ATOMIC_RELEASE);
+}
+
+inline void * octo_spsc_peek(octo_spsc *ring)
+{
+    if(ring->read_pos == ring->write_seen)
+    {
+        ring->write_seen = __atomic_load_n(&ring->write_pos, __ATOMIC_ACQUIRE);
+        if(ring->read_pos == ring->write_seen)
+        {
+            return NULL;
+        }
+    }
+    return ring->records + (ring->read_pos & ring->mask)*ring->record_size;
+}
+
+inline void octo_spsc_release(octo_spsc *ring)
+{
+    __atomic_store_n(&ring->read_pos, ring->read_pos + 1, __ATOMIC_RELEASE);
+}
+
+inline void * octo_spsc_peek_at(octo_spsc *ring, size_t n)
+{
+    if(ring->write_seen - ring->read_pos <= n)
+    {
+        ring->write_seen = __atomic_load_n(&ring->write_pos, __ATOMIC_ACQUIRE);
+        if(ring->write_seen - ring->read_pos <= n)
+        {
+            return NULL;
+        }
+    }
+    return ring->records + ((ring->read_pos + n) & ring->mask)*ring->record_size;
+}
+
+inline void octo_spsc_release_n(octo_spsc *ring, size_t n)
+{
+    __atomic_store_n(&ring->read_pos, ring->read_pos + n, __ATOMIC_RELEASE);
+}
+
+inline bool octo_spsc_push(octo_spsc *ring, const void *record)
+{
+    void *slot = octo_spsc_reserve(ring);
+
+    if(slot == NULL)
+    {
+        return false;
+    }
+    memcpy(slot, record, ring->record_size);
+    octo_spsc_commit(ring);
+    return true;
+}
+
+inline bool octo_spsc_pop(octo_spsc *ring, void *record)
+{
+    void *slot = octo_spsc_peek(ring);
+
+    if(slot == NULL)
+    {
+        return false;
+    }
+    memcpy(record, slot, ring->record_size);
+    octo_spsc_release(ring);
+    return true;
+}
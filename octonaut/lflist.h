@@ -0,0 +1,255 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef OCTO_LFLIST_H
+#define OCTO_LFLIST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "common.h"
+
+/**
+ * lock free intrusive containers for handing things between threads.
+ *
+ * like octo_list a node is embedded in the struct being passed around and
+ * the struct is found again from the node with ptr_offset. nothing is
+ * allocated per node and no locks are taken, memory ordering follows the
+ * C11 model through the gcc __atomic builtins.
+ *
+ * octo_lfstack is a Treiber stack any number of threads may push and pop.
+ * octo_mpsc is a Vyukov queue any number of threads may push to and one
+ * thread pops from in order. octo_spsc is a bounded ring of fixed size
+ * records in place between exactly one producer and one consumer.
+ */
+
+/**
+ * stack node, embed in the struct to be stacked
+ */
+typedef struct octo_lfstack_node
+{
+    struct octo_lfstack_node *next;
+} octo_lfstack_node;
+
+/**
+ * lock free stack
+ *
+ * the top is swapped along with a count of pops in a single double width
+ * compare and swap, so a node popped and pushed again between another
+ * thread reading the top and swapping it can't be mistaken for an
+ * unchanged stack (the ABA problem).
+ *
+ * a popping thread may still read the next pointer of a node another
+ * thread has just popped, so the memory of a node must stay mapped while
+ * any thread may pop the stack, such as nodes from a pool.
+ */
+typedef struct octo_lfstack
+{
+    octo_lfstack_node *top;
+    uintptr_t pops;
+} __attribute__((aligned(2*sizeof(void *)))) octo_lfstack;
+
+/**
+ * initialize an empty stack
+ */
+void octo_lfstack_init(octo_lfstack *stack);
+
+/**
+ * test if the stack is empty
+ */
+bool octo_lfstack_empty(octo_lfstack *stack);
+
+/**
+ * push a node on to the stack
+ */
+void octo_lfstack_push(octo_lfstack *stack, octo_lfstack_node *node);
+
+/**
+ * pop the most recently pushed node off the stack
+ *
+ * returns NULL if the stack is empty.
+ */
+octo_lfstack_node * octo_lfstack_pop(octo_lfstack *stack);
+
+/**
+ * pop every node off the stack at once
+ *
+ * returns the former top with the rest linked from it by next, most
+ * recently pushed first, or NULL if the stack is empty.
+ */
+octo_lfstack_node * octo_lfstack_pop_all(octo_lfstack *stack);
+
+/**
+ * queue node, embed in the struct to be queued
+ */
+typedef struct octo_mpsc_node
+{
+    struct octo_mpsc_node *next;
+} octo_mpsc_node;
+
+/**
+ * multiple producer single consumer queue
+ *
+ * producers swap themselves in as the head with a single atomic exchange
+ * and then link the old head to themselves, so a push never waits on
+ * another thread. the consumer follows the links from the tail. a stub
+ * node lives in the queue so it never has to be emptied completely.
+ *
+ * between a producer's exchange and its link the nodes behind it can't
+ * be reached yet, pop returns NULL until the link is made even though
+ * the queue isn't empty.
+ */
+typedef struct octo_mpsc
+{
+    octo_mpsc_node *head __attribute__((aligned(64)));
+    octo_mpsc_node *tail __attribute__((aligned(64)));
+    octo_mpsc_node stub;
+} octo_mpsc;
+
+/**
+ * initialize an empty queue
+ */
+void octo_mpsc_init(octo_mpsc *queue);
+
+/**
+ * push a node on to the head of the queue, from any thread
+ */
+void octo_mpsc_push(octo_mpsc *queue, octo_mpsc_node *node);
+
+/**
+ * pop the oldest node off the tail of the queue, from the consumer
+ * thread only
+ *
+ * returns NULL if the queue is empty or the next node is still being
+ * pushed.
+ */
+octo_mpsc_node * octo_mpsc_pop(octo_mpsc *queue);
+
+/**
+ * test if the queue is empty, from the consumer thread only
+ */
+bool octo_mpsc_empty(octo_mpsc *queue);
+
+/**
+ * single producer single consumer ring of fixed size records
+ *
+ * records are written and read in place in the ring's memory, so a
+ * record can be filled in by the producer and handed over without a
+ * copy. each side keeps its own position on its own cache line along
+ * with the last position it saw of the other side, and only reads the
+ * other side's cache line again when that copy says the ring is full or
+ * empty.
+ */
+typedef struct octo_spsc
+{
+    uint8_t *records;
+    size_t record_size;
+    size_t mask;
+
+    /* consumer */
+    size_t read_pos __attribute__((aligned(64)));
+    size_t write_seen;
+
+    /* producer */
+    size_t write_pos __attribute__((aligned(64)));
+    size_t read_seen;
+} octo_spsc;
+
+/**
+ * initialize a ring holding at least capacity records of record_size
+ * bytes, the capacity is rounded up to a power of 2
+ *
+ * returns false if no memory could be allocated.
+ */
+bool octo_spsc_init(octo_spsc *ring, size_t capacity, size_t record_size);
+
+/**
+ * destroy a ring
+ */
+void octo_spsc_destroy(octo_spsc *ring);
+
+/**
+ * number of records the ring can hold
+ */
+size_t octo_spsc_capacity(const octo_spsc *ring);
+
+/**
+ * number of records in the ring, exact only from the producer or the
+ * consumer when the other side is idle
+ */
+size_t octo_spsc_size(octo_spsc *ring);
+
+/**
+ * obtain the next free record to fill in, from the producer only
+ *
+ * returns NULL if the ring is full. the record is handed to the consumer
+ * by octo_spsc_commit.
+ */
+void * octo_spsc_reserve(octo_spsc *ring);
+
+/**
+ * hand the reserved record to the consumer
+ */
+void octo_spsc_commit(octo_spsc *ring);
+
+/**
+ * obtain the oldest record, from the consumer only
+ *
+ * returns NULL if the ring is empty. the record stays valid until it is
+ * given back by octo_spsc_release.
+ */
+void * octo_spsc_peek(octo_spsc *ring);
+
+/**
+ * give the oldest record back to the producer
+ */
+void octo_spsc_release(octo_spsc *ring);
+
+/**
+ * obtain the record n places after the oldest, from the consumer only
+ *
+ * returns NULL if the ring holds n or fewer records. together with
+ * octo_spsc_release_n a batch of records can be used in place at once.
+ */
+void * octo_spsc_peek_at(octo_spsc *ring, size_t n);
+
+/**
+ * give the n oldest records back to the producer
+ */
+void octo_spsc_release_n(octo_spsc *ring, size_t n);
+
+/**
+ * copy a record in to the ring
+ *
+ * returns false if the ring is full.
+ */
+bool octo_spsc_push(octo_spsc *ring, const void *record);
+
+/**
+ * copy the oldest record out of the ring
+ *
+ * returns false if the ring is empty.
+ */
+bool octo_spsc_pop(octo_spsc *ring, void *record);
+
+#endif
@@ -1,8 +1,12 @@
 #include "logger.h"
+#include "common.h"
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/uio.h>
 
 static char LVLSTR[][10]= {"DEBUG", "INFO ", "WARN ", "ERROR"};
 
@@ -23,11 +27,77 @@ static char LVLSTR[][10]= {"DEBUG", "INFO ", "WARN ", "ERROR"};
 #define CYAN        6
 #define WHITE       7
 
+/* records gathered in to a single writev */
+#define OCTO_LOG_BATCH 64
+
+/* longest the writer sleeps before looking for records again */
+#define OCTO_LOG_IDLE_NSEC 10000000
+
 void textcolor(FILE* stream, int attr, int fg, int bg)
 {
     fprintf(stream, "%c[%d;%dm", 0x1B, attr, fg+30);
 }
 
+/**
+ * a formatted line queued to a writer
+ */
+typedef struct octo_log_record
+{
+    octo_logger *logger;
+    int fd;
+    uint32_t len;
+    char line[OCTO_LOG_RECORD_SIZE - sizeof(octo_logger *) - 2*sizeof(uint32_t)];
+} octo_log_record;
+
+/**
+ * records one thread has queued to a writer
+ *
+ * a thread has one ring per writer so its lines stay in order. the ring
+ * is referenced by both the thread and the writer, when the thread exits
+ * the ring is retired and the writer lets go of it once it is empty.
+ * the records are freed when the writer lets go, the ring itself when
+ * both have.
+ */
+typedef struct octo_log_ring
+{
+    octo_spsc records;
+    octo_lfstack_node joining;
+    struct octo_log_ring *next;
+    struct octo_log_ring *thread_next;
+    uint64_t writer_id;
+    int refs;
+    bool retired;
+} octo_log_ring;
+
+/**
+ * rings of the writers the current thread has logged through
+ */
+static __thread octo_log_ring *octo_log_thread_rings;
+
+static pthread_key_t octo_log_thread_key;
+static pthread_once_t octo_log_thread_once = PTHREAD_ONCE_INIT;
+
+static uint64_t octo_log_writer_ids;
+
+/**
+ * the date and time zone of log lines formatted at most once a second
+ * in each thread, localtime_r and strftime cost far more than the rest
+ * of a log line
+ */
+static __thread struct
+{
+    time_t second;
+    size_t date_len;
+    size_t zone_len;
+    char date[48];
+    char zone[16];
+} octo_log_clock = { -1 };
+
+static const uint32_t octo_log_fraction_div[] =
+{
+    1000000000, 100000000, 10000000, 1000000, 100000, 10000, 1000, 100, 10, 1
+};
+
 /**
  * initialize a octo_logger
  */
@@ -35,12 +105,16 @@ void octo_logger_init(octo_logger *lgr, const char *name)
 {
     int i = 0;
     lgr->level = 0;
+    lgr->precision = 0;
     strncpy(lgr->name, name, sizeof(lgr->name)-1);
 
     for(i = 0; i < 4; ++i)
     {
         octo_list_init(&lgr->outs[i]);
     }
+    lgr->writer = NULL;
+    lgr->queued = 0;
+    lgr->done = 0;
 }
 
 /**
@@ -50,6 +124,8 @@ void octo_logger_destroy(octo_logger *lgr)
 {
     int i = 0;
 
+    octo_logger_set_writer(lgr, NULL);
+
     for(i = 0; i < 4; ++i)
     {
         octo_log_output *output;
@@ -109,6 +185,325 @@ void octo_logger_set_level(octo_logger *lgr, octo_log_level level)
     lgr->level = level;
 }
 
+/**
+ * get the number of sub-second digits in log line times
+ * @lgr: the octo_logger to get the precision from
+ */
+int octo_logger_precision(octo_logger *lgr)
+{
+    return lgr->precision;
+}
+
+/**
+ * set the number of sub-second digits in log line times
+ * @lgr: octo_logger to set the precision
+ * @precision: digits after the seconds, from 0 up to 9 for nanoseconds
+ */
+void octo_logger_set_precision(octo_logger *lgr, int precision)
+{
+    lgr->precision = max(0, min(precision, 9));
+}
+
+/**
+ * format the current time of a log line
+ * @when: buffer of at least 80 bytes to format the time in to
+ * @precision: digits after the seconds
+ *
+ * the date and time zone are only formatted again when the second
+ * changes, the fraction of a second is written out digit by digit.
+ */
+static void octo_logger_when(char *when, int precision)
+{
+    struct timespec now;
+    size_t len;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    if(now.tv_sec != octo_log_clock.second)
+    {
+        struct tm ts;
+        localtime_r(&now.tv_sec, &ts);
+        octo_log_clock.date_len = strftime(octo_log_clock.date, sizeof(octo_log_clock.date),
+            "%a %Y-%m-%d %H:%M:%S", &ts);
+        octo_log_clock.zone_len = strftime(octo_log_clock.zone, sizeof(octo_log_clock.zone),
+            " %Z", &ts);
+        octo_log_clock.second = now.tv_sec;
+    }
+
+    memcpy(when, octo_log_clock.date, octo_log_clock.date_len);
+    len = octo_log_clock.date_len;
+
+    if(precision > 0)
+    {
+        uint32_t fraction = now.tv_nsec/octo_log_fraction_div[precision];
+
+        when[len] = '.';
+        for(int i = precision; i > 0; --i)
+        {
+            when[len + i] = '0' + fraction%10;
+            fraction /= 10;
+        }
+        len += precision + 1;
+    }
+
+    memcpy(when + len, octo_log_clock.zone, octo_log_clock.zone_len);
+    when[len + octo_log_clock.zone_len] = '\0';
+}
+
+/**
+ * append to a line being formatted
+ * @buf: line being formatted
+ * @size: size of buf
+ * @len: length of the line so far, which may be more than fits in buf
+ * @fmt: format of what to append
+ * @args: args for fmt
+ *
+ * returns the length of the line as if nothing were cut short
+ */
+static size_t octo_logger_vappend(char *buf, size_t size, size_t len, const char *fmt, va_list args)
+{
+    int n = vsnprintf(len < size ? buf + len : NULL, len < size ? size - len : 0, fmt, args);
+    return n < 0 ? len : len + n;
+}
+
+static size_t octo_logger_append(char *buf, size_t size, size_t len, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    len = octo_logger_vappend(buf, size, len, fmt, args);
+    va_end(args);
+    return len;
+}
+
+static size_t octo_logger_textcolor(char *buf, size_t size, size_t len, int attr, int fg)
+{
+    return octo_logger_append(buf, size, len, "%c[%d;%dm", 0x1B, attr, fg+30);
+}
+
+/**
+ * format a whole log line
+ * @buf: buffer to format the line in to
+ * @size: size of buf
+ * @lgr: octo_logger the line is logged to
+ * @level: level the line is logged at
+ * @where: string containing where the log message is coming from
+ * @colorize: whether the line is written to a terminal in color
+ * @when: formatted time of the log message
+ * @fmt: formatted log message
+ * @args: args for formatted log message
+ *
+ * returns the length of the line, if it is size or more the line was
+ * cut short to fit in buf
+ */
+static size_t octo_logger_format(char *buf, size_t size, octo_logger *lgr, octo_log_level level,
+        const char *where, bool colorize, const char *when, const char *fmt, va_list args)
+{
+    size_t len = 0;
+
+    if(colorize)
+    {
+        int color = YELLOW;
+        if(level == LOG_DEBUG)
+            color = GREEN;
+        else if(level == LOG_INFO)
+            color = CYAN;
+        else if(level == LOG_WARN)
+            color = YELLOW;
+        else if(level == LOG_ERROR)
+            color = RED;
+
+        len = octo_logger_append(buf, size, len, "[");
+        len = octo_logger_textcolor(buf, size, len, BRIGHT, MAGENTA);
+        len = octo_logger_append(buf, size, len, "%s", lgr->name);
+        len = octo_logger_textcolor(buf, size, len, RESET, WHITE);
+        len = octo_logger_append(buf, size, len, "][");
+        len = octo_logger_textcolor(buf, size, len, BRIGHT, color);
+        len = octo_logger_append(buf, size, len, "%5s", LVLSTR[level]);
+        len = octo_logger_textcolor(buf, size, len, RESET, WHITE);
+        len = octo_logger_append(buf, size, len, " %18s]", where);
+    }
+    else
+    {
+        len = octo_logger_append(buf, size, len, "[%5s - %18s]", LVLSTR[level], where);
+    }
+
+    len = octo_logger_append(buf, size, len, " :: %s :: ", when);
+    len = octo_logger_vappend(buf, size, len, fmt, args);
+    return octo_logger_append(buf, size, len, "\n");
+}
+
+/**
+ * write a log line to an output straight away
+ */
+static void octo_logger_write(octo_logger *lgr, octo_log_output *output, octo_log_level level,
+        const char *where, const char *when, const char *fmt, va_list args)
+{
+    char line[OCTO_LOG_RECORD_SIZE];
+    va_list line_args;
+    size_t len;
+
+    va_copy(line_args, args);
+    len = octo_logger_format(line, sizeof(line), lgr, level, where, output->colorize, when, fmt, line_args);
+    va_end(line_args);
+
+    if(len < sizeof(line))
+    {
+        fwrite(line, 1, len, output->stream);
+    }
+    else
+    {
+        char *long_line = malloc(len + 1);
+        if(long_line != NULL)
+        {
+            va_copy(line_args, args);
+            octo_logger_format(long_line, len + 1, lgr, level, where, output->colorize, when, fmt, line_args);
+            va_end(line_args);
+            fwrite(long_line, 1, len, output->stream);
+            free(long_line);
+        }
+    }
+    fflush(output->stream);
+}
+
+/**
+ * wake the writer thread if it is sleeping
+ *
+ * only the first thread to see the writer sleeping signals it. the writer
+ * may miss a wake up given just as it goes to sleep, it then finds the
+ * record when its sleep times out.
+ */
+static inline void octo_log_writer_wake(octo_log_writer *writer)
+{
+    if(__atomic_load_n(&writer->sleeping, __ATOMIC_RELAXED)
+        && __atomic_exchange_n(&writer->sleeping, false, __ATOMIC_ACQ_REL))
+    {
+        pthread_cond_signal(&writer->wake);
+    }
+}
+
+/**
+ * drop a reference to a ring, freeing it with the last one
+ */
+static void octo_log_ring_unref(octo_log_ring *ring)
+{
+    if(__atomic_sub_fetch(&ring->refs, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        free(ring);
+    }
+}
+
+/**
+ * retire the rings of an exiting thread
+ */
+static void octo_log_thread_exit(void *rings)
+{
+    octo_log_ring *ring = rings;
+
+    while(ring != NULL)
+    {
+        octo_log_ring *next = ring->thread_next;
+        __atomic_store_n(&ring->retired, true, __ATOMIC_RELEASE);
+        octo_log_ring_unref(ring);
+        ring = next;
+    }
+    octo_log_thread_rings = NULL;
+}
+
+static void octo_log_thread_key_create()
+{
+    pthread_key_create(&octo_log_thread_key, octo_log_thread_exit);
+}
+
+/**
+ * find or make the current thread's ring for a writer
+ *
+ * returns NULL if no memory could be allocated for a new ring.
+ */
+static octo_log_ring * octo_log_thread_ring(octo_log_writer *writer)
+{
+    octo_log_ring *ring;
+
+    for(ring = octo_log_thread_rings; ring != NULL; ring = ring->thread_next)
+    {
+        if(ring->writer_id == writer->id)
+        {
+            return ring;
+        }
+    }
+
+    if(posix_memalign((void **)&ring, 64, sizeof(octo_log_ring)) != 0)
+    {
+        return NULL;
+    }
+    if(!octo_spsc_init(&ring->records, writer->capacity, sizeof(octo_log_record)))
+    {
+        free(ring);
+        return NULL;
+    }
+    ring->writer_id = writer->id;
+    ring->refs = 2;
+    ring->retired = false;
+
+    /* the key's destructor retires the rings when the thread exits */
+    pthread_once(&octo_log_thread_once, octo_log_thread_key_create);
+    ring->thread_next = octo_log_thread_rings;
+    octo_log_thread_rings = ring;
+    pthread_setspecific(octo_log_thread_key, ring);
+
+    octo_lfstack_push(&writer->joining, &ring->joining);
+    return ring;
+}
+
+/**
+ * format a log line in to a record of the current thread's ring for the
+ * logger's writer
+ */
+static void octo_logger_queue(octo_logger *lgr, octo_log_output *output, octo_log_level level,
+        const char *where, const char *when, const char *fmt, va_list args)
+{
+    octo_log_writer *writer = lgr->writer;
+    octo_log_ring *ring = octo_log_thread_ring(writer);
+    octo_log_record *record;
+    va_list line_args;
+    size_t len;
+
+    if(ring == NULL)
+    {
+        __atomic_fetch_add(&writer->dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    while((record = octo_spsc_reserve(&ring->records)) == NULL)
+    {
+        octo_log_writer_wake(writer);
+        if(writer->policy == LOG_DROP)
+        {
+            __atomic_fetch_add(&writer->dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        sched_yield();
+    }
+
+    va_copy(line_args, args);
+    len = octo_logger_format(record->line, sizeof(record->line), lgr, level, where,
+        output->colorize, when, fmt, line_args);
+    va_end(line_args);
+
+    /* a line cut short still ends the line */
+    if(len >= sizeof(record->line))
+    {
+        len = sizeof(record->line);
+        record->line[len - 1] = '\n';
+    }
+
+    record->logger = lgr;
+    record->fd = fileno(output->stream);
+    record->len = len;
+    __atomic_add_fetch(&lgr->queued, 1, __ATOMIC_RELAXED);
+    octo_spsc_commit(&ring->records);
+    octo_log_writer_wake(writer);
+}
+
 /**
  * private function to log to a specific level
  * @lgr: octo_logger to log to
@@ -119,55 +514,351 @@ void octo_logger_set_level(octo_logger *lgr, octo_log_level level)
  */
 void octo_logger_log(octo_logger *lgr, octo_log_level level, const char *where, const char *fmt, ...)
 {
-    static char buf[80]; /* allocate a single one time buffer for time printouts */
-    time_t now;
-    struct tm *ts;
+    char when[80];
     va_list args;
     va_start(args, fmt);
 
     if(lgr->level <= level)
     {
-        int color = YELLOW;
-        now = time(NULL);
-        ts = localtime(&now);
-        strftime(buf, sizeof(buf), "%a %Y-%m-%d %H:%M:%S %Z", ts);
-    
+        octo_logger_when(when, lgr->precision);
+
         octo_log_output *output;
         octo_log_output *next;
         octo_list_foreach(output, next, &lgr->outs[level], list)
         {
-            if(output->colorize)
+            if(lgr->writer != NULL)
             {
-                fprintf(output->stream, "[");
-                textcolor(output->stream, BRIGHT, MAGENTA, BLACK);
-                fprintf(output->stream, "%s", lgr->name);
-                textcolor(output->stream, RESET, WHITE, BLACK);
-                fprintf(output->stream, "]");
-
-                fprintf(output->stream, "[");
-                if(level == LOG_DEBUG)
-                    color = GREEN;
-                else if(level == LOG_INFO)
-                    color = CYAN;
-                else if(level == LOG_WARN)
-                    color = YELLOW;
-                else if(level == LOG_ERROR)
-                    color = RED;
-                textcolor(output->stream, BRIGHT, color, BLACK);
-                fprintf(output->stream, "%5s", LVLSTR[level]);
-                textcolor(output->stream, RESET, WHITE, BLACK);
-                fprintf(output->stream, " %18s]", where);
+                octo_logger_queue(lgr, output, level, where, when, fmt, args);
             }
             else
             {
-                fprintf(output->stream, "[%5s - %18s]", LVLSTR[level], where);
+                octo_logger_write(lgr, output, level, where, when, fmt, args);
             }
+        }
+    }
+    va_end(args);
+}
 
-            fprintf(output->stream, " :: %s :: ", buf);
-            vfprintf(output->stream, fmt, args);
-            fprintf(output->stream, "\n");
+/**
+ * wait for the writer to take every line the logger has queued to it
+ */
+static void octo_logger_drain(octo_logger *lgr)
+{
+    octo_log_writer *writer = lgr->writer;
+
+    pthread_mutex_lock(&writer->lock);
+    writer->draining += 1;
+    while(__atomic_load_n(&lgr->done, __ATOMIC_ACQUIRE) != __atomic_load_n(&lgr->queued, __ATOMIC_RELAXED))
+    {
+        pthread_cond_signal(&writer->wake);
+        pthread_cond_wait(&writer->drained, &writer->lock);
+    }
+    writer->draining -= 1;
+    pthread_mutex_unlock(&writer->lock);
+}
+
+/**
+ * log through a writer thread rather than writing to the outputs from
+ * the logging thread
+ * @lgr: octo_logger to log through the writer
+ * @writer: octo_log_writer to queue lines to, or NULL to write lines
+ *          straight away again
+ */
+void octo_logger_set_writer(octo_logger *lgr, octo_log_writer *writer)
+{
+    int i = 0;
+
+    /* lines queued to the old writer go out before anything after them,
+     * and before the files they are bound for may be closed */
+    if(lgr->writer != NULL)
+    {
+        octo_logger_drain(lgr);
+    }
+
+    /* lines already buffered by stdio go out before any from the writer */
+    for(i = 0; i < 4; ++i)
+    {
+        octo_log_output *output;
+        octo_log_output *next;
+
+        octo_list_foreach(output, next, &lgr->outs[i], list)
+        {
             fflush(output->stream);
         }
     }
-    va_end(args);
+    lgr->writer = writer;
+}
+
+/**
+ * write a batch of records to a file
+ *
+ * returns the number of records written in whole.
+ */
+static size_t octo_log_writev(int fd, struct iovec *iov, size_t n)
+{
+    size_t done = 0;
+
+    while(done < n)
+    {
+        ssize_t written = writev(fd, iov + done, n - done);
+
+        if(written < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+
+        while(done < n && (size_t)written >= iov[done].iov_len)
+        {
+            written -= iov[done].iov_len;
+            done += 1;
+        }
+        if(done < n)
+        {
+            iov[done].iov_base = (char *)iov[done].iov_base + written;
+            iov[done].iov_len -= written;
+        }
+    }
+    return done;
+}
+
+/**
+ * write every record in a ring, a run of records for the same file at a
+ * time
+ *
+ * returns the number of records taken from the ring.
+ */
+static size_t octo_log_writer_drain(octo_log_writer *writer, octo_log_ring *ring)
+{
+    struct iovec iov[OCTO_LOG_BATCH];
+    octo_logger *loggers[OCTO_LOG_BATCH];
+    octo_log_record *record;
+    size_t taken = 0;
+
+    while((record = octo_spsc_peek(&ring->records)) != NULL)
+    {
+        int fd = record->fd;
+        size_t n = 0;
+        size_t written;
+
+        do
+        {
+            iov[n].iov_base = record->line;
+            iov[n].iov_len = record->len;
+            loggers[n] = record->logger;
+            n += 1;
+        } while(n < OCTO_LOG_BATCH
+            && (record = octo_spsc_peek_at(&ring->records, n)) != NULL
+            && record->fd == fd);
+
+        written = octo_log_writev(fd, iov, n);
+        octo_spsc_release_n(&ring->records, n);
+
+        for(size_t i = 0, run = 1; i < n; i += run, run = 1)
+        {
+            while(i + run < n && loggers[i + run] == loggers[i])
+            {
+                run += 1;
+            }
+            __atomic_add_fetch(&loggers[i]->done, run, __ATOMIC_RELEASE);
+        }
+
+        __atomic_fetch_add(&writer->written, written, __ATOMIC_RELAXED);
+        if(written < n)
+        {
+            __atomic_fetch_add(&writer->dropped, n - written, __ATOMIC_RELAXED);
+        }
+        taken += n;
+    }
+    return taken;
+}
+
+/**
+ * let go of a ring, freeing its records
+ */
+static void octo_log_writer_release(octo_log_ring *ring)
+{
+    octo_spsc_destroy(&ring->records);
+    octo_log_ring_unref(ring);
+}
+
+/**
+ * writer thread, drains every ring until none has records and then
+ * sleeps until woken by a logging thread
+ *
+ * threads waiting for a logger to be drained are woken after every pass
+ * over the rings.
+ */
+static void * octo_log_writer_run(void *arg)
+{
+    octo_log_writer *writer = arg;
+    bool stopping = false;
+
+    while(true)
+    {
+        octo_lfstack_node *node = octo_lfstack_pop_all(&writer->joining);
+        octo_log_ring **link = &writer->rings;
+        octo_log_ring *ring;
+        size_t taken = 0;
+
+        while(node != NULL)
+        {
+            ring = ptr_offset(node, octo_log_ring, joining);
+            node = node->next;
+            ring->next = writer->rings;
+            writer->rings = ring;
+        }
+
+        while((ring = *link) != NULL)
+        {
+            taken += octo_log_writer_drain(writer, ring);
+
+            /* the ring of a thread that has exited goes once it's empty */
+            if(__atomic_load_n(&ring->retired, __ATOMIC_ACQUIRE)
+                && octo_spsc_peek(&ring->records) == NULL)
+            {
+                *link = ring->next;
+                octo_log_writer_release(ring);
+                continue;
+            }
+            link = &ring->next;
+        }
+
+        if(__atomic_load_n(&writer->draining, __ATOMIC_RELAXED) > 0)
+        {
+            pthread_mutex_lock(&writer->lock);
+            pthread_cond_broadcast(&writer->drained);
+            pthread_mutex_unlock(&writer->lock);
+        }
+
+        if(taken > 0)
+        {
+            continue;
+        }
+
+        /* one more pass after being stopped finds the last records */
+        if(stopping)
+        {
+            break;
+        }
+
+        pthread_mutex_lock(&writer->lock);
+        if(!writer->running)
+        {
+            stopping = true;
+        }
+        else
+        {
+            struct timespec until;
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_nsec += OCTO_LOG_IDLE_NSEC;
+            if(until.tv_nsec >= 1000000000)
+            {
+                until.tv_sec += 1;
+                until.tv_nsec -= 1000000000;
+            }
+
+            if(writer->draining > 0)
+            {
+                pthread_cond_broadcast(&writer->drained);
+            }
+
+            __atomic_store_n(&writer->sleeping, true, __ATOMIC_SEQ_CST);
+            pthread_cond_timedwait(&writer->wake, &writer->lock, &until);
+            __atomic_store_n(&writer->sleeping, false, __ATOMIC_RELAXED);
+        }
+        pthread_mutex_unlock(&writer->lock);
+    }
+    return NULL;
+}
+
+/**
+ * initialize an octo_log_writer and start its thread
+ * @writer: octo_log_writer to initialize
+ * @capacity: records each logging thread may have queued
+ * @policy: what a thread logging to a full ring does
+ *
+ * returns false if the thread could not be started.
+ */
+bool octo_log_writer_init(octo_log_writer *writer, size_t capacity, octo_log_policy policy)
+{
+    writer->id = __atomic_add_fetch(&octo_log_writer_ids, 1, __ATOMIC_RELAXED);
+    writer->capacity = capacity;
+    writer->policy = policy;
+    octo_lfstack_init(&writer->joining);
+    writer->rings = NULL;
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->wake, NULL);
+    pthread_cond_init(&writer->drained, NULL);
+    writer->draining = 0;
+    writer->running = true;
+    writer->sleeping = false;
+    writer->written = 0;
+    writer->dropped = 0;
+
+    if(pthread_create(&writer->thread, NULL, octo_log_writer_run, writer) != 0)
+    {
+        pthread_cond_destroy(&writer->drained);
+        pthread_cond_destroy(&writer->wake);
+        pthread_mutex_destroy(&writer->lock);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * write every queued line, stop the writer thread and let go of the rings
+ * of the threads that logged through it
+ *
+ * every logger using the writer must have been destroyed or set to
+ * another writer first.
+ */
+void octo_log_writer_destroy(octo_log_writer *writer)
+{
+    octo_lfstack_node *node;
+
+    pthread_mutex_lock(&writer->lock);
+    writer->running = false;
+    pthread_cond_signal(&writer->wake);
+    pthread_mutex_unlock(&writer->lock);
+    pthread_join(writer->thread, NULL);
+
+    while(writer->rings != NULL)
+    {
+        octo_log_ring *ring = writer->rings;
+        writer->rings = ring->next;
+        octo_log_writer_release(ring);
+    }
+
+    /* rings of threads that only got as far as joining */
+    node = octo_lfstack_pop_all(&writer->joining);
+    while(node != NULL)
+    {
+        octo_log_ring *ring = ptr_offset(node, octo_log_ring, joining);
+        node = node->next;
+        octo_log_writer_release(ring);
+    }
+
+    pthread_cond_destroy(&writer->drained);
+    pthread_cond_destroy(&writer->wake);
+    pthread_mutex_destroy(&writer->lock);
+}
+
+/**
+ * number of lines the writer has written
+ */
+uint64_t octo_log_writer_written(octo_log_writer *writer)
+{
+    return __atomic_load_n(&writer->written, __ATOMIC_RELAXED);
+}
+
+/**
+ * number of lines dropped because a ring was full or a write failed
+ */
+uint64_t octo_log_writer_dropped(octo_log_writer *writer)
+{
+    return __atomic_load_n(&writer->dropped, __ATOMIC_RELAXED);
 }
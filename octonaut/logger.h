@@ -28,7 +28,16 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <pthread.h>
 #include "list.h"
+#include "lflist.h"
+
+/**
+ * bytes of a formatted line queued to an octo_log_writer, a longer line
+ * is cut short
+ */
+#define OCTO_LOG_RECORD_SIZE 512
 
 typedef enum _octo_log_level
 {
@@ -45,11 +54,64 @@ typedef struct octo_log_output
     FILE* stream;
 } octo_log_output;
 
+/**
+ * what a thread logging to a full octo_log_writer does
+ *
+ * LOG_DROP counts the line as dropped and carries on, so logging never
+ * waits on the writer. LOG_BLOCK waits for the writer to make room, and
+ * so should not be used from an event loop.
+ */
+typedef enum _octo_log_policy
+{
+    LOG_DROP,
+    LOG_BLOCK
+} octo_log_policy;
+
+/**
+ * background thread writing the lines of asynchronous loggers
+ *
+ * each thread logging through the writer formats its lines in to a ring
+ * of preallocated records of its own, an octo_spsc shared only with the
+ * writer thread, so logging takes no locks. the only system call is the
+ * futex wake of pthread_cond_signal, made by the first line queued after
+ * the writer went to sleep. the writer thread gathers runs of records
+ * bound for the same file in to a single writev. lines of one thread are
+ * written in the order they were logged, lines of different threads may
+ * be interleaved.
+ *
+ * a thread's ring is made the first time it logs through a writer. it is
+ * freed once the thread has exited and the writer has emptied it, or when
+ * the writer is destroyed. loggers wait for their queued lines to be
+ * written when they are destroyed or set to another writer, and must be
+ * before the writer is destroyed.
+ */
+typedef struct octo_log_writer
+{
+    uint64_t id;
+    size_t capacity;
+    octo_log_policy policy;
+    octo_lfstack joining;
+    struct octo_log_ring *rings;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t drained;
+    int draining;
+    bool running;
+    bool sleeping;
+    uint64_t written;
+    uint64_t dropped;
+} octo_log_writer;
+
 typedef struct octo_logger
 {
     char name[10];
     octo_log_level level;
+    int precision;
     octo_list outs[4];
+    octo_log_writer *writer;
+    uint64_t queued;
+    uint64_t done;
 } octo_logger;
 
 void octo_logger_init(octo_logger *lgr, const char *name);
@@ -60,8 +122,19 @@ void octo_logger_add_output(octo_logger *lgr, octo_log_level level, FILE* stream
 octo_log_level octo_logger_level(octo_logger *lgr);
 void octo_logger_set_level(octo_logger *lgr, octo_log_level level);
 
+int octo_logger_precision(octo_logger *lgr);
+void octo_logger_set_precision(octo_logger *lgr, int precision);
+
 void octo_logger_log(octo_logger *lgr, octo_log_level level, const char *where, const char *fmt, ...);
 
+void octo_logger_set_writer(octo_logger *lgr, octo_log_writer *writer);
+
+bool octo_log_writer_init(octo_log_writer *writer, size_t capacity, octo_log_policy policy);
+void octo_log_writer_destroy(octo_log_writer *writer);
+
+uint64_t octo_log_writer_written(octo_log_writer *writer);
+uint64_t octo_log_writer_dropped(octo_log_writer *writer);
+
 #define octo_plogger_debug(logger, ...) \
     octo_logger_log(logger, LOG_DEBUG, __func__, __VA_ARGS__)
 
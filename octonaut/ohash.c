@@ -0,0 +1,359 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <memory.h>
+#include <assert.h>
+#include <limits.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "common.h"
+
+#include "ohash.h"
+
+#define OCTO_OHASH_GROUP 16
+#define OCTO_OHASH_EMPTY ((int8_t)-128)
+#define OCTO_OHASH_DELETED ((int8_t)-2)
+
+/**
+ * hash a key, inlining octo_hash_short for short keys of the default
+ * hash function
+ */
+static inline uint32_t octo_ohash_hash(const octo_ohash *hashtable, void *key, size_t keylen)
+{
+    if(hashtable->hash_function == octo_default_hash_function && keylen <= OCTO_HASH_SHORT_MAX)
+    {
+        return octo_hash_short(key, keylen, hashtable->hash_seed);
+    }
+    return hashtable->hash_function(key, keylen, hashtable->hash_seed);
+}
+
+/**
+ * 7 bits of the hash kept in the control byte
+ */
+static inline int8_t octo_ohash_h2(uint32_t keyhash)
+{
+    return keyhash & 0x7f;
+}
+
+/**
+ * the rest of the hash picks the first group to probe
+ */
+static inline uint32_t octo_ohash_h1(uint32_t keyhash)
+{
+    return keyhash >> 7;
+}
+
+/**
+ * bit mask of the control bytes in the group at pos equal to h
+ */
+static inline uint32_t octo_ohash_match(const int8_t *ctrl, int8_t h)
+{
+#ifdef __SSE2__
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h), group));
+#else
+    uint32_t mask = 0;
+    for(int i = 0; i < OCTO_OHASH_GROUP; ++i)
+    {
+        mask |= (uint32_t)(ctrl[i] == h) << i;
+    }
+    return mask;
+#endif
+}
+
+/**
+ * bit mask of the control bytes in the group at pos that are empty or
+ * deleted, both have their high bit set while full slots don't
+ */
+static inline uint32_t octo_ohash_match_free(const int8_t *ctrl)
+{
+#ifdef __SSE2__
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return _mm_movemask_epi8(group);
+#else
+    uint32_t mask = 0;
+    for(int i = 0; i < OCTO_OHASH_GROUP; ++i)
+    {
+        mask |= (uint32_t)(ctrl[i] < 0) << i;
+    }
+    return mask;
+#endif
+}
+
+/**
+ * set the control byte of a slot, the first group of control bytes is
+ * repeated after the last so a group can be loaded from any slot
+ */
+static inline void octo_ohash_set_ctrl(octo_ohash *hashtable, uint32_t slot, int8_t h)
+{
+    hashtable->ctrl[slot] = h;
+    if(slot < OCTO_OHASH_GROUP)
+    {
+        hashtable->ctrl[hashtable->n_slots + slot] = h;
+    }
+}
+
+/**
+ * slots that may be filled before the table has to grow
+ */
+static inline size_t octo_ohash_max_load(uint32_t n_slots)
+{
+    return n_slots - n_slots/8;
+}
+
+/**
+ * find the slot holding a key or return -1
+ *
+ * groups are probed at triangular offsets which visits every group of a
+ * power of 2 table.
+ */
+static inline int64_t octo_ohash_find(octo_ohash *hashtable, uint32_t keyhash,
+        void *key, size_t keylen)
+{
+    uint32_t mask = hashtable->n_slots - 1;
+    uint32_t pos = octo_ohash_h1(keyhash) & mask;
+    int8_t h2 = octo_ohash_h2(keyhash);
+
+    for(uint32_t step = OCTO_OHASH_GROUP; ; step += OCTO_OHASH_GROUP)
+    {
+        const int8_t *ctrl = &hashtable->ctrl[pos];
+        uint32_t match = octo_ohash_match(ctrl, h2);
+
+        while(match)
+        {
+            uint32_t slot = (pos + __builtin_ctz(match)) & mask;
+            octo_hash_entry *entry = hashtable->slots[slot];
+
+            if(entry->hash == keyhash && entry->keylen == keylen
+                    && memcmp(entry->key, key, keylen) == 0)
+            {
+                return slot;
+            }
+            match &= match - 1;
+        }
+
+        /* an empty slot ends the probe, the key would have been put there */
+        if(octo_ohash_match(ctrl, OCTO_OHASH_EMPTY))
+        {
+            return -1;
+        }
+
+        if(step > hashtable->n_slots)
+        {
+            return -1;
+        }
+
+        pos = (pos + step) & mask;
+    }
+}
+
+/**
+ * find the first empty or deleted slot for a hash
+ */
+static inline uint32_t octo_ohash_find_free(octo_ohash *hashtable, uint32_t keyhash)
+{
+    uint32_t mask = hashtable->n_slots - 1;
+    uint32_t pos = octo_ohash_h1(keyhash) & mask;
+
+    for(uint32_t step = OCTO_OHASH_GROUP; ; step += OCTO_OHASH_GROUP)
+    {
+        uint32_t match = octo_ohash_match_free(&hashtable->ctrl[pos]);
+
+        if(match)
+        {
+            return (pos + __builtin_ctz(match)) & mask;
+        }
+
+        pos = (pos + step) & mask;
+    }
+}
+
+/**
+ * allocate empty control bytes and slots
+ */
+static bool octo_ohash_alloc(octo_ohash *hashtable, uint32_t n_slots)
+{
+    int8_t *ctrl = malloc(n_slots + OCTO_OHASH_GROUP);
+    octo_hash_entry **slots = malloc(sizeof(octo_hash_entry *)*n_slots);
+
+    if(ctrl == NULL || slots == NULL)
+    {
+        free(ctrl);
+        free(slots);
+        return false;
+    }
+
+    memset(ctrl, OCTO_OHASH_EMPTY, n_slots + OCTO_OHASH_GROUP);
+
+    hashtable->ctrl = ctrl;
+    hashtable->slots = slots;
+    hashtable->n_slots = n_slots;
+    hashtable->growth_left = octo_ohash_max_load(n_slots) - hashtable->size;
+    return true;
+}
+
+/**
+ * move every entry in to a new set of slots, twice as many unless
+ * deleted slots are what filled the table up
+ */
+static bool octo_ohash_rehash(octo_ohash *hashtable)
+{
+    int8_t *ctrl = hashtable->ctrl;
+    octo_hash_entry **slots = hashtable->slots;
+    uint32_t n_slots = hashtable->n_slots;
+    uint32_t new_slots = n_slots;
+
+    if(hashtable->size >= octo_ohash_max_load(n_slots)/2)
+    {
+        new_slots = n_slots*2;
+    }
+
+    if(new_slots == 0 || !octo_ohash_alloc(hashtable, new_slots))
+    {
+        hashtable->ctrl = ctrl;
+        hashtable->slots = slots;
+        hashtable->n_slots = n_slots;
+        return false;
+    }
+
+    for(uint32_t i = 0; i < n_slots; ++i)
+    {
+        if(ctrl[i] >= 0)
+        {
+            octo_hash_entry *entry = slots[i];
+            uint32_t slot = octo_ohash_find_free(hashtable, entry->hash);
+
+            octo_ohash_set_ctrl(hashtable, slot, octo_ohash_h2(entry->hash));
+            hashtable->slots[slot] = entry;
+        }
+    }
+
+    free(ctrl);
+    free(slots);
+    return true;
+}
+
+void octo_ohash_init(octo_ohash *hashtable, octo_hash_function hash_function, uint32_t seed, size_t pow2size)
+{
+    /* slots are picked with 32 bit hashes and counted in a size_t */
+    assert(pow2size < 32 && pow2size < sizeof(size_t)*CHAR_BIT);
+    hashtable->hash_function = hash_function;
+    hashtable->hash_seed = seed;
+    hashtable->size = 0;
+
+    bool allocated = octo_ohash_alloc(hashtable, (size_t)1 << max(pow2size, 4));
+    assert(allocated);
+    (void)allocated;
+
+    assert(power_of_two(hashtable->n_slots));
+}
+
+void octo_ohash_destroy(octo_ohash *hashtable)
+{
+    hashtable->hash_function = NULL;
+    hashtable->hash_seed = 0;
+    hashtable->n_slots = 0;
+    hashtable->growth_left = 0;
+    free(hashtable->ctrl);
+    hashtable->ctrl = NULL;
+    free(hashtable->slots);
+    hashtable->slots = NULL;
+    hashtable->size = 0;
+}
+
+size_t octo_ohash_size(const octo_ohash *hashtable)
+{
+    return hashtable->size;
+}
+
+bool octo_ohash_has(octo_ohash *hashtable, void *key, size_t keylen)
+{
+    uint32_t keyhash = octo_ohash_hash(hashtable, key, keylen);
+    return octo_ohash_find(hashtable, keyhash, key, keylen) != -1;
+}
+
+bool octo_ohash_put(octo_ohash *hashtable, octo_hash_entry *entry)
+{
+    uint32_t keyhash = octo_ohash_hash(hashtable, entry->key, entry->keylen);
+
+    if(octo_ohash_find(hashtable, keyhash, entry->key, entry->keylen) != -1)
+    {
+        return false;
+    }
+
+    uint32_t slot = octo_ohash_find_free(hashtable, keyhash);
+
+    /* reusing a deleted slot doesn't use up any room */
+    if(hashtable->growth_left == 0 && hashtable->ctrl[slot] == OCTO_OHASH_EMPTY)
+    {
+        if(!octo_ohash_rehash(hashtable))
+        {
+            return false;
+        }
+        slot = octo_ohash_find_free(hashtable, keyhash);
+    }
+
+    if(hashtable->ctrl[slot] == OCTO_OHASH_EMPTY)
+    {
+        hashtable->growth_left -= 1;
+    }
+
+    entry->hash = keyhash;
+    octo_ohash_set_ctrl(hashtable, slot, octo_ohash_h2(keyhash));
+    hashtable->slots[slot] = entry;
+    hashtable->size += 1;
+    return true;
+}
+
+octo_hash_entry * octo_ohash_get(octo_ohash *hashtable, void *key, size_t keylen)
+{
+    uint32_t keyhash = octo_ohash_hash(hashtable, key, keylen);
+    int64_t slot = octo_ohash_find(hashtable, keyhash, key, keylen);
+
+    if(slot == -1)
+    {
+        return NULL;
+    }
+    return hashtable->slots[slot];
+}
+
+octo_hash_entry * octo_ohash_pop(octo_ohash *hashtable, void *key, size_t keylen)
+{
+    uint32_t keyhash = octo_ohash_hash(hashtable, key, keylen);
+    int64_t slot = octo_ohash_find(hashtable, keyhash, key, keylen);
+    octo_hash_entry *entry;
+
+    if(slot == -1)
+    {
+        return NULL;
+    }
+
+    /* deleted rather than empty so probes for other keys carry on past */
+    entry = hashtable->slots[slot];
+    octo_ohash_set_ctrl(hashtable, slot, OCTO_OHASH_DELETED);
+    hashtable->size -= 1;
+    return entry;
+}
@@ -0,0 +1,101 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef OCTO_OHASH_H
+#define OCTO_OHASH_H
+
+#include "hash_function.h"
+#include "hash.h"
+
+#include <stdbool.h>
+
+/**
+ * intrusive open addressing hash table store.
+ *
+ * the open addressing sibling of octo_hash, with the same entries and
+ * the same put, get, pop, and has semantics.
+ *
+ * slots are grouped 16 at a time with a control byte per slot holding
+ * 7 bits of the hash of its entry, or marking it empty or deleted. a
+ * lookup compares the 7 bits against a whole group of control bytes at
+ * once (with SSE2 when available) and only looks at entries whose bits
+ * match, so most lookups touch one group of control bytes and one entry.
+ *
+ * unlike octo_hash the table grows once it is 7/8 full. like octo_hash
+ * the hash of each key is kept in its entry so growing never hashes a
+ * key again.
+ */
+typedef struct octo_ohash
+{
+    octo_hash_function hash_function;
+    uint32_t hash_seed;
+    uint32_t n_slots;
+    size_t size;
+    size_t growth_left;
+    int8_t *ctrl;
+    octo_hash_entry **slots;
+} octo_ohash;
+
+/**
+ * initialize a hash table with room for 2^pow2size slots, at least 16
+ *
+ * pow2size must be less than 32 and less than the bits in a size_t.
+ */
+void octo_ohash_init(octo_ohash *hashtable,
+        octo_hash_function hash_function, uint32_t seed, size_t pow2size);
+
+/**
+ * destroy a hash table
+ */
+void octo_ohash_destroy(octo_ohash *hashtable);
+
+/**
+ * size of a hash table
+ */
+size_t octo_ohash_size(const octo_ohash *hashtable);
+
+/**
+ * check if a hash table has a key
+ */
+bool octo_ohash_has(octo_ohash *hashtable, void *key, size_t keylen);
+
+/**
+ * put an entry in to the hash table
+ *
+ * returns true if put succeeded, false if the key already existed or
+ * the table could not grow
+ */
+bool octo_ohash_put(octo_ohash *hashtable, octo_hash_entry *entry);
+
+/**
+ * get an entry from the hash table
+ */
+octo_hash_entry * octo_ohash_get(octo_ohash *hashtable,
+        void *key, size_t keylen);
+
+/**
+ * get and remove an entry from the hash table
+ */
+octo_hash_entry * octo_ohash_pop(octo_ohash *hashtable,
+        void *key, size_t keylen);
+
+#endif
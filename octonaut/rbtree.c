@@ -0,0 +1,471 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+
+#include "rbtree.h"
+
+inline void octo_rbtree_init(octo_rbtree *tree, octo_rbtree_eq eq, octo_rbtree_lt lt)
+{
+    tree->eq_function = eq;
+    tree->lt_function = lt;
+    tree->root = NULL;
+    tree->size = 0;
+}
+
+inline void octo_rbtree_destroy(octo_rbtree *tree)
+{
+    tree->root = NULL;
+    tree->size = 0;
+}
+
+inline size_t octo_rbtree_size(const octo_rbtree *tree)
+{
+    return tree->size;
+}
+
+inline bool octo_rbtree_empty(const octo_rbtree *tree)
+{
+    return tree->root == NULL;
+}
+
+static inline bool octo_rbtree_is_red(octo_rbtree_entry *entry)
+{
+    return entry != NULL && entry->red;
+}
+
+/**
+ * put new in old's place under old's parent
+ */
+static inline void octo_rbtree_replace(octo_rbtree *tree, octo_rbtree_entry *old,
+        octo_rbtree_entry *new, octo_rbtree_entry *parent)
+{
+    if(parent == NULL)
+    {
+        tree->root = new;
+    }
+    else if(parent->lchild == old)
+    {
+        parent->lchild = new;
+    }
+    else
+    {
+        parent->rchild = new;
+    }
+}
+
+/**
+ * rotate entry down to the left, its right child takes its place
+ */
+static void octo_rbtree_rotate_left(octo_rbtree *tree, octo_rbtree_entry *entry)
+{
+    octo_rbtree_entry *child = entry->rchild;
+
+    entry->rchild = child->lchild;
+    if(child->lchild != NULL)
+    {
+        child->lchild->parent = entry;
+    }
+    child->parent = entry->parent;
+    octo_rbtree_replace(tree, entry, child, entry->parent);
+    child->lchild = entry;
+    entry->parent = child;
+}
+
+/**
+ * rotate entry down to the right, its left child takes its place
+ */
+static void octo_rbtree_rotate_right(octo_rbtree *tree, octo_rbtree_entry *entry)
+{
+    octo_rbtree_entry *child = entry->lchild;
+
+    entry->lchild = child->rchild;
+    if(child->rchild != NULL)
+    {
+        child->rchild->parent = entry;
+    }
+    child->parent = entry->parent;
+    octo_rbtree_replace(tree, entry, child, entry->parent);
+    child->rchild = entry;
+    entry->parent = child;
+}
+
+static inline octo_rbtree_entry * octo_rbtree_leftmost(octo_rbtree_entry *entry)
+{
+    while(entry->lchild != NULL)
+    {
+        entry = entry->lchild;
+    }
+    return entry;
+}
+
+static inline octo_rbtree_entry * octo_rbtree_rightmost(octo_rbtree_entry *entry)
+{
+    while(entry->rchild != NULL)
+    {
+        entry = entry->rchild;
+    }
+    return entry;
+}
+
+inline void octo_rbtree_insert(octo_rbtree *tree, octo_rbtree_entry *entry)
+{
+    octo_rbtree_entry *parent = NULL;
+    octo_rbtree_entry **link = &tree->root;
+
+    /* equal entries go right so they come after those already there */
+    while(*link != NULL)
+    {
+        parent = *link;
+        if(tree->lt_function(entry, parent))
+        {
+            link = &parent->lchild;
+        }
+        else
+        {
+            link = &parent->rchild;
+        }
+    }
+
+    entry->parent = parent;
+    entry->lchild = NULL;
+    entry->rchild = NULL;
+    entry->red = true;
+    *link = entry;
+    tree->size += 1;
+
+    /* a red entry under a red parent is repaired by recoloring while the
+     * uncle is red and by at most two rotations once it isn't */
+    while((parent = entry->parent) != NULL && parent->red)
+    {
+        octo_rbtree_entry *grandparent = parent->parent;
+
+        if(parent == grandparent->lchild)
+        {
+            octo_rbtree_entry *uncle = grandparent->rchild;
+
+            if(octo_rbtree_is_red(uncle))
+            {
+                parent->red = false;
+                uncle->red = false;
+                grandparent->red = true;
+                entry = grandparent;
+                continue;
+            }
+            if(entry == parent->rchild)
+            {
+                octo_rbtree_rotate_left(tree, parent);
+                entry = parent;
+                parent = entry->parent;
+            }
+            parent->red = false;
+            grandparent->red = true;
+            octo_rbtree_rotate_right(tree, grandparent);
+        }
+        else
+        {
+            octo_rbtree_entry *uncle = grandparent->lchild;
+
+            if(octo_rbtree_is_red(uncle))
+            {
+                parent->red = false;
+                uncle->red = false;
+                grandparent->red = true;
+                entry = grandparent;
+                continue;
+            }
+            if(entry == parent->lchild)
+            {
+                octo_rbtree_rotate_right(tree, parent);
+                entry = parent;
+                parent = entry->parent;
+            }
+            parent->red = false;
+            grandparent->red = true;
+            octo_rbtree_rotate_left(tree, grandparent);
+        }
+    }
+
+    tree->root->red = false;
+}
+
+/**
+ * restore the black heights after a black entry was taken out above
+ * child, which may be NULL so its parent is passed along
+ */
+static void octo_rbtree_remove_fixup(octo_rbtree *tree, octo_rbtree_entry *child,
+        octo_rbtree_entry *parent)
+{
+    while(child != tree->root && !octo_rbtree_is_red(child))
+    {
+        if(child == parent->lchild)
+        {
+            octo_rbtree_entry *sibling = parent->rchild;
+
+            if(sibling->red)
+            {
+                sibling->red = false;
+                parent->red = true;
+                octo_rbtree_rotate_left(tree, parent);
+                sibling = parent->rchild;
+            }
+            if(!octo_rbtree_is_red(sibling->lchild) && !octo_rbtree_is_red(sibling->rchild))
+            {
+                sibling->red = true;
+                child = parent;
+                parent = child->parent;
+                continue;
+            }
+            if(!octo_rbtree_is_red(sibling->rchild))
+            {
+                sibling->lchild->red = false;
+                sibling->red = true;
+                octo_rbtree_rotate_right(tree, sibling);
+                sibling = parent->rchild;
+            }
+            sibling->red = parent->red;
+            parent->red = false;
+            sibling->rchild->red = false;
+            octo_rbtree_rotate_left(tree, parent);
+        }
+        else
+        {
+            octo_rbtree_entry *sibling = parent->lchild;
+
+            if(sibling->red)
+            {
+                sibling->red = false;
+                parent->red = true;
+                octo_rbtree_rotate_right(tree, parent);
+                sibling = parent->lchild;
+            }
+            if(!octo_rbtree_is_red(sibling->lchild) && !octo_rbtree_is_red(sibling->rchild))
+            {
+                sibling->red = true;
+                child = parent;
+                parent = child->parent;
+                continue;
+            }
+            if(!octo_rbtree_is_red(sibling->lchild))
+            {
+                sibling->rchild->red = false;
+                sibling->red = true;
+                octo_rbtree_rotate_left(tree, sibling);
+                sibling = parent->lchild;
+            }
+            sibling->red = parent->red;
+            parent->red = false;
+            sibling->lchild->red = false;
+            octo_rbtree_rotate_right(tree, parent);
+        }
+        child = tree->root;
+    }
+
+    if(child != NULL)
+    {
+        child->red = false;
+    }
+}
+
+inline void octo_rbtree_remove(octo_rbtree *tree, octo_rbtree_entry *entry)
+{
+    octo_rbtree_entry *child;
+    octo_rbtree_entry *parent;
+    bool red;
+
+    if(entry->lchild == NULL || entry->rchild == NULL)
+    {
+        /* at most one child, which takes the entry's place */
+        child = entry->lchild != NULL ? entry->lchild : entry->rchild;
+        parent = entry->parent;
+        red = entry->red;
+        octo_rbtree_replace(tree, entry, child, parent);
+        if(child != NULL)
+        {
+            child->parent = parent;
+        }
+    }
+    else
+    {
+        /* the successor has no left child, it is moved in to the entry's
+         * place and its right child in to its own */
+        octo_rbtree_entry *successor = octo_rbtree_leftmost(entry->rchild);
+
+        child = successor->rchild;
+        red = successor->red;
+
+        if(successor->parent == entry)
+        {
+            parent = successor;
+        }
+        else
+        {
+            parent = successor->parent;
+            parent->lchild = child;
+            if(child != NULL)
+            {
+                child->parent = parent;
+            }
+            successor->rchild = entry->rchild;
+            entry->rchild->parent = successor;
+        }
+
+        octo_rbtree_replace(tree, entry, successor, entry->parent);
+        successor->parent = entry->parent;
+        successor->lchild = entry->lchild;
+        entry->lchild->parent = successor;
+        successor->red = entry->red;
+    }
+
+    if(!red)
+    {
+        octo_rbtree_remove_fixup(tree, child, parent);
+    }
+
+    entry->parent = NULL;
+    entry->lchild = NULL;
+    entry->rchild = NULL;
+    tree->size -= 1;
+}
+
+inline octo_rbtree_entry * octo_rbtree_find(octo_rbtree *tree, octo_rbtree_entry *entry)
+{
+    octo_rbtree_entry *pos = tree->root;
+
+    while(pos != NULL)
+    {
+        if(tree->eq_function(entry, pos))
+        {
+            return pos;
+        }
+        pos = tree->lt_function(entry, pos) ? pos->lchild : pos->rchild;
+    }
+    return NULL;
+}
+
+inline octo_rbtree_entry * octo_rbtree_search(octo_rbtree *tree, octo_rbtree_s_entry *s_entry)
+{
+    octo_rbtree_entry *pos = tree->root;
+
+    while(pos != NULL)
+    {
+        if(s_entry->s_entry_eq(s_entry, pos))
+        {
+            return pos;
+        }
+        pos = s_entry->s_entry_lt(s_entry, pos) ? pos->lchild : pos->rchild;
+    }
+    return NULL;
+}
+
+inline octo_rbtree_entry * octo_rbtree_lower_bound(octo_rbtree *tree, octo_rbtree_s_entry *s_entry)
+{
+    octo_rbtree_entry *pos = tree->root;
+    octo_rbtree_entry *bound = NULL;
+
+    /* keep going left past equal entries to find the first of them */
+    while(pos != NULL)
+    {
+        if(s_entry->s_entry_lt(s_entry, pos) || s_entry->s_entry_eq(s_entry, pos))
+        {
+            bound = pos;
+            pos = pos->lchild;
+        }
+        else
+        {
+            pos = pos->rchild;
+        }
+    }
+    return bound;
+}
+
+inline octo_rbtree_entry * octo_rbtree_first(octo_rbtree *tree)
+{
+    return tree->root != NULL ? octo_rbtree_leftmost(tree->root) : NULL;
+}
+
+inline octo_rbtree_entry * octo_rbtree_last(octo_rbtree *tree)
+{
+    return tree->root != NULL ? octo_rbtree_rightmost(tree->root) : NULL;
+}
+
+inline octo_rbtree_entry * octo_rbtree_next(octo_rbtree_entry *entry)
+{
+    if(entry->rchild != NULL)
+    {
+        return octo_rbtree_leftmost(entry->rchild);
+    }
+    while(entry->parent != NULL && entry == entry->parent->rchild)
+    {
+        entry = entry->parent;
+    }
+    return entry->parent;
+}
+
+inline octo_rbtree_entry * octo_rbtree_prev(octo_rbtree_entry *entry)
+{
+    if(entry->lchild != NULL)
+    {
+        return octo_rbtree_rightmost(entry->lchild);
+    }
+    while(entry->parent != NULL && entry == entry->parent->lchild)
+    {
+        entry = entry->parent;
+    }
+    return entry->parent;
+}
+
+/**
+ * point an iterator at entry with the one after it lined up, so the
+ * current entry can be removed without losing the way
+ */
+static inline octo_rbtree_entry * octo_rbtree_iter_at(octo_rbtree_iterator *iter,
+        octo_rbtree_entry *entry)
+{
+    iter->current = entry;
+    iter->next = entry != NULL ? octo_rbtree_next(entry) : NULL;
+    return entry;
+}
+
+inline octo_rbtree_entry * octo_rbtree_iter(octo_rbtree *tree, octo_rbtree_iterator *iter)
+{
+    iter->tree = tree;
+    return octo_rbtree_iter_at(iter, octo_rbtree_first(tree));
+}
+
+inline octo_rbtree_entry * octo_rbtree_iter_from(octo_rbtree *tree, octo_rbtree_iterator *iter,
+        octo_rbtree_s_entry *s_entry)
+{
+    iter->tree = tree;
+    return octo_rbtree_iter_at(iter, octo_rbtree_lower_bound(tree, s_entry));
+}
+
+inline octo_rbtree_entry * octo_rbtree_iternext(octo_rbtree_iterator *iter)
+{
+    return octo_rbtree_iter_at(iter, iter->next);
+}
+
+inline void octo_rbtree_iterremove(octo_rbtree_iterator *iter)
+{
+    octo_rbtree_remove(iter->tree, iter->current);
+    iter->current = NULL;
+}
@@ -23,31 +23,53 @@
 #ifndef OCTO_RBTREE_H
 #define OCTO_RBTREE_H
 
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "common.h"
+
 /**
  * intrusive red-black balanced binary tree
+ *
+ * entries are embedded in the caller's struct and ordered by the tree's
+ * lt function, which is given the entries and finds the structs around
+ * them with ptr_offset. equal entries may be inserted more than once and
+ * keep the order they were inserted in, so a tree of deadlines hands
+ * back requests with the same deadline first come first served.
+ *
+ * lookups by key alone go through a search entry, embedded in a struct
+ * holding the key, whose functions compare it against entries in the
+ * tree. nothing is allocated by the tree.
  */
 
+typedef struct octo_rbtree_entry octo_rbtree_entry;
+typedef struct octo_rbtree_s_entry octo_rbtree_s_entry;
+
 typedef bool (* octo_rbtree_eq) (octo_rbtree_entry *lh, octo_rbtree_entry *rh);
 typedef bool (* octo_rbtree_lt) (octo_rbtree_entry *lh, octo_rbtree_entry *rh);
 
 /**
  * struct used for an entry
  */
-typedef struct octo_rbtree_entry
+struct octo_rbtree_entry
 {
     octo_rbtree_entry *parent;
     octo_rbtree_entry *lchild;
     octo_rbtree_entry *rchild;
-} octo_rbtree entry;
+    bool red;
+};
 
 /**
  * struct used for searching
+ *
+ * s_entry_eq is true if the searched for key equals the entry's and
+ * s_entry_lt if it is less than the entry's.
  */
-typedef struct octo_rbtree_s_entry
+struct octo_rbtree_s_entry
 {
     bool (* s_entry_eq)(octo_rbtree_s_entry *lh, octo_rbtree_entry *rh);
     bool (* s_entry_lt)(octo_rbtree_s_entry *lh, octo_rbtree_entry *rh);
-} octo_rbtree_s_entry;
+};
 
 /**
  * struct for tree management
@@ -56,19 +78,120 @@ typedef struct octo_rbtree
 {
     octo_rbtree_eq eq_function;
     octo_rbtree_lt lt_function;
-    octo_rbtree_entry root_entry;
+    octo_rbtree_entry *root;
+    size_t size;
 } octo_rbtree;
 
+/**
+ * iterator over the entries of a tree in order
+ */
 typedef struct octo_rbtree_iterator
 {
+    octo_rbtree *tree;
     octo_rbtree_entry *current;
     octo_rbtree_entry *next;
 } octo_rbtree_iterator;
 
+/**
+ * initialize an empty tree ordered by lt, eq is used by find
+ */
 void octo_rbtree_init(octo_rbtree *tree, octo_rbtree_eq eq, octo_rbtree_lt lt);
+
+/**
+ * destroy a tree, its entries are left as they are for the caller
+ */
 void octo_rbtree_destroy(octo_rbtree *tree);
+
+/**
+ * number of entries in the tree
+ */
+size_t octo_rbtree_size(const octo_rbtree *tree);
+
+/**
+ * test if the tree is empty
+ */
+bool octo_rbtree_empty(const octo_rbtree *tree);
+
+/**
+ * insert an entry, after any entries equal to it
+ */
 void octo_rbtree_insert(octo_rbtree *tree, octo_rbtree_entry *entry);
-void octo_rbtree_remove(octo_rbtree_entry *entry);
+
+/**
+ * remove an entry from the tree it was inserted in to
+ */
+void octo_rbtree_remove(octo_rbtree *tree, octo_rbtree_entry *entry);
+
+/**
+ * find an entry equal to the given one
+ *
+ * returns NULL if there is none.
+ */
 octo_rbtree_entry * octo_rbtree_find(octo_rbtree *tree, octo_rbtree_entry *entry);
 
+/**
+ * find an entry with the searched for key
+ *
+ * returns NULL if there is none.
+ */
+octo_rbtree_entry * octo_rbtree_search(octo_rbtree *tree, octo_rbtree_s_entry *s_entry);
+
+/**
+ * find the first entry whose key is not less than the searched for key
+ *
+ * returns NULL if every entry is less.
+ */
+octo_rbtree_entry * octo_rbtree_lower_bound(octo_rbtree *tree, octo_rbtree_s_entry *s_entry);
+
+/**
+ * the least entry, or NULL if the tree is empty
+ */
+octo_rbtree_entry * octo_rbtree_first(octo_rbtree *tree);
+
+/**
+ * the greatest entry, or NULL if the tree is empty
+ */
+octo_rbtree_entry * octo_rbtree_last(octo_rbtree *tree);
+
+/**
+ * the entry after the given one in order, or NULL if it is the last
+ */
+octo_rbtree_entry * octo_rbtree_next(octo_rbtree_entry *entry);
+
+/**
+ * the entry before the given one in order, or NULL if it is the first
+ */
+octo_rbtree_entry * octo_rbtree_prev(octo_rbtree_entry *entry);
+
+/**
+ * start iterating over a tree in order from the least entry
+ *
+ * nothing may be inserted while iterating, use octo_rbtree_iterremove
+ * to remove entries.
+ *
+ * returns the first entry or NULL if the tree is empty
+ */
+octo_rbtree_entry * octo_rbtree_iter(octo_rbtree *tree, octo_rbtree_iterator *iter);
+
+/**
+ * start iterating over a tree in order from the lower bound of a key
+ *
+ * returns the first entry not less than the key or NULL if there is none
+ */
+octo_rbtree_entry * octo_rbtree_iter_from(octo_rbtree *tree, octo_rbtree_iterator *iter,
+        octo_rbtree_s_entry *s_entry);
+
+/**
+ * move an iterator to the next entry
+ *
+ * returns the next entry or NULL once the last entry has been visited
+ */
+octo_rbtree_entry * octo_rbtree_iternext(octo_rbtree_iterator *iter);
+
+/**
+ * remove the current entry of an iterator from its tree,
+ * octo_rbtree_iternext then carries on with the entry after it
+ */
+void octo_rbtree_iterremove(octo_rbtree_iterator *iter);
+
 #endif
@@ -0,0 +1,298 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "common.h"
+
+#include "ringbuf.h"
+
+/**
+ * round up to the next power of 2
+ */
+static inline size_t octo_ringbuf_pow2(size_t x)
+{
+    size_t pow2 = 1;
+    while(pow2 < x)
+    {
+        pow2 <<= 1;
+    }
+    return pow2;
+}
+
+/**
+ * offset of a position in to the memory
+ */
+static inline size_t octo_ringbuf_offset(const octo_ringbuf *r, size_t pos)
+{
+    return pos & (r->capacity - 1);
+}
+
+/**
+ * map a memfd of capacity bytes twice back to back
+ *
+ * return the mapping or NULL
+ */
+static uint8_t * octo_ringbuf_mirror(size_t capacity)
+{
+    uint8_t *data;
+    int fd = memfd_create("octo_ringbuf", MFD_CLOEXEC);
+
+    if(fd == -1)
+    {
+        return NULL;
+    }
+
+    if(ftruncate(fd, capacity) == -1)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    /* reserve the address space for both halves then replace each half
+     * with a mapping of the same file */
+    data = mmap(NULL, 2*capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(data == MAP_FAILED)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    if(mmap(data, capacity, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED
+        || mmap(data + capacity, capacity, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        munmap(data, 2*capacity);
+        close(fd);
+        return NULL;
+    }
+
+    /* the mappings keep the file alive */
+    close(fd);
+    return data;
+}
+
+bool octo_ringbuf_init(octo_ringbuf *r, size_t capacity, bool mirror)
+{
+    size_t page = sysconf(_SC_PAGESIZE);
+
+    r->capacity = octo_ringbuf_pow2(max(capacity, page));
+    r->read_pos = 0;
+    r->write_pos = 0;
+    r->mirrored = false;
+    r->data = NULL;
+
+    if(mirror)
+    {
+        r->data = octo_ringbuf_mirror(r->capacity);
+        r->mirrored = (r->data != NULL);
+    }
+
+    if(r->data == NULL)
+    {
+        r->data = malloc(r->capacity);
+    }
+
+    if(r->data == NULL)
+    {
+        perror("malloc");
+        r->capacity = 0;
+        return false;
+    }
+
+    return true;
+}
+
+void octo_ringbuf_destroy(octo_ringbuf *r)
+{
+    if(r->mirrored)
+    {
+        munmap(r->data, 2*r->capacity);
+    }
+    else
+    {
+        free(r->data);
+    }
+
+    r->data = NULL;
+    r->capacity = 0;
+    r->read_pos = 0;
+    r->write_pos = 0;
+    r->mirrored = false;
+}
+
+size_t octo_ringbuf_size(const octo_ringbuf *r)
+{
+    return r->write_pos - r->read_pos;
+}
+
+size_t octo_ringbuf_capacity(const octo_ringbuf *r)
+{
+    return r->capacity;
+}
+
+size_t octo_ringbuf_remaining(const octo_ringbuf *r)
+{
+    return r->capacity - octo_ringbuf_size(r);
+}
+
+void * octo_ringbuf_reserve(octo_ringbuf *r, size_t *len)
+{
+    size_t offset = octo_ringbuf_offset(r, r->write_pos);
+
+    *len = octo_ringbuf_remaining(r);
+    if(!r->mirrored)
+    {
+        *len = min(*len, r->capacity - offset);
+    }
+
+    return &r->data[offset];
+}
+
+void octo_ringbuf_commit(octo_ringbuf *r, size_t len)
+{
+    r->write_pos += min(len, octo_ringbuf_remaining(r));
+}
+
+void * octo_ringbuf_data(octo_ringbuf *r, size_t *len)
+{
+    size_t offset = octo_ringbuf_offset(r, r->read_pos);
+
+    *len = octo_ringbuf_size(r);
+    if(!r->mirrored)
+    {
+        *len = min(*len, r->capacity - offset);
+    }
+
+    return &r->data[offset];
+}
+
+size_t octo_ringbuf_write(octo_ringbuf *r, void *rawdata, size_t len)
+{
+    uint8_t *data = (uint8_t *)rawdata;
+    size_t copied = 0;
+    size_t copylen = 0;
+    uint8_t *region;
+
+    /* at most twice without the mirror, once with it */
+    while(copied < len && octo_ringbuf_remaining(r) > 0)
+    {
+        region = octo_ringbuf_reserve(r, &copylen);
+        copylen = min(len-copied, copylen);
+        memcpy(region, &data[copied], copylen);
+        octo_ringbuf_commit(r, copylen);
+        copied += copylen;
+    }
+
+    return copied;
+}
+
+ssize_t octo_ringbuf_read_fd(octo_ringbuf *r, int fd)
+{
+    size_t len = 0;
+    void *region = octo_ringbuf_reserve(r, &len);
+    ssize_t result = 0;
+
+    if(len == 0)
+    {
+        return 0;
+    }
+
+    result = read(fd, region, len);
+    if(result > 0)
+    {
+        octo_ringbuf_commit(r, result);
+    }
+
+    return result;
+}
+
+size_t octo_ringbuf_peek(octo_ringbuf *r, void *rawdata, size_t len)
+{
+    uint8_t *data = (uint8_t *)rawdata;
+    size_t size = min(len, octo_ringbuf_size(r));
+    size_t offset = octo_ringbuf_offset(r, r->read_pos);
+    size_t copylen = size;
+
+    if(!r->mirrored)
+    {
+        copylen = min(size, r->capacity - offset);
+    }
+
+    memcpy(data, &r->data[offset], copylen);
+    memcpy(&data[copylen], r->data, size - copylen);
+
+    return size;
+}
+
+size_t octo_ringbuf_peekv(octo_ringbuf *r, struct iovec *iov, size_t iovcnt)
+{
+    size_t filled = 0;
+    size_t len = 0;
+    void *region = octo_ringbuf_data(r, &len);
+
+    if(iovcnt > 0 && len > 0)
+    {
+        iov[filled].iov_base = region;
+        iov[filled].iov_len = len;
+        filled += 1;
+    }
+
+    /* without the mirror the rest wraps around to the start */
+    if(iovcnt > 1 && len < octo_ringbuf_size(r))
+    {
+        iov[filled].iov_base = r->data;
+        iov[filled].iov_len = octo_ringbuf_size(r) - len;
+        filled += 1;
+    }
+
+    return filled;
+}
+
+size_t octo_ringbuf_drain(octo_ringbuf *r, size_t len)
+{
+    size_t drained = min(len, octo_ringbuf_size(r));
+
+    r->read_pos += drained;
+
+    /* start over at the front of the memory when empty so regions
+     * handed out without the mirror are as long as possible */
+    if(r->read_pos == r->write_pos)
+    {
+        r->read_pos = 0;
+        r->write_pos = 0;
+    }
+
+    return drained;
+}
+
+size_t octo_ringbuf_read(octo_ringbuf *r, void *data, size_t len)
+{
+    return octo_ringbuf_drain(r, octo_ringbuf_peek(r, data, len));
+}
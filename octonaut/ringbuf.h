@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef OCTO_RINGBUF_H
+#define OCTO_RINGBUF_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/**
+ * fixed capacity ring buffer for network IO
+ *
+ * the backing memory is mapped twice back to back when possible so any
+ * readable or writable region is contiguous even across the wrap around,
+ * a parser can be handed the whole readable window without a copy.
+ *
+ * when the mirror mapping isn't available a plain allocation is used and
+ * the regions handed out stop at the end of the memory instead.
+ *
+ * the capacity is always a power of 2 multiple of the page size so
+ * positions are masked rather than taken modulo the capacity.
+ */
+typedef struct octo_ringbuf
+{
+    uint8_t *data;
+    size_t capacity;
+    size_t read_pos;
+    size_t write_pos;
+    bool mirrored;
+} octo_ringbuf;
+
+/**
+ * initialize a ring buffer holding at least capacity bytes
+ *
+ * mirror asks for the double mapping, falling back to a plain allocation
+ * if it can't be made.
+ *
+ * returns false if no memory could be allocated.
+ */
+bool octo_ringbuf_init(octo_ringbuf *r, size_t capacity, bool mirror);
+
+/**
+ * destroy a ring buffer
+ */
+void octo_ringbuf_destroy(octo_ringbuf *r);
+
+/**
+ * number of readable bytes in the ring buffer
+ */
+size_t octo_ringbuf_size(const octo_ringbuf *r);
+
+/**
+ * total bytes the ring buffer can hold
+ */
+size_t octo_ringbuf_capacity(const octo_ringbuf *r);
+
+/**
+ * bytes that can still be written to the ring buffer
+ */
+size_t octo_ringbuf_remaining(const octo_ringbuf *r);
+
+/**
+ * obtain the contiguous writable region, its length is stored in len.
+ *
+ * bytes written there become readable once committed.
+ */
+void * octo_ringbuf_reserve(octo_ringbuf *r, size_t *len);
+
+/**
+ * make len bytes of the reserved region readable
+ */
+void octo_ringbuf_commit(octo_ringbuf *r, size_t len);
+
+/**
+ * obtain the contiguous readable region, its length is stored in len.
+ *
+ * with the mirror mapping this is always every readable byte.
+ */
+void * octo_ringbuf_data(octo_ringbuf *r, size_t *len);
+
+/**
+ * write to the ring buffer from a memory location at most len bytes
+ *
+ * return number of bytes written, less than len when the ring is full.
+ */
+size_t octo_ringbuf_write(octo_ringbuf *r, void *data, size_t len);
+
+/**
+ * read from a file descriptor straight in to the ring buffer
+ *
+ * return the result of read(), 0 without reading when the ring is full.
+ */
+ssize_t octo_ringbuf_read_fd(octo_ringbuf *r, int fd);
+
+/**
+ * read from the ring buffer to a memory location at most len bytes.
+ *
+ * return the number of bytes read.
+ */
+size_t octo_ringbuf_read(octo_ringbuf *r, void *data, size_t len);
+
+/**
+ * peek in to the ring buffer at most len bytes.
+ *
+ * return the actual number of bytes read.
+ */
+size_t octo_ringbuf_peek(octo_ringbuf *r, void *data, size_t len);
+
+/**
+ * peek in to the ring buffer without copying, same as octo_buffer_peekv.
+ *
+ * return the number of iovecs filled in.
+ */
+size_t octo_ringbuf_peekv(octo_ringbuf *r, struct iovec *iov, size_t iovcnt);
+
+/**
+ * remove from the ring buffer at most len bytes.
+ *
+ * return the actual number of bytes removed.
+ */
+size_t octo_ringbuf_drain(octo_ringbuf *r, size_t len);
+
+#endif
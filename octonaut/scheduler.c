@@ -0,0 +1,193 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+
+#include "common.h"
+
+#include "scheduler.h"
+
+/**
+ * arm the timer for the earliest deadline unless it is already set to
+ * go off no later
+ */
+static void octo_scheduler_arm(octo_scheduler *scheduler)
+{
+    if(octo_heap_empty(&scheduler->heap))
+    {
+        return;
+    }
+
+    ev_tstamp at = octo_heap_top_key(&scheduler->heap);
+
+    if(ev_is_active(&scheduler->timer))
+    {
+        if(scheduler->timer_at <= at)
+        {
+            return;
+        }
+        ev_timer_stop(scheduler->loop, &scheduler->timer);
+    }
+
+    scheduler->timer_at = at;
+    ev_timer_set(&scheduler->timer, max(at - ev_now(scheduler->loop), 0.0), 0.0);
+    ev_timer_start(scheduler->loop, &scheduler->timer);
+}
+
+/**
+ * callback given to ev_timer to fire due deadlines
+ */
+static void octo_scheduler_timeout(EV_P_ ev_timer *watcher, int revents)
+{
+    octo_scheduler *scheduler = ptr_offset(watcher, octo_scheduler, timer);
+    octo_scheduler_run(scheduler);
+}
+
+bool octo_scheduler_init(octo_scheduler *scheduler, struct ev_loop *loop, size_t capacity)
+{
+    scheduler->loop = loop;
+    scheduler->timer_at = 0.0;
+    scheduler->pass = 0;
+    ev_timer_init(&scheduler->timer, octo_scheduler_timeout, 0.0, 0.0);
+    return octo_heap_init(&scheduler->heap, capacity);
+}
+
+void octo_scheduler_destroy(octo_scheduler *scheduler)
+{
+    ev_timer_stop(scheduler->loop, &scheduler->timer);
+    octo_heap_destroy(&scheduler->heap);
+    scheduler->loop = NULL;
+}
+
+size_t octo_scheduler_size(const octo_scheduler *scheduler)
+{
+    return octo_heap_size(&scheduler->heap);
+}
+
+void octo_scheduler_entry_init(octo_scheduler_entry *entry, octo_scheduler_cb cb)
+{
+    octo_heap_entry_init(&entry->heap);
+    entry->deadline = 0.0;
+    entry->cb = cb;
+    entry->pass = 0;
+}
+
+bool octo_scheduler_pending(const octo_scheduler_entry *entry)
+{
+    return octo_heap_entry_active(&entry->heap);
+}
+
+bool octo_scheduler_add(octo_scheduler *scheduler, octo_scheduler_entry *entry, ev_tstamp after)
+{
+    return octo_scheduler_add_at(scheduler, entry, ev_now(scheduler->loop) + after);
+}
+
+bool octo_scheduler_add_at(octo_scheduler *scheduler, octo_scheduler_entry *entry, ev_tstamp at)
+{
+    /* added during the current run if any, a run stops short of it */
+    entry->pass = scheduler->pass;
+
+    if(octo_heap_entry_active(&entry->heap))
+    {
+        entry->deadline = at;
+
+        /* a postponed entry is moved once its old place comes due */
+        if(at >= octo_heap_key(&scheduler->heap, &entry->heap))
+        {
+            return true;
+        }
+        octo_heap_update(&scheduler->heap, &entry->heap, at);
+    }
+    else if(octo_heap_push(&scheduler->heap, &entry->heap, at))
+    {
+        entry->deadline = at;
+    }
+    else
+    {
+        return false;
+    }
+
+    if(octo_heap_top(&scheduler->heap) == &entry->heap)
+    {
+        octo_scheduler_arm(scheduler);
+    }
+    return true;
+}
+
+void octo_scheduler_cancel(octo_scheduler *scheduler, octo_scheduler_entry *entry)
+{
+    if(octo_heap_entry_active(&entry->heap))
+    {
+        octo_heap_remove(&scheduler->heap, &entry->heap);
+    }
+
+    if(octo_heap_empty(&scheduler->heap))
+    {
+        ev_timer_stop(scheduler->loop, &scheduler->timer);
+    }
+}
+
+ev_tstamp octo_scheduler_deadline(const octo_scheduler *scheduler, const octo_scheduler_entry *entry)
+{
+    return entry->deadline;
+}
+
+size_t octo_scheduler_run(octo_scheduler *scheduler)
+{
+    ev_tstamp now = ev_now(scheduler->loop);
+    size_t fired = 0;
+
+    /* entries added from here on belong to this run */
+    scheduler->pass += 1;
+
+    /* the timer is one shot and has stopped if this is its callback */
+    if(ev_is_active(&scheduler->timer) && scheduler->timer_at <= now)
+    {
+        ev_timer_stop(scheduler->loop, &scheduler->timer);
+    }
+
+    while(!octo_heap_empty(&scheduler->heap) && octo_heap_top_key(&scheduler->heap) <= now)
+    {
+        octo_scheduler_entry *entry = ptr_offset(octo_heap_top(&scheduler->heap),
+            octo_scheduler_entry, heap);
+
+        /* an entry added by a callback of this run waits for the next
+         * one, the timer is armed for it once this run is done */
+        if(entry->pass == scheduler->pass)
+        {
+            break;
+        }
+
+        if(entry->deadline > now)
+        {
+            octo_heap_update(&scheduler->heap, &entry->heap, entry->deadline);
+            continue;
+        }
+
+        octo_heap_remove(&scheduler->heap, &entry->heap);
+        entry->cb(scheduler, entry);
+        fired += 1;
+    }
+
+    octo_scheduler_arm(scheduler);
+    return fired;
+}
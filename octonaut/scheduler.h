@@ -0,0 +1,141 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef OCTO_SCHEDULER_H
+#define OCTO_SCHEDULER_H
+
+#include <stdbool.h>
+#include <ev.h>
+
+#include "heap.h"
+
+/**
+ * octo_scheduler
+ *
+ * Deadlines of a loop, such as request timeouts, kept in an octo_heap
+ * and fired from a single ev_timer. Adding, bringing forward, or
+ * cancelling a deadline is an octo_heap operation and only touches the
+ * ev_timer when the earliest deadline moves sooner. A timer left running
+ * for a cancelled earliest deadline finds nothing due, and is set again
+ * for whichever deadline is earliest by then.
+ *
+ * Postponing a deadline, as activity on a connection does with its
+ * timeout, only records the new deadline in the entry. The entry keeps
+ * its old place in the heap until that comes due, and is then moved to
+ * its real deadline instead of being fired, so a connection postponing
+ * its timeout many times between expiries costs one heap operation.
+ *
+ * An entry added during a run, as a callback re-arming itself does, is
+ * left for the next run even when already due, so a callback re-arming
+ * with no delay can't keep the loop inside one run.
+ */
+typedef struct octo_scheduler octo_scheduler;
+typedef struct octo_scheduler_entry octo_scheduler_entry;
+
+/**
+ * called once an entry's deadline has passed, the entry has already been
+ * taken out of the scheduler and may be added again
+ */
+typedef void (*octo_scheduler_cb)(octo_scheduler *scheduler, octo_scheduler_entry *entry);
+
+/**
+ * intrusive entry for a deadline
+ */
+struct octo_scheduler_entry
+{
+    octo_heap_entry heap;
+    ev_tstamp deadline;
+    octo_scheduler_cb cb;
+    size_t pass;
+};
+
+struct octo_scheduler
+{
+    struct ev_loop *loop;
+    ev_timer timer;
+    ev_tstamp timer_at;
+    octo_heap heap;
+    size_t pass;
+};
+
+/**
+ * initialize a scheduler for a loop with room for capacity deadlines to
+ * begin with
+ *
+ * returns false if no memory could be allocated.
+ */
+bool octo_scheduler_init(octo_scheduler *scheduler, struct ev_loop *loop, size_t capacity);
+
+/**
+ * destroy a scheduler, pending entries are dropped without being called
+ */
+void octo_scheduler_destroy(octo_scheduler *scheduler);
+
+/**
+ * number of pending deadlines
+ */
+size_t octo_scheduler_size(const octo_scheduler *scheduler);
+
+/**
+ * initialize an entry calling cb when its deadline passes
+ */
+void octo_scheduler_entry_init(octo_scheduler_entry *entry, octo_scheduler_cb cb);
+
+/**
+ * test if an entry has a pending deadline
+ */
+bool octo_scheduler_pending(const octo_scheduler_entry *entry);
+
+/**
+ * set an entry's deadline to after seconds from the loop's now, adding
+ * it if it isn't pending or moving its deadline if it is
+ *
+ * returns false if the entry could not be added.
+ */
+bool octo_scheduler_add(octo_scheduler *scheduler, octo_scheduler_entry *entry, ev_tstamp after);
+
+/**
+ * set an entry's deadline to the loop time at
+ *
+ * returns false if the entry could not be added.
+ */
+bool octo_scheduler_add_at(octo_scheduler *scheduler, octo_scheduler_entry *entry, ev_tstamp at);
+
+/**
+ * cancel an entry's deadline if it is pending
+ */
+void octo_scheduler_cancel(octo_scheduler *scheduler, octo_scheduler_entry *entry);
+
+/**
+ * the loop time an entry is due at, it must be pending
+ */
+ev_tstamp octo_scheduler_deadline(const octo_scheduler *scheduler, const octo_scheduler_entry *entry);
+
+/**
+ * call every entry due by the loop's now, in deadline order, except
+ * those added while it runs
+ *
+ * returns the number of entries called.
+ */
+size_t octo_scheduler_run(octo_scheduler *scheduler);
+
+#endif
@@ -0,0 +1,104 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+
+#include "common.h"
+
+#include "sweeper.h"
+
+/**
+ * callback given to ev_timer to sweep periodically
+ */
+static void octo_sweeper_timeout(EV_P_ ev_timer *watcher, int revents)
+{
+    octo_sweeper *sweeper = ptr_offset(watcher, octo_sweeper, timer);
+    octo_sweeper_sweep(sweeper);
+}
+
+void octo_sweeper_init(octo_sweeper *sweeper, struct ev_loop *loop,
+        ev_tstamp interval, ev_tstamp idle)
+{
+    sweeper->loop = loop;
+    sweeper->idle = idle;
+    sweeper->released = 0;
+    octo_list_init(&sweeper->entries);
+    ev_timer_init(&sweeper->timer, octo_sweeper_timeout, interval, interval);
+}
+
+void octo_sweeper_destroy(octo_sweeper *sweeper)
+{
+    octo_sweeper_stop(sweeper);
+    octo_list_destroy(&sweeper->entries);
+    sweeper->loop = NULL;
+}
+
+void octo_sweeper_start(octo_sweeper *sweeper)
+{
+    ev_timer_start(sweeper->loop, &sweeper->timer);
+}
+
+void octo_sweeper_stop(octo_sweeper *sweeper)
+{
+    ev_timer_stop(sweeper->loop, &sweeper->timer);
+}
+
+void octo_sweeper_add(octo_sweeper *sweeper, octo_sweeper_entry *entry,
+        octo_buffer *buffer)
+{
+    entry->buffer = buffer;
+    entry->activity = octo_buffer_activity(buffer);
+    entry->since = ev_now(sweeper->loop);
+    octo_list_append(&sweeper->entries, &entry->sweep_list);
+}
+
+void octo_sweeper_remove(octo_sweeper_entry *entry)
+{
+    octo_list_remove(&entry->sweep_list);
+    entry->buffer = NULL;
+}
+
+size_t octo_sweeper_sweep(octo_sweeper *sweeper)
+{
+    octo_sweeper_entry *pos;
+    octo_sweeper_entry *next;
+    ev_tstamp now = ev_now(sweeper->loop);
+    size_t released = 0;
+
+    octo_list_foreach(pos, next, &sweeper->entries, sweep_list)
+    {
+        size_t activity = octo_buffer_activity(pos->buffer);
+
+        if(activity != pos->activity)
+        {
+            pos->activity = activity;
+            pos->since = now;
+        }
+        else if(now - pos->since >= sweeper->idle)
+        {
+            released += octo_buffer_trim(pos->buffer);
+        }
+    }
+
+    sweeper->released += released;
+    return released;
+}
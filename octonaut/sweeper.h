@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef OCTO_SWEEPER_H
+#define OCTO_SWEEPER_H
+
+#include <stdlib.h>
+#include <ev.h>
+
+#include "list.h"
+#include "buffer.h"
+
+/**
+ * octo_sweeper
+ *
+ * Periodically trims buffers that have sat idle, such as those of
+ * keep-alive connections waiting on their next request, so they give
+ * back the chunks they were left holding. A buffer counts as idle once
+ * nothing has been written to or read from it for the idle time.
+ */
+typedef struct octo_sweeper
+{
+    struct ev_loop *loop;
+    ev_timer timer;
+    ev_tstamp idle;
+    octo_list entries;
+    size_t released;
+} octo_sweeper;
+
+/**
+ * intrusive entry for a buffer watched by a sweeper
+ */
+typedef struct octo_sweeper_entry
+{
+    octo_list sweep_list;
+    octo_buffer *buffer;
+    size_t activity;
+    ev_tstamp since;
+} octo_sweeper_entry;
+
+/**
+ * initialize a sweeper that looks for idle buffers every interval
+ * seconds and trims those idle for at least idle seconds
+ */
+void octo_sweeper_init(octo_sweeper *sweeper, struct ev_loop *loop,
+        ev_tstamp interval, ev_tstamp idle);
+
+/**
+ * destroy a sweeper, forgetting every buffer it watches
+ */
+void octo_sweeper_destroy(octo_sweeper *sweeper);
+
+void octo_sweeper_start(octo_sweeper *sweeper);
+void octo_sweeper_stop(octo_sweeper *sweeper);
+
+/**
+ * watch a buffer
+ */
+void octo_sweeper_add(octo_sweeper *sweeper, octo_sweeper_entry *entry,
+        octo_buffer *buffer);
+
+/**
+ * stop watching a buffer, must be done before the buffer is destroyed
+ */
+void octo_sweeper_remove(octo_sweeper_entry *entry);
+
+/**
+ * look for idle buffers and trim them now
+ *
+ * returns the bytes of memory released.
+ */
+size_t octo_sweeper_sweep(octo_sweeper *sweeper);
+
+#endif
@@ -0,0 +1,265 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef OCTO_THASH_H
+#define OCTO_THASH_H
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#include "common.h"
+
+/**
+ * intrusive chained hash tables specialized for a key type at compile time.
+ *
+ * OCTO_HASH_DEFINE(name, key_type, hash_fn, eq_fn) defines a table type
+ * name and an entry type name_entry holding a key_type key, along with
+ * static inline name_init, name_destroy, name_size, name_has, name_put,
+ * name_get, and name_pop functions mirroring octo_hash.
+ *
+ * hash_fn(key_type key) returns a uint32_t hash and eq_fn(key_type a,
+ * key_type b) returns true if two keys are equal. both are called
+ * directly rather than through a function pointer and memcmp, so for
+ * fixed width keys the whole lookup inlines down to a few instructions.
+ *
+ * tables resize incrementally as octo_hash does.
+ */
+
+/**
+ * integer hashes to use with OCTO_HASH_DEFINE, the murmur3 finalizers
+ */
+static inline uint32_t octo_thash_u32(uint32_t key)
+{
+    key ^= key >> 16;
+    key *= 0x85ebca6b;
+    key ^= key >> 13;
+    key *= 0xc2b2ae35;
+    key ^= key >> 16;
+    return key;
+}
+
+static inline uint32_t octo_thash_u64(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return (uint32_t)key;
+}
+
+/**
+ * equality to use with OCTO_HASH_DEFINE for integer keys
+ */
+#define octo_thash_eq(a, b) ((a) == (b))
+
+#ifndef OCTO_THASH_MIGRATE_BINS
+#define OCTO_THASH_MIGRATE_BINS 16
+#endif
+
+#define OCTO_HASH_DEFINE(name, key_type, hash_fn, eq_fn) \
+\
+typedef struct name##_entry name##_entry; \
+\
+struct name##_entry \
+{ \
+    name##_entry *next; \
+    uint32_t hash; \
+    key_type key; \
+}; \
+\
+typedef struct name \
+{ \
+    uint32_t n_bins; \
+    uint32_t min_bins; \
+    uint32_t n_old_bins; \
+    uint32_t migrate_bin; \
+    size_t size; \
+    name##_entry **bins; \
+    name##_entry **old_bins; \
+} name; \
+\
+static inline void name##_entry_init(name##_entry *entry, key_type key) \
+{ \
+    entry->next = NULL; \
+    entry->hash = 0; \
+    entry->key = key; \
+} \
+\
+static inline void name##_init(name *table, size_t pow2size) \
+{ \
+    assert(pow2size < 32); \
+    table->n_bins = 1u << pow2size; \
+    table->min_bins = table->n_bins; \
+    table->n_old_bins = 0; \
+    table->migrate_bin = 0; \
+    table->size = 0; \
+    table->bins = calloc(table->n_bins, sizeof(name##_entry *)); \
+    table->old_bins = NULL; \
+} \
+\
+static inline void name##_destroy(name *table) \
+{ \
+    free(table->bins); \
+    free(table->old_bins); \
+    table->bins = NULL; \
+    table->old_bins = NULL; \
+    table->n_bins = 0; \
+    table->min_bins = 0; \
+    table->n_old_bins = 0; \
+    table->migrate_bin = 0; \
+    table->size = 0; \
+} \
+\
+static inline size_t name##_size(const name *table) \
+{ \
+    return table->size; \
+} \
+\
+static inline name##_entry ** name##_bin(name *table, uint32_t keyhash) \
+{ \
+    if(table->old_bins != NULL) \
+    { \
+        uint32_t nbin = keyhash & (table->n_old_bins - 1); \
+        if(nbin >= table->migrate_bin) \
+        { \
+            return &table->old_bins[nbin]; \
+        } \
+    } \
+    return &table->bins[keyhash & (table->n_bins - 1)]; \
+} \
+\
+static inline void name##_resize(name *table, uint32_t n_bins) \
+{ \
+    name##_entry **bins = calloc(n_bins, sizeof(name##_entry *)); \
+    if(bins == NULL) \
+    { \
+        return; \
+    } \
+    table->old_bins = table->bins; \
+    table->n_old_bins = table->n_bins; \
+    table->migrate_bin = 0; \
+    table->bins = bins; \
+    table->n_bins = n_bins; \
+} \
+\
+static inline void name##_migrate(name *table) \
+{ \
+    if(table->old_bins == NULL) \
+    { \
+        return; \
+    } \
+    for(int i = 0; i < OCTO_THASH_MIGRATE_BINS \
+            && table->migrate_bin < table->n_old_bins; ++i) \
+    { \
+        name##_entry *entry = table->old_bins[table->migrate_bin]; \
+        while(entry != NULL) \
+        { \
+            name##_entry *next = entry->next; \
+            uint32_t nbin = entry->hash & (table->n_bins - 1); \
+            entry->next = table->bins[nbin]; \
+            table->bins[nbin] = entry; \
+            entry = next; \
+        } \
+        table->old_bins[table->migrate_bin] = NULL; \
+        table->migrate_bin += 1; \
+    } \
+    if(table->migrate_bin == table->n_old_bins) \
+    { \
+        free(table->old_bins); \
+        table->old_bins = NULL; \
+        table->n_old_bins = 0; \
+        table->migrate_bin = 0; \
+    } \
+} \
+\
+static inline name##_entry * name##_get(name *table, key_type key) \
+{ \
+    uint32_t keyhash = hash_fn(key); \
+    name##_entry *entry = *name##_bin(table, keyhash); \
+    while(entry != NULL) \
+    { \
+        if(entry->hash == keyhash && eq_fn(entry->key, key)) \
+        { \
+            return entry; \
+        } \
+        entry = entry->next; \
+    } \
+    return NULL; \
+} \
+\
+static inline bool name##_has(name *table, key_type key) \
+{ \
+    return name##_get(table, key) != NULL; \
+} \
+\
+static inline bool name##_put(name *table, name##_entry *entry) \
+{ \
+    name##_migrate(table); \
+    uint32_t keyhash = hash_fn(entry->key); \
+    name##_entry **bin = name##_bin(table, keyhash); \
+    for(name##_entry *cur = *bin; cur != NULL; cur = cur->next) \
+    { \
+        if(cur->hash == keyhash && eq_fn(cur->key, entry->key)) \
+        { \
+            return false; \
+        } \
+    } \
+    entry->hash = keyhash; \
+    entry->next = *bin; \
+    *bin = entry; \
+    table->size += 1; \
+    if(table->old_bins == NULL && table->size > table->n_bins \
+            && table->n_bins < (1u<<31)) \
+    { \
+        name##_resize(table, table->n_bins*2); \
+    } \
+    return true; \
+} \
+\
+static inline name##_entry * name##_pop(name *table, key_type key) \
+{ \
+    name##_migrate(table); \
+    uint32_t keyhash = hash_fn(key); \
+    name##_entry **link = name##_bin(table, keyhash); \
+    for(name##_entry *cur = *link; cur != NULL; link = &cur->next, cur = cur->next) \
+    { \
+        if(cur->hash == keyhash && eq_fn(cur->key, key)) \
+        { \
+            *link = cur->next; \
+            cur->next = NULL; \
+            table->size -= 1; \
+            if(table->old_bins == NULL && table->n_bins > table->min_bins \
+                    && table->size < table->n_bins/8) \
+            { \
+                name##_resize(table, table->n_bins/2); \
+            } \
+            return cur; \
+        } \
+    } \
+    return NULL; \
+}
+
+#endif
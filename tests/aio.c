@@ -25,7 +25,10 @@
 #include <check.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
 
 START_TEST (test_octo_aio_create)
 {
@@ -177,6 +180,202 @@ START_TEST (test_octo_aio_eagain)
 }
 END_TEST
 
+typedef struct test_aio_ref
+{
+    int released;
+    size_t released_len;
+} test_aio_ref;
+
+static void test_aio_release(void *ctx, void *data, size_t len)
+{
+    test_aio_ref *ref = (test_aio_ref*)ctx;
+    ref->released += 1;
+    ref->released_len += len;
+}
+
+/**
+ * a socket pair with small buffers so writes come up short quickly, the
+ * aio writes to fds[0] and the test reads fds[1] without blocking
+ */
+static void test_aio_socketpair(int fds[2])
+{
+    int size = 4096;
+
+    fail_unless(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != -1);
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    setsockopt(fds[1], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+}
+
+/**
+ * run the loop and read the other end of the pair until len bytes have
+ * come out, returns the number of bytes read
+ */
+static size_t test_aio_flush(struct ev_loop *loop, int fd, uint8_t *out, size_t len)
+{
+    size_t got = 0;
+
+    for(int i = 0; i < 100000 && got < len; ++i)
+    {
+        ssize_t result = read(fd, &out[got], len - got);
+        if(result > 0)
+        {
+            got += result;
+        }
+        ev_run(loop, EVRUN_NOWAIT);
+    }
+    return got;
+}
+
+START_TEST (test_octo_aio_write_ref)
+{
+    int fds[2];
+    octo_aio aio;
+    test_aio_ref ref = {0, 0};
+    const size_t len = 256*1024;
+    char tail[] = "tail";
+    uint8_t *data = malloc(len);
+    uint8_t *out = malloc(len + 4);
+
+    struct ev_loop *loop = EV_DEFAULT;
+
+    for(size_t i = 0; i < len; ++i)
+    {
+        data[i] = i*7 + (i >> 8);
+    }
+
+    test_aio_socketpair(fds);
+    octo_aio_init(&aio, loop, fds[0]);
+
+    fail_unless(octo_aio_write_ref(&aio, data, len, test_aio_release, &ref) == len,
+        "write_ref should take all of the memory");
+    fail_unless(aio.write == octo_aio_buffered_write,
+        "a short write should switch to buffered writing");
+    fail_unless(ev_is_active(&aio.write_watcher),
+        "a short write should start the write watcher");
+    fail_unless(octo_buffer_size(&aio.write_buffer) > 0
+        && octo_buffer_size(&aio.write_buffer) < len,
+        "only what wasn't written should be buffered");
+    fail_unless(ref.released == 0, "memory still buffered should not be released");
+
+    /* copies queue up behind the reference */
+    fail_unless(octo_aio_write(&aio, tail, 4) == 4);
+
+    fail_unless(test_aio_flush(loop, fds[1], out, len + 4) == len + 4,
+        "every byte should come out of the socket");
+    fail_unless(memcmp(out, data, len) == 0,
+        "referenced memory should come out as written");
+    fail_unless(memcmp(&out[len], tail, 4) == 0,
+        "a write after a reference should come out after it");
+    fail_unless(ref.released == 1 && ref.released_len == len,
+        "memory should be released once when written out");
+    fail_unless(aio.write == octo_aio_direct_write,
+        "an empty buffer should switch back to direct writing");
+
+    octo_aio_destroy(&aio);
+    close(fds[0]);
+    close(fds[1]);
+    free(data);
+    free(out);
+}
+END_TEST
+
+START_TEST (test_octo_aio_writev)
+{
+    int fds[2];
+    octo_aio aio;
+    test_aio_ref ref = {0, 0};
+    char pieces[] = "abcdefghijklmnopqrstuvwxyz0123456789ABCD";
+    char fill[64];
+    const size_t maxlen = 2*1024*1024;
+    uint8_t *expect = malloc(maxlen);
+    uint8_t *out = malloc(maxlen);
+    size_t total = 0;
+    struct iovec iov[OCTO_AIO_IOVECS];
+
+    struct ev_loop *loop = EV_DEFAULT;
+
+    test_aio_socketpair(fds);
+    octo_aio_init(&aio, loop, fds[0]);
+
+    for(size_t i = 0; aio.write == octo_aio_direct_write && total + sizeof(fill) < maxlen/2; ++i)
+    {
+        memset(fill, 'a' + i % 26, sizeof(fill));
+        fail_unless(octo_aio_write(&aio, fill, sizeof(fill)) == sizeof(fill));
+        memcpy(&expect[total], fill, sizeof(fill));
+        total += sizeof(fill);
+    }
+    fail_unless(aio.write == octo_aio_buffered_write,
+        "filling the socket should switch to buffered writing");
+
+    /* every reference is a chunk of its own, so there are more chunks
+     * queued than a single writev takes */
+    for(size_t i = 0; i < sizeof(pieces) - 1; ++i)
+    {
+        fail_unless(octo_aio_write_ref(&aio, &pieces[i], 1, test_aio_release, &ref) == 1);
+        expect[total++] = pieces[i];
+        memset(fill, '0' + i % 10, 3);
+        fail_unless(octo_aio_write(&aio, fill, 3) == 3);
+        memcpy(&expect[total], fill, 3);
+        total += 3;
+    }
+    fail_unless(octo_buffer_peekv(&aio.write_buffer, iov, OCTO_AIO_IOVECS) == OCTO_AIO_IOVECS,
+        "more chunks should be queued than one writev takes");
+
+    fail_unless(test_aio_flush(loop, fds[1], out, total) == total,
+        "every byte should come out of the socket");
+    fail_unless(memcmp(out, expect, total) == 0,
+        "chunks should come out in the order written");
+    fail_unless(ref.released == sizeof(pieces) - 1,
+        "every reference should be released once written out");
+    fail_unless(octo_buffer_size(&aio.write_buffer) == 0,
+        "write buffer should be empty");
+
+    octo_aio_destroy(&aio);
+    close(fds[0]);
+    close(fds[1]);
+    free(expect);
+    free(out);
+}
+END_TEST
+
+static ssize_t test_aio_mock_write(void *ctx, void *data, size_t len)
+{
+    mock_ctx *mctx = (mock_ctx*)ctx;
+    mctx->byte_count += len;
+    return len;
+}
+
+START_TEST (test_octo_aio_write_ref_writer)
+{
+    int fds[2];
+    octo_aio aio;
+    test_aio_ref ref = {0, 0};
+    char msg[] = "suck it trabek";
+    mock_ctx ctx;
+    ctx.byte_count = 0;
+
+    struct ev_loop *loop = EV_DEFAULT;
+
+    test_aio_socketpair(fds);
+    octo_aio_init(&aio, loop, fds[0]);
+    aio.write = test_aio_mock_write;
+    aio.write_ctx = &ctx;
+
+    fail_unless(octo_aio_write_ref(&aio, msg, strlen(msg), test_aio_release, &ref) == strlen(msg),
+        "write_ref should return what the write function did");
+    fail_unless(ctx.byte_count == strlen(msg),
+        "write_ref should go through the write function");
+    fail_unless(ref.released == 1,
+        "memory handed to the write function should be released");
+    fail_unless(octo_buffer_size(&aio.write_buffer) == 0,
+        "write_ref should not buffer around the write function");
+
+    octo_aio_destroy(&aio);
+    close(fds[0]);
+    close(fds[1]);
+}
+END_TEST
 
 TCase* octo_aio_tcase()
 {
@@ -185,5 +384,8 @@ TCase* octo_aio_tcase()
     tcase_add_test(tc_octo_aio, test_octo_aio_start);
     tcase_add_test(tc_octo_aio, test_octo_aio_pipe);
     tcase_add_test(tc_octo_aio, test_octo_aio_eagain);
+    tcase_add_test(tc_octo_aio, test_octo_aio_write_ref);
+    tcase_add_test(tc_octo_aio, test_octo_aio_writev);
+    tcase_add_test(tc_octo_aio, test_octo_aio_write_ref_writer);
     return tc_octo_aio;
 }
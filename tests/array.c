@@ -0,0 +1,264 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <octonaut/common.h>
+#include <octonaut/array.h>
+#include <check.h>
+#include <stdlib.h>
+#include <sys/uio.h>
+
+OCTO_ARRAY_DEFINE(test_int_array, int, 4)
+
+static inline bool test_int_lt(const int *a, const int *b)
+{
+    return *a < *b;
+}
+
+OCTO_ARRAY_DEFINE_SORTED(test_int_array, int, test_int_lt)
+
+typedef struct test_deadline
+{
+    double deadline;
+    int id;
+} test_deadline;
+
+OCTO_ARRAY_DEFINE(test_deadline_array, test_deadline, 1)
+
+static inline bool test_deadline_lt(const test_deadline *a, const test_deadline *b)
+{
+    return a->deadline < b->deadline;
+}
+
+OCTO_ARRAY_DEFINE_SORTED(test_deadline_array, test_deadline, test_deadline_lt)
+
+OCTO_ARRAY_DEFINE(test_iovec_array, struct iovec, 8)
+
+START_TEST (test_octo_array_push_pop)
+{
+    test_int_array arr;
+    int value;
+
+    test_int_array_init(&arr);
+    fail_unless(test_int_array_size(&arr) == 0, "new array should be empty");
+    fail_unless(!test_int_array_pop(&arr, &value), "empty array should pop nothing");
+
+    /* the first items stay inline */
+    for(int i = 0; i < 4; ++i)
+    {
+        fail_unless(test_int_array_push(&arr, i), "push should succeed");
+    }
+    fail_unless(test_int_array_data(&arr) == arr.inline_items,
+        "small array should use its inline items");
+    fail_unless(test_int_array_capacity(&arr) == 4, "capacity should be the inline capacity");
+
+    for(int i = 4; i < 1000; ++i)
+    {
+        fail_unless(test_int_array_push(&arr, i), "push should succeed");
+    }
+    fail_unless(test_int_array_data(&arr) != arr.inline_items,
+        "large array should have moved to the heap");
+    fail_unless(test_int_array_size(&arr) == 1000, "array size is incorrect");
+    fail_unless(test_int_array_capacity(&arr) == 1024, "capacity should double");
+
+    int expected = 0;
+    int *pos;
+    octo_array_foreach(pos, &arr)
+    {
+        fail_unless(*pos == expected++, "items should keep their order");
+    }
+
+    for(int i = 999; i >= 0; --i)
+    {
+        fail_unless(test_int_array_pop(&arr, &value) && value == i,
+            "pop should return the last item");
+    }
+
+    test_int_array_destroy(&arr);
+    fail_unless(test_int_array_data(&arr) == arr.inline_items,
+        "destroyed array should be back to its inline items");
+}
+END_TEST
+
+START_TEST (test_octo_array_insert_remove)
+{
+    test_int_array arr;
+
+    test_int_array_init(&arr);
+    for(int i = 0; i < 10; ++i)
+    {
+        test_int_array_push(&arr, i);
+    }
+
+    test_int_array_insert(&arr, 0, -1);
+    test_int_array_insert(&arr, 5, 100);
+    test_int_array_insert(&arr, test_int_array_size(&arr), 200);
+    fail_unless(*test_int_array_at(&arr, 0) == -1, "insert at the front failed");
+    fail_unless(*test_int_array_at(&arr, 5) == 100, "insert in the middle failed");
+    fail_unless(*test_int_array_at(&arr, 6) == 4, "items after an insert should shift");
+    fail_unless(*test_int_array_at(&arr, 12) == 200, "insert at the end failed");
+
+    test_int_array_remove(&arr, 5);
+    test_int_array_remove(&arr, 0);
+    fail_unless(*test_int_array_at(&arr, 0) == 0 && *test_int_array_at(&arr, 4) == 4,
+        "remove should keep the order");
+
+    /* swap remove fills the hole with the last item */
+    test_int_array_swap_remove(&arr, 2);
+    fail_unless(*test_int_array_at(&arr, 2) == 200, "swap remove should move the last item");
+    fail_unless(test_int_array_size(&arr) == 10, "array size is incorrect");
+
+    test_int_array_clear(&arr);
+    fail_unless(test_int_array_size(&arr) == 0, "cleared array should be empty");
+    test_int_array_destroy(&arr);
+}
+END_TEST
+
+START_TEST (test_octo_array_sorted)
+{
+    test_int_array arr;
+    uint64_t state = 88172645463325252ULL;
+
+    test_int_array_init(&arr);
+    for(int i = 0; i < 1000; ++i)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        fail_unless(test_int_array_insert_sorted(&arr, state % 100),
+            "sorted insert should succeed");
+    }
+
+    for(size_t i = 1; i < test_int_array_size(&arr); ++i)
+    {
+        fail_unless(*test_int_array_at(&arr, i - 1) <= *test_int_array_at(&arr, i),
+            "items should be sorted");
+    }
+
+    int key = 50;
+    size_t bound = test_int_array_lower_bound(&arr, &key);
+    fail_unless(*test_int_array_at(&arr, bound) >= 50 &&
+        (bound == 0 || *test_int_array_at(&arr, bound - 1) < 50),
+        "lower bound should be the first item not less than the key");
+    test_int_array_destroy(&arr);
+
+    /* equal deadlines keep the order they were added in */
+    test_deadline_array deadlines;
+    test_deadline_array_init(&deadlines);
+    for(int i = 0; i < 30; ++i)
+    {
+        test_deadline d = {1.0 + i % 3, i};
+        test_deadline_array_insert_sorted(&deadlines, d);
+    }
+    for(size_t i = 1; i < test_deadline_array_size(&deadlines); ++i)
+    {
+        test_deadline *prev = test_deadline_array_at(&deadlines, i - 1);
+        test_deadline *cur = test_deadline_array_at(&deadlines, i);
+        fail_unless(prev->deadline < cur->deadline ||
+            (prev->deadline == cur->deadline && prev->id < cur->id),
+            "equal items should keep their order");
+    }
+    test_deadline_array_destroy(&deadlines);
+}
+END_TEST
+
+START_TEST (test_octo_array_append)
+{
+    test_iovec_array iovs;
+    struct iovec batch[20];
+    static char data[20];
+
+    for(int i = 0; i < 20; ++i)
+    {
+        batch[i].iov_base = &data[i];
+        batch[i].iov_len = i;
+    }
+
+    test_iovec_array_init(&iovs);
+    fail_unless(test_iovec_array_append(&iovs, batch, 5), "append should succeed");
+    fail_unless(test_iovec_array_data(&iovs) == iovs.inline_items,
+        "append within the inline capacity should not allocate");
+    fail_unless(test_iovec_array_append(&iovs, batch + 5, 15), "append should succeed");
+    fail_unless(test_iovec_array_size(&iovs) == 20, "array size is incorrect");
+    fail_unless(test_iovec_array_capacity(&iovs) == 20,
+        "a bulk append should grow to fit at once");
+
+    for(size_t i = 0; i < 20; ++i)
+    {
+        fail_unless(test_iovec_array_at(&iovs, i)->iov_base == &data[i] &&
+            test_iovec_array_at(&iovs, i)->iov_len == i,
+            "appended items should keep their order");
+    }
+
+    fail_unless(test_iovec_array_reserve(&iovs, 100), "reserve should succeed");
+    fail_unless(test_iovec_array_capacity(&iovs) >= 100, "reserve should grow the capacity");
+    test_iovec_array_destroy(&iovs);
+}
+END_TEST
+
+START_TEST (test_octo_array_append_self)
+{
+    test_int_array arr;
+    const int expect[] = {1, 2, 3, 1, 2, 3, 2, 3, 1, 2, 3};
+
+    test_int_array_init(&arr);
+    for(int i = 1; i <= 3; ++i)
+    {
+        test_int_array_push(&arr, i);
+    }
+
+    /* appending the array to itself moves it off the inline items and
+     * then reallocates it, the items are read from where they end up */
+    fail_unless(test_int_array_append(&arr, test_int_array_data(&arr), 3),
+        "self append should succeed");
+    fail_unless(test_int_array_data(&arr) != arr.inline_items,
+        "self append should have moved the items to the heap");
+    fail_unless(test_int_array_append(&arr, test_int_array_data(&arr) + 1, 5),
+        "self append should succeed");
+    fail_unless(test_int_array_size(&arr) == 11, "array size is incorrect");
+    for(size_t i = 0; i < 11; ++i)
+    {
+        fail_unless(*test_int_array_at(&arr, i) == expect[i],
+            "self append should copy the items as they were");
+    }
+
+    /* sizes that can't fit in memory are refused, not wrapped */
+    fail_unless(!test_int_array_append(&arr, test_int_array_data(&arr), SIZE_MAX),
+        "append past SIZE_MAX items should fail");
+    fail_unless(!test_int_array_reserve(&arr, SIZE_MAX/sizeof(int) + 1),
+        "reserve past SIZE_MAX bytes should fail");
+    fail_unless(test_int_array_size(&arr) == 11,
+        "a failed append should leave the array as it was");
+
+    test_int_array_destroy(&arr);
+}
+END_TEST
+
+TCase* octo_array_tcase()
+{
+    TCase* tc_octo_array = tcase_create("octo_array");
+    tcase_add_test(tc_octo_array, test_octo_array_push_pop);
+    tcase_add_test(tc_octo_array, test_octo_array_insert_remove);
+    tcase_add_test(tc_octo_array, test_octo_array_sorted);
+    tcase_add_test(tc_octo_array, test_octo_array_append);
+    tcase_add_test(tc_octo_array, test_octo_array_append_self);
+    return tc_octo_array;
+}
@@ -22,6 +22,10 @@
 
 #include <octonaut/buffer.h>
 #include <check.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
 
 START_TEST (test_octo_buffer_init_destroy)
 {
@@ -313,6 +317,558 @@ START_TEST (test_octo_buffer_peek_drain)
 }
 END_TEST
 
+static void test_release(void *ctx, void *data, size_t len)
+{
+    int *released = (int *)ctx;
+    *released += 1;
+}
+
+START_TEST (test_octo_buffer_write_ref)
+{
+    size_t len = 0;
+    int released = 0;
+    octo_buffer buf;
+    char mystr[] = "the world is not enough";
+    char cmpstr[sizeof(mystr)];
+    struct iovec iov[4];
+
+    octo_buffer_init(&buf, 8);
+
+    octo_buffer_write(&buf, "the ", 4);
+    len = octo_buffer_write_ref(&buf, &mystr[4], sizeof(mystr) - 4,
+            test_release, &released);
+
+    fail_unless(len == sizeof(mystr) - 4,
+        "buffer write_ref did not return length of string");
+
+    fail_unless(octo_buffer_size(&buf) == sizeof(mystr),
+        "buffer size is not correct");
+
+    len = octo_buffer_peekv(&buf, iov, 4);
+
+    fail_unless(len == 2,
+        "buffer peekv did not return one iovec per chunk");
+
+    fail_unless(iov[1].iov_base == &mystr[4],
+        "buffer peekv copied the referenced memory");
+
+    len = octo_buffer_peek(&buf, cmpstr, sizeof(mystr));
+
+    fail_unless(len == sizeof(mystr),
+        "buffer peek did not return length of string");
+
+    fail_unless(strncmp(cmpstr, mystr, sizeof(mystr)) == 0,
+        "buffer peek does not match expected string");
+
+    len = octo_buffer_drain(&buf, 10);
+
+    fail_unless(released == 0,
+        "referenced memory released while still in use");
+
+    /* writes after a reference must not land in the referenced memory */
+    octo_buffer_write(&buf, "!", 1);
+
+    fail_unless(strncmp(mystr, "the world is not enough", sizeof(mystr)) == 0,
+        "buffer write modified referenced memory");
+
+    len = octo_buffer_read(&buf, cmpstr, sizeof(mystr) - 10);
+
+    fail_unless(strncmp(cmpstr, "is not enough", sizeof(mystr) - 10) == 0,
+        "buffer read does not match expected string");
+
+    fail_unless(released == 1,
+        "referenced memory not released once read");
+
+    octo_buffer_write_ref(&buf, mystr, sizeof(mystr), test_release, &released);
+    octo_buffer_destroy(&buf);
+
+    fail_unless(released == 2,
+        "referenced memory not released by buffer_destroy");
+}
+END_TEST
+
+START_TEST (test_octo_buffer_write_file)
+{
+    size_t len = 0;
+    octo_buffer buf;
+    const char mystr[] = "the world is not enough";
+    char cmpstr[sizeof(mystr)];
+    FILE *file = tmpfile();
+
+    fwrite(mystr, 1, sizeof(mystr), file);
+    fflush(file);
+
+    octo_buffer_init(&buf, 0);
+
+    len = octo_buffer_write_file(&buf, fileno(file), 4, sizeof(mystr) - 4);
+    fclose(file);
+
+    fail_unless(len == sizeof(mystr) - 4,
+        "buffer write_file did not return length of region");
+
+    fail_unless(octo_buffer_size(&buf) == sizeof(mystr) - 4,
+        "buffer size is not correct");
+
+    len = octo_buffer_read(&buf, cmpstr, sizeof(mystr));
+
+    fail_unless(len == sizeof(mystr) - 4,
+        "buffer read did not return length of region");
+
+    fail_unless(strncmp(cmpstr, "world is not enough", sizeof(mystr) - 4) == 0,
+        "buffer read does not match file contents");
+
+    octo_buffer_destroy(&buf);
+}
+END_TEST
+
+START_TEST (test_octo_buffer_growth)
+{
+    size_t len = 0;
+    octo_buffer buf;
+    octo_buffer_stats stats;
+    static uint8_t data[1024*1024];
+    static uint8_t cmpdata[sizeof(data)];
+
+    for(size_t i = 0; i < sizeof(data); ++i)
+    {
+        data[i] = i % 251;
+    }
+
+    octo_buffer_init(&buf, 256);
+
+    for(size_t i = 0; i < sizeof(data); i += 4096)
+    {
+        octo_buffer_write(&buf, &data[i], 4096);
+    }
+
+    octo_buffer_get_stats(&buf, &stats);
+
+    fail_unless(stats.size == sizeof(data),
+        "buffer stats size is not correct");
+
+    fail_unless(stats.chunks == octo_buffer_chunks(&buf),
+        "buffer stats chunks is not correct");
+
+    fail_unless(stats.chunks < 40,
+        "buffer chunks did not grow");
+
+    fail_unless(stats.slack == stats.capacity - stats.size,
+        "buffer stats slack is not correct");
+
+    len = octo_buffer_read(&buf, cmpdata, sizeof(cmpdata));
+
+    fail_unless(len == sizeof(data),
+        "buffer read did not return length written");
+
+    fail_unless(memcmp(data, cmpdata, sizeof(data)) == 0,
+        "buffer read does not match data written");
+
+    octo_buffer_destroy(&buf);
+
+    octo_buffer_init(&buf, 256);
+    octo_buffer_set_chunk_max(&buf, 256);
+
+    octo_buffer_write(&buf, data, 4096);
+
+    fail_unless(octo_buffer_chunks(&buf) == 16,
+        "buffer grew past its max chunk size");
+
+    octo_buffer_destroy(&buf);
+
+    octo_buffer_init(&buf, 256);
+    octo_buffer_hint(&buf, 10000);
+
+    for(size_t i = 0; i < 10000; i += 100)
+    {
+        octo_buffer_write(&buf, &data[i], 100);
+    }
+
+    octo_buffer_get_stats(&buf, &stats);
+
+    fail_unless(stats.chunks == 1,
+        "buffer did not size its chunk from the hint");
+
+    fail_unless(stats.slack == 0,
+        "buffer hint left slack");
+
+    octo_buffer_destroy(&buf);
+
+    octo_buffer_init(&buf, 4096);
+    octo_buffer_hint(&buf, 10);
+
+    fail_unless(buf.chunk_size == 4096,
+        "a small hint should not shrink the chunk size");
+
+    octo_buffer_destroy(&buf);
+}
+END_TEST
+
+START_TEST (test_octo_buffer_inline)
+{
+    size_t len = 0;
+    octo_buffer buf;
+    const char mystr[] = "the world is not enough";
+    char cmpstr[4*sizeof(mystr)];
+
+    octo_buffer_init(&buf, 0);
+
+    len = octo_buffer_write(&buf, "Content-Type", 12);
+
+    fail_unless(len == 12,
+        "buffer write did not return length of string");
+
+    fail_unless(octo_buffer_chunks(&buf) == 0,
+        "small buffer allocated a chunk");
+
+    len = octo_buffer_read(&buf, cmpstr, 8);
+
+    fail_unless(len == 8 && strncmp(cmpstr, "Content-", 8) == 0,
+        "buffer read does not match expected string");
+
+    /* fits only once the remaining bytes are moved to the front */
+    len = octo_buffer_write(&buf, (uint8_t*)mystr, sizeof(mystr));
+
+    fail_unless(octo_buffer_chunks(&buf) == 0,
+        "small buffer allocated a chunk");
+
+    fail_unless(octo_buffer_size(&buf) == 4 + sizeof(mystr),
+        "buffer size is not correct");
+
+    /* spill in to a chunk keeping the order of bytes */
+    len = octo_buffer_write(&buf, (uint8_t*)mystr, sizeof(mystr));
+
+    fail_unless(octo_buffer_chunks(&buf) == 1,
+        "buffer did not spill in to a chunk");
+
+    len = octo_buffer_peek(&buf, cmpstr, sizeof(cmpstr));
+
+    fail_unless(len == 4 + 2*sizeof(mystr),
+        "buffer peek did not return buffer size");
+
+    fail_unless(strncmp(cmpstr, "Type", 4) == 0
+        && memcmp(&cmpstr[4], mystr, sizeof(mystr)) == 0
+        && memcmp(&cmpstr[4 + sizeof(mystr)], mystr, sizeof(mystr)) == 0,
+        "buffer peek does not match expected string");
+
+    len = octo_buffer_drain(&buf, sizeof(cmpstr));
+
+    fail_unless(len == 4 + 2*sizeof(mystr),
+        "buffer drain did not return buffer size");
+
+    fail_unless(octo_buffer_chunks(&buf) == 0,
+        "empty buffer kept a chunk");
+
+    len = octo_buffer_write(&buf, "Host", 4);
+
+    fail_unless(octo_buffer_chunks(&buf) == 0,
+        "drained buffer did not return to inline storage");
+
+    octo_buffer_destroy(&buf);
+}
+END_TEST
+
+typedef struct test_shed_ctx
+{
+    int calls;
+    octo_buffer *shed;
+} test_shed_ctx;
+
+static void test_shed(void *ctx, octo_buffer_budget *budget, size_t wanted)
+{
+    test_shed_ctx *shed = (test_shed_ctx *)ctx;
+    shed->calls += 1;
+    shed->shed = octo_buffer_budget_largest(budget);
+    octo_buffer_drain(shed->shed, octo_buffer_size(shed->shed));
+}
+
+START_TEST (test_octo_buffer_budget)
+{
+    size_t len = 0;
+    octo_buffer_budget process;
+    octo_buffer_budget conn1;
+    octo_buffer_budget conn2;
+    octo_buffer buf1;
+    octo_buffer buf2;
+    test_shed_ctx shed = { .calls = 0, .shed = NULL };
+    static uint8_t data[8192];
+
+    octo_buffer_budget_init(&process, NULL, 4096);
+    octo_buffer_budget_init(&conn1, &process, 1024);
+    octo_buffer_budget_init(&conn2, &process, 0);
+
+    octo_buffer_init(&buf1, 256);
+    octo_buffer_init(&buf2, 256);
+    octo_buffer_attach(&buf1, &conn1);
+    octo_buffer_attach(&buf2, &conn2);
+
+    /* per connection limit */
+    len = octo_buffer_write(&buf1, data, 2048);
+
+    fail_unless(len == 1024,
+        "buffer write did not stop at the connection budget");
+
+    fail_unless(octo_buffer_budget_used(&conn1) == 1024
+        && octo_buffer_budget_used(&process) == 1024,
+        "budget used is not correct");
+
+    fail_unless(octo_buffer_budget_largest_child(&process) == &conn1,
+        "largest child budget is not correct");
+
+    /* process wide limit */
+    len = octo_buffer_write(&buf2, data, 8192);
+
+    fail_unless(len == 3072,
+        "buffer write did not stop at the process budget");
+
+    fail_unless(octo_buffer_budget_available(&conn1) == 0,
+        "budget available is not correct");
+
+    /* the callback sheds the largest consumer, letting the write go on */
+    octo_buffer_budget_set_cb(&process, test_shed, &shed);
+
+    len = octo_buffer_write(&buf1, data, 100);
+
+    fail_unless(shed.calls == 1 && shed.shed == &buf2,
+        "budget callback did not shed the largest buffer");
+
+    fail_unless(octo_buffer_budget_used(&process) == 1024,
+        "budget used is not correct after shedding");
+
+    fail_unless(len == 0,
+        "buffer write went over the connection budget");
+
+    octo_buffer_drain(&buf1, octo_buffer_size(&buf1));
+
+    fail_unless(octo_buffer_budget_used(&process) == 0,
+        "drained buffers still count against the budget");
+
+    len = octo_buffer_write(&buf1, data, 100);
+
+    fail_unless(len == 100,
+        "buffer write did not succeed under budget");
+
+    octo_buffer_destroy(&buf1);
+    octo_buffer_destroy(&buf2);
+
+    fail_unless(octo_buffer_budget_used(&process) == 0,
+        "destroyed buffers still count against the budget");
+
+    octo_buffer_budget_destroy(&conn1);
+    octo_buffer_budget_destroy(&conn2);
+    octo_buffer_budget_destroy(&process);
+}
+END_TEST
+
+START_TEST (test_octo_buffer_budget_inline)
+{
+    octo_buffer_budget small;
+    octo_buffer_budget tight;
+    octo_buffer buf;
+    uint8_t data[64];
+    uint8_t out[64];
+
+    for(int i = 0; i < 64; ++i)
+    {
+        data[i] = i;
+    }
+
+    /* inline contents that don't fit the budget stay inline */
+    octo_buffer_budget_init(&small, NULL, 16);
+    octo_buffer_init(&buf, 256);
+    octo_buffer_attach(&buf, &small);
+
+    fail_unless(octo_buffer_write(&buf, data, 32) == 32, "inline write should succeed");
+    fail_unless(octo_buffer_write(&buf, data, 1) == 0,
+        "write should fail when the budget can't hold the inline contents");
+    fail_unless(octo_buffer_write_ref(&buf, data, 8, NULL, NULL) == 0,
+        "write_ref should fail when the budget can't hold the inline contents");
+    fail_unless(octo_buffer_budget_used(&small) == 0, "failed writes should reserve nothing");
+    fail_unless(octo_buffer_read(&buf, out, 64) == 32 && memcmp(out, data, 32) == 0,
+        "inline contents should be intact");
+    octo_buffer_destroy(&buf);
+
+    /* the first chunk holds the inline contents and as much more as fits */
+    octo_buffer_budget_init(&tight, NULL, 40);
+    octo_buffer_init(&buf, 256);
+    octo_buffer_attach(&buf, &tight);
+
+    fail_unless(octo_buffer_write(&buf, data, 32) == 32, "inline write should succeed");
+    fail_unless(octo_buffer_write(&buf, &data[32], 20) == 8,
+        "write should be partially accepted up to the budget");
+    fail_unless(octo_buffer_budget_used(&tight) == 40, "budget used is not correct");
+    fail_unless(octo_buffer_read(&buf, out, 64) == 40 && memcmp(out, data, 40) == 0,
+        "buffer contents are not correct");
+
+    octo_buffer_destroy(&buf);
+    octo_buffer_budget_destroy(&small);
+    octo_buffer_budget_destroy(&tight);
+}
+END_TEST
+
+#define TEST_BUDGET_THREADS 4
+#define TEST_BUDGET_LIMIT (64*1024)
+
+static octo_buffer_budget test_shared_budget;
+
+static void * test_budget_writer(void *arg)
+{
+    octo_buffer *buf = arg;
+    static uint8_t data[100];
+
+    while(octo_buffer_write(buf, data, sizeof(data)) == sizeof(data))
+    {
+    }
+    return NULL;
+}
+
+START_TEST (test_octo_buffer_budget_shared)
+{
+    octo_buffer bufs[TEST_BUDGET_THREADS];
+    octo_buffer_budget conns[TEST_BUDGET_THREADS];
+    pthread_t threads[TEST_BUDGET_THREADS];
+    size_t total = 0;
+
+    octo_buffer_budget_init(&test_shared_budget, NULL, TEST_BUDGET_LIMIT);
+
+    for(int i = 0; i < TEST_BUDGET_THREADS; ++i)
+    {
+        octo_buffer_budget_init(&conns[i], &test_shared_budget, 0);
+        octo_buffer_init(&bufs[i], 64);
+        octo_buffer_attach(&bufs[i], &conns[i]);
+    }
+    for(int i = 0; i < TEST_BUDGET_THREADS; ++i)
+    {
+        pthread_create(&threads[i], NULL, test_budget_writer, &bufs[i]);
+    }
+    for(int i = 0; i < TEST_BUDGET_THREADS; ++i)
+    {
+        pthread_join(threads[i], NULL);
+        total += octo_buffer_budget_used(&conns[i]);
+    }
+
+    fail_unless(octo_buffer_budget_used(&test_shared_budget) <= TEST_BUDGET_LIMIT,
+        "threads sharing a budget went over its limit");
+    fail_unless(total == octo_buffer_budget_used(&test_shared_budget),
+        "child budgets don't add up to the shared budget");
+
+    for(int i = 0; i < TEST_BUDGET_THREADS; ++i)
+    {
+        octo_buffer_destroy(&bufs[i]);
+        octo_buffer_budget_destroy(&conns[i]);
+    }
+    fail_unless(octo_buffer_budget_used(&test_shared_budget) == 0,
+        "destroyed buffers still count against the budget");
+    octo_buffer_budget_destroy(&test_shared_budget);
+}
+END_TEST
+
+START_TEST (test_octo_buffer_spill)
+{
+    size_t len = 0;
+    octo_buffer buf;
+    octo_buffer_stats stats;
+    int fd = -1;
+    off_t offset = 0;
+    static uint8_t data[64*1024];
+    static uint8_t cmpdata[sizeof(data)];
+    struct iovec iov[4];
+
+    for(size_t i = 0; i < sizeof(data); ++i)
+    {
+        data[i] = i % 251;
+    }
+
+    octo_buffer_init(&buf, 1024);
+    octo_buffer_set_chunk_max(&buf, 1024);
+
+    fail_unless(octo_buffer_set_spill(&buf, 4096, NULL),
+        "buffer spill file could not be created");
+
+    for(size_t i = 0; i < sizeof(data); i += 1000)
+    {
+        octo_buffer_write(&buf, &data[i], min(1000, sizeof(data) - i));
+    }
+
+    octo_buffer_get_stats(&buf, &stats);
+
+    fail_unless(stats.size == sizeof(data),
+        "buffer size is not correct");
+
+    fail_unless(stats.size - stats.spilled <= 4096,
+        "buffer kept more than the spill threshold in memory");
+
+    fail_unless(octo_buffer_peekv(&buf, iov, 4) == 0,
+        "buffer peekv returned spilled chunks");
+
+    fail_unless(octo_buffer_peekfile(&buf, &fd, &offset, &len),
+        "buffer peekfile did not find spilled bytes");
+
+    fail_unless(fd != -1 && offset == 0 && len == 1024,
+        "buffer peekfile did not return the oldest chunk");
+
+    len = octo_buffer_peek(&buf, cmpdata, sizeof(cmpdata));
+
+    fail_unless(len == sizeof(data) && memcmp(data, cmpdata, sizeof(data)) == 0,
+        "buffer peek does not match data written");
+
+    octo_buffer_drain(&buf, 100);
+    len = octo_buffer_read(&buf, cmpdata, sizeof(cmpdata));
+
+    fail_unless(len == sizeof(data) - 100
+        && memcmp(&data[100], cmpdata, sizeof(data) - 100) == 0,
+        "buffer read does not match data written");
+
+    octo_buffer_get_stats(&buf, &stats);
+
+    fail_unless(stats.spilled == 0,
+        "buffer spilled bytes not consumed by read");
+
+    octo_buffer_destroy(&buf);
+}
+END_TEST
+
+START_TEST (test_octo_buffer_trim)
+{
+    size_t released = 0;
+    octo_buffer buf;
+    octo_buffer_stats stats;
+    const char mystr[] = "the world is not enough";
+    char cmpstr[sizeof(mystr)];
+    static uint8_t data[4096];
+
+    octo_buffer_init(&buf, 256);
+
+    /* mostly drained chunks shrink to fit */
+    octo_buffer_write(&buf, data, sizeof(data));
+    octo_buffer_write(&buf, (uint8_t*)mystr, sizeof(mystr));
+    octo_buffer_drain(&buf, sizeof(data) - 100);
+
+    released = octo_buffer_trim(&buf);
+
+    octo_buffer_get_stats(&buf, &stats);
+
+    fail_unless(released > 0 && stats.slack == 0,
+        "buffer trim did not shrink chunks");
+
+    fail_unless(octo_buffer_size(&buf) == 100 + sizeof(mystr),
+        "buffer trim changed the buffer size");
+
+    /* residual bytes move inline */
+    octo_buffer_drain(&buf, 100);
+    released = octo_buffer_trim(&buf);
+
+    fail_unless(released > 0 && octo_buffer_chunks(&buf) == 0,
+        "buffer trim did not move residual bytes inline");
+
+    octo_buffer_read(&buf, cmpstr, sizeof(cmpstr));
+
+    fail_unless(memcmp(cmpstr, mystr, sizeof(mystr)) == 0,
+        "buffer read after trim does not match expected string");
+
+    octo_buffer_destroy(&buf);
+}
+END_TEST
+
 TCase* octo_buffer_tcase()
 {
     TCase* tc_octo_buffer = tcase_create("octo_buffer");
@@ -321,5 +877,14 @@ TCase* octo_buffer_tcase()
     tcase_add_test(tc_octo_buffer, test_octo_buffer_write);
     tcase_add_test(tc_octo_buffer, test_octo_buffer_read);
     tcase_add_test(tc_octo_buffer, test_octo_buffer_peek_drain);
+    tcase_add_test(tc_octo_buffer, test_octo_buffer_write_ref);
+    tcase_add_test(tc_octo_buffer, test_octo_buffer_write_file);
+    tcase_add_test(tc_octo_buffer, test_octo_buffer_growth);
+    tcase_add_test(tc_octo_buffer, test_octo_buffer_inline);
+    tcase_add_test(tc_octo_buffer, test_octo_buffer_budget);
+    tcase_add_test(tc_octo_buffer, test_octo_buffer_budget_inline);
+    tcase_add_test(tc_octo_buffer, test_octo_buffer_budget_shared);
+    tcase_add_test(tc_octo_buffer, test_octo_buffer_spill);
+    tcase_add_test(tc_octo_buffer, test_octo_buffer_trim);
     return tc_octo_buffer;
 }
@@ -0,0 +1,165 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <octonaut/common.h>
+#include <octonaut/hash_function.h>
+#include <octonaut/chash.h>
+#include <check.h>
+#include <stdlib.h>
+
+typedef struct test_chash_struct
+{
+    uint32_t value;
+    uint32_t hits;
+    octo_hash_entry hash;
+} test_chash_struct;
+
+START_TEST (test_octo_chash_put_get_pop)
+{
+    octo_chash hash;
+    test_chash_struct s[100];
+
+    fail_unless(octo_chash_init(&hash, octo_default_hash_function, 0, 3, 2),
+        "init should succeed");
+
+    for(uint32_t i = 0; i < 100; ++i)
+    {
+        s[i].value = i;
+        octo_hash_entry_init(&s[i].hash, &s[i].value, sizeof(s[i].value));
+        fail_unless(octo_chash_put(&hash, &s[i].hash),
+            "put should succeed");
+    }
+
+    fail_unless(!octo_chash_put(&hash, &s[5].hash),
+        "double put of the same key should result in failing to put");
+    fail_unless(octo_chash_size(&hash) == 100,
+        "hash table size is incorrect");
+
+    for(uint32_t i = 0; i < 100; ++i)
+    {
+        fail_unless(octo_chash_get(&hash, &i, sizeof(i)) == &s[i].hash,
+            "hash table failed to retrieve correct entry");
+    }
+
+    uint32_t key = 42;
+    fail_unless(octo_chash_pop(&hash, &key, sizeof(key)) == &s[42].hash,
+        "hash table failed to pop correct entry");
+    fail_unless(!octo_chash_has(&hash, &key, sizeof(key)),
+        "popped entry should be gone");
+    fail_unless(octo_chash_size(&hash) == 99,
+        "hash table size is incorrect");
+
+    octo_chash_destroy(&hash);
+}
+END_TEST
+
+static void test_chash_hit(octo_hash_entry *entry, void *ctx)
+{
+    test_chash_struct *s = ptr_offset(entry, test_chash_struct, hash);
+    __atomic_add_fetch(&s->hits, 1, __ATOMIC_RELAXED);
+}
+
+typedef struct test_chash_thread
+{
+    pthread_t thread;
+    octo_chash *hash;
+    test_chash_struct own[1000];
+} test_chash_thread;
+
+static void * test_chash_worker(void *arg)
+{
+    test_chash_thread *t = arg;
+    bool ok = true;
+
+    /* each thread churns its own keys while all of them read shared keys */
+    for(int round = 0; round < 20; ++round)
+    {
+        for(int i = 0; i < 1000; ++i)
+        {
+            ok = octo_chash_put(t->hash, &t->own[i].hash) && ok;
+            ok = octo_chash_apply(t->hash, &i, sizeof(i), test_chash_hit, NULL) && ok;
+        }
+        for(int i = 0; i < 1000; ++i)
+        {
+            ok = octo_chash_pop(t->hash, &t->own[i].value, sizeof(uint32_t)) == &t->own[i].hash && ok;
+        }
+    }
+
+    return ok ? t : NULL;
+}
+
+START_TEST (test_octo_chash_threads)
+{
+    octo_chash hash;
+    test_chash_struct shared[1000];
+    test_chash_thread *threads = calloc(8, sizeof(test_chash_thread));
+
+    octo_chash_init(&hash, octo_default_hash_function, 0, 4, 0);
+
+    for(uint32_t i = 0; i < 1000; ++i)
+    {
+        shared[i].value = i;
+        shared[i].hits = 0;
+        octo_hash_entry_init(&shared[i].hash, &shared[i].value, sizeof(uint32_t));
+        octo_chash_put(&hash, &shared[i].hash);
+    }
+
+    for(int t = 0; t < 8; ++t)
+    {
+        threads[t].hash = &hash;
+        for(uint32_t i = 0; i < 1000; ++i)
+        {
+            threads[t].own[i].value = 1000*(t + 1) + i;
+            octo_hash_entry_init(&threads[t].own[i].hash,
+                &threads[t].own[i].value, sizeof(uint32_t));
+        }
+        pthread_create(&threads[t].thread, NULL, test_chash_worker, &threads[t]);
+    }
+
+    for(int t = 0; t < 8; ++t)
+    {
+        void *result;
+        pthread_join(threads[t].thread, &result);
+        fail_unless(result == &threads[t],
+            "every put, lookup, and pop in a thread should succeed");
+    }
+
+    fail_unless(octo_chash_size(&hash) == 1000,
+        "only the shared entries should be left");
+    for(int i = 0; i < 1000; ++i)
+    {
+        fail_unless(shared[i].hits == 8*20,
+            "every thread should have found every shared entry");
+    }
+
+    octo_chash_destroy(&hash);
+    free(threads);
+}
+END_TEST
+
+TCase* octo_chash_tcase()
+{
+    TCase* tc_octo_chash = tcase_create("octo_chash");
+    tcase_add_test(tc_octo_chash, test_octo_chash_put_get_pop);
+    tcase_add_test(tc_octo_chash, test_octo_chash_threads);
+    return tc_octo_chash;
+}
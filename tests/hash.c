@@ -20,9 +20,11 @@
  * THE SOFTWARE.
  */
 
+#include <octonaut/common.h>
 #include <octonaut/hash_function.h>
 #include <octonaut/hash.h>
 #include <check.h>
+#include <stdlib.h>
 
 START_TEST (test_octo_hash_create)
 {
@@ -256,7 +258,372 @@ START_TEST (test_octo_hash_strings)
 }
 END_TEST
 
+START_TEST (test_octo_hash_resize)
+{
+    octo_hash hash;
+    size_t count = 10000;
+    test_hash_struct *s = malloc(sizeof(test_hash_struct)*count);
+
+    octo_hash_init(&hash, octo_default_hash_function, 0, 2);
+
+    for(int i = 0; i < count; ++i)
+    {
+        s[i].value = i;
+        octo_hash_entry_init(&s[i].hash, &s[i].value, sizeof(s[i].value));
+        fail_unless(octo_hash_put(&hash, &s[i].hash),
+            "put should succeed");
+
+        /* every entry put so far is found part way through moving bins */
+        if(i % 1000 == 0 || hash.old_bins != NULL)
+        {
+            for(int j = 0; j <= i; j += 97)
+            {
+                fail_unless(octo_hash_get(&hash, &j, sizeof(j)) == &s[j].hash,
+                    "hash table failed to retrieve correct entry while resizing");
+            }
+        }
+    }
+
+    fail_unless(octo_hash_size(&hash) == count,
+        "hash table size is incorrect");
+    fail_unless(hash.n_hash_bins >= count/2,
+        "hash table should have grown with its load");
+
+    for(int i = 0; i < count; ++i)
+    {
+        fail_unless(octo_hash_get(&hash, &i, sizeof(i)) == &s[i].hash,
+            "hash table failed to retrieve correct entry after resizing");
+    }
+
+    for(int i = 0; i < count; ++i)
+    {
+        fail_unless(octo_hash_pop(&hash, &i, sizeof(i)) == &s[i].hash,
+            "hash table failed to pop correct entry while resizing");
+
+        int j = count - 1;
+        fail_unless(i == j || octo_hash_has(&hash, &j, sizeof(j)),
+            "hash table lost an entry while shrinking");
+    }
+
+    fail_unless(octo_hash_size(&hash) == 0,
+        "hash table size is incorrect");
+    fail_unless(hash.n_hash_bins <= 64,
+        "hash table should have shrunk back towards its initial size");
+    fail_unless(hash.n_hash_bins >= 4,
+        "hash table should not shrink below its initial size");
+
+    octo_hash_destroy(&hash);
+    free(s);
+}
+END_TEST
+
+static size_t test_hash_calls = 0;
+
+static uint32_t test_hash_counted(const void *key, size_t keylen, uint32_t seed)
+{
+    test_hash_calls += 1;
+    return octo_default_hash_function(key, keylen, seed);
+}
+
+START_TEST (test_octo_hash_cached_hash)
+{
+    octo_hash hash;
+    test_hash_struct s[1000];
+
+    test_hash_calls = 0;
+    octo_hash_init(&hash, test_hash_counted, 0, 0);
+
+    for(int i = 0; i < 1000; ++i)
+    {
+        s[i].value = i;
+        octo_hash_entry_init(&s[i].hash, &s[i].value, sizeof(s[i].value));
+        octo_hash_put(&hash, &s[i].hash);
+    }
 
+    fail_unless(test_hash_calls == 1000,
+        "resizing should reuse the hash kept in each entry");
+
+    int key = 500;
+    uint32_t keyhash = octo_hash_hash(&hash, &key, sizeof(key));
+
+    fail_unless(keyhash == s[500].hash.hash,
+        "entry should keep the hash of its key");
+    fail_unless(octo_hash_get_h(&hash, &key, sizeof(key), keyhash) == &s[500].hash,
+        "hash table failed to retrieve correct entry with a given hash");
+    fail_unless(octo_hash_get_h(&hash, &key, sizeof(key), keyhash + 1) == NULL,
+        "an entry should only be found with the hash of its key");
+    fail_unless(test_hash_calls == 1001,
+        "a given hash should not be computed again");
+
+    octo_hash_destroy(&hash);
+}
+END_TEST
+
+START_TEST (test_octo_hash_iter)
+{
+    octo_hash hash;
+    octo_hash_iterator iter;
+    size_t count = 1030;
+    test_hash_struct *s = malloc(sizeof(test_hash_struct)*count);
+    char *seen = calloc(count, 1);
+
+    octo_hash_init(&hash, octo_default_hash_function, 0, 0);
+
+    fail_unless(octo_hash_iter(&hash, &iter) == NULL,
+        "an empty table has nothing to iterate");
+    fail_unless(octo_hash_iternext(&iter) == NULL,
+        "a finished iterator stays finished");
+
+    for(int i = 0; i < count; ++i)
+    {
+        s[i].value = i;
+        octo_hash_entry_init(&s[i].hash, &s[i].value, sizeof(s[i].value));
+        octo_hash_put(&hash, &s[i].hash);
+    }
+
+    /* grown to 2048 bins at 1025 entries with only a few bins moved */
+    fail_unless(hash.old_bins != NULL,
+        "the table should be part way through resizing");
+
+    /* every entry once, removing the odd ones along the way */
+    size_t visited = 0;
+    for(octo_hash_entry *entry = octo_hash_iter(&hash, &iter); entry != NULL;
+            entry = octo_hash_iternext(&iter))
+    {
+        test_hash_struct *t = ptr_offset(entry, test_hash_struct, hash);
+        fail_unless(seen[t->value] == 0,
+            "iterator visited an entry twice");
+        seen[t->value] = 1;
+        visited += 1;
+
+        if(t->value % 2)
+        {
+            octo_hash_iterremove(&iter);
+        }
+    }
+
+    fail_unless(visited == count,
+        "iterator should visit every entry");
+    fail_unless(octo_hash_size(&hash) == count/2,
+        "removed entries should be gone from the size");
+
+    for(int i = 0; i < count; ++i)
+    {
+        fail_unless(octo_hash_has(&hash, &i, sizeof(i)) == (i % 2 == 0),
+            "only the removed entries should be gone");
+    }
+
+    octo_hash_destroy(&hash);
+    free(seen);
+    free(s);
+}
+END_TEST
+
+static size_t test_hash_cleared = 0;
+
+static void test_hash_clear_cb(octo_hash_entry *entry)
+{
+    fail_unless(entry->next == NULL,
+        "cleared entry should be unlinked");
+    test_hash_cleared += 1;
+}
+
+START_TEST (test_octo_hash_clear)
+{
+    octo_hash hash;
+    test_hash_struct s[100];
+
+    octo_hash_init(&hash, octo_default_hash_function, 0, 0);
+
+    for(int i = 0; i < 100; ++i)
+    {
+        s[i].value = i;
+        octo_hash_entry_init(&s[i].hash, &s[i].value, sizeof(s[i].value));
+        octo_hash_put(&hash, &s[i].hash);
+    }
+
+    test_hash_cleared = 0;
+    octo_hash_clear(&hash, test_hash_clear_cb);
+
+    fail_unless(test_hash_cleared == 100,
+        "clear should call back with every entry");
+    fail_unless(octo_hash_size(&hash) == 0,
+        "cleared table should be empty");
+    fail_unless(hash.old_bins == NULL,
+        "cleared table has nothing left to move");
+
+    int key = 5;
+    fail_unless(octo_hash_get(&hash, &key, sizeof(key)) == NULL,
+        "cleared table should not find entries");
+    fail_unless(octo_hash_put(&hash, &s[5].hash),
+        "cleared table should take entries again");
+
+    octo_hash_destroy(&hash);
+}
+END_TEST
+
+START_TEST (test_octo_hash_get_many)
+{
+    octo_hash hash;
+    test_hash_struct s[100];
+    int keys[40];
+    void *keyptrs[40];
+    size_t keylens[40];
+    octo_hash_entry *out[40];
+
+    octo_hash_init(&hash, octo_default_hash_function, 0, 4);
+
+    for(int i = 0; i < 100; ++i)
+    {
+        s[i].value = i;
+        octo_hash_entry_init(&s[i].hash, &s[i].value, sizeof(s[i].value));
+        octo_hash_put(&hash, &s[i].hash);
+    }
+
+    /* more keys than a batch, every third one missing */
+    for(int i = 0; i < 40; ++i)
+    {
+        keys[i] = i % 3 ? i*2 : 1000 + i;
+        keyptrs[i] = &keys[i];
+        keylens[i] = sizeof(keys[i]);
+    }
+
+    fail_unless(octo_hash_get_many(&hash, keyptrs, keylens, 40, out) == 26,
+        "hash table found the wrong number of entries");
+
+    for(int i = 0; i < 40; ++i)
+    {
+        fail_unless(out[i] == (i % 3 ? &s[i*2].hash : NULL),
+            "hash table failed to retrieve correct entry");
+    }
+
+    octo_hash_destroy(&hash);
+}
+END_TEST
+
+static uint32_t test_hash_collide(const void *key, size_t keylen, uint32_t seed)
+{
+    return 0;
+}
+
+typedef struct test_hash_samples
+{
+    size_t samples;
+    size_t probes;
+    size_t found;
+} test_hash_samples;
+
+static void test_hash_sample(void *ctx, const octo_hash *hashtable, size_t probes, bool found)
+{
+    test_hash_samples *samples = ctx;
+    samples->samples += 1;
+    samples->probes += probes;
+    samples->found += found;
+}
+
+START_TEST (test_octo_hash_stats)
+{
+    octo_hash hash;
+    octo_hash_stats stats;
+    test_hash_struct s[10];
+
+    /* every entry in one chain of 16 bins */
+    octo_hash_init(&hash, test_hash_collide, 0, 4);
+
+    for(int i = 0; i < 10; ++i)
+    {
+        s[i].value = i;
+        octo_hash_entry_init(&s[i].hash, &s[i].value, sizeof(s[i].value));
+        octo_hash_put(&hash, &s[i].hash);
+    }
+
+    octo_hash_get_stats(&hash, &stats);
+
+    fail_unless(stats.size == 10 && stats.bins == 16,
+        "stats should count entries and bins");
+    fail_unless(stats.load_factor == 10.0/16,
+        "load factor is incorrect");
+    fail_unless(stats.longest_chain == 10,
+        "longest chain is incorrect");
+    fail_unless(stats.chains[0] == 15 && stats.chains[OCTO_HASH_STATS_CHAINS - 1] == 1,
+        "chain length histogram is incorrect");
+    fail_unless(stats.probes_hit == 5.5,
+        "average probes for a hit is incorrect");
+    fail_unless(stats.probes_miss == 10.0/16,
+        "average probes for a miss is incorrect");
+
+    /* every other lookup sampled, the first put entry is at the end */
+    test_hash_samples samples = {0, 0, 0};
+    octo_hash_set_sampler(&hash, test_hash_sample, &samples, 2);
+
+    for(int i = 0; i < 10; ++i)
+    {
+        int key = i % 2 ? 0 : 100;
+        octo_hash_get(&hash, &key, sizeof(key));
+    }
+
+    fail_unless(samples.samples == 5,
+        "every other lookup should be sampled");
+    fail_unless(samples.found == 5 && samples.probes == 50,
+        "samples should count entries compared");
+
+    octo_hash_set_sampler(&hash, NULL, NULL, 0);
+    octo_hash_get(&hash, &s[0].value, sizeof(int));
+    octo_hash_get(&hash, &s[0].value, sizeof(int));
+    fail_unless(samples.samples == 5,
+        "lookups should no longer be sampled");
+
+    octo_hash_destroy(&hash);
+}
+END_TEST
+
+START_TEST (test_octo_hash_flood_guard)
+{
+    octo_hash guarded;
+    octo_hash unguarded;
+    octo_hash_stats stats;
+    test_hash_struct s[64];
+    test_hash_struct t[64];
+
+    octo_hash_init(&guarded, test_hash_collide, 0, 6);
+    octo_hash_init(&unguarded, test_hash_collide, 0, 6);
+    octo_hash_set_flood_guard(&guarded, 4);
+
+    for(int i = 0; i < 64; ++i)
+    {
+        s[i].value = i;
+        octo_hash_entry_init(&s[i].hash, &s[i].value, sizeof(s[i].value));
+        fail_unless(octo_hash_put(&guarded, &s[i].hash),
+            "put should succeed");
+        t[i].value = i;
+        octo_hash_entry_init(&t[i].hash, &t[i].value, sizeof(t[i].value));
+        octo_hash_put(&unguarded, &t[i].hash);
+    }
+
+    fail_unless(guarded.hash_function == octo_hash_siphash13,
+        "a long chain should switch the guarded table to a keyed hash");
+    fail_unless(unguarded.hash_function == test_hash_collide,
+        "an unguarded table should keep its hash function");
+    fail_unless(octo_hash_size(&guarded) == 64,
+        "hash table size is incorrect");
+
+    octo_hash_get_stats(&guarded, &stats);
+    fail_unless(stats.longest_chain <= 8,
+        "keyed hash should spread entries over bins");
+    octo_hash_get_stats(&unguarded, &stats);
+    fail_unless(stats.longest_chain == 64,
+        "unguarded table should have every entry in one chain");
+
+    for(int i = 0; i < 64; ++i)
+    {
+        fail_unless(octo_hash_get(&guarded, &i, sizeof(i)) == &s[i].hash,
+            "hash table failed to retrieve correct entry after switching hash");
+    }
+
+    octo_hash_destroy(&guarded);
+    octo_hash_destroy(&unguarded);
+}
+END_TEST
 
 TCase* octo_hash_tcase()
 {
@@ -265,6 +632,13 @@ TCase* octo_hash_tcase()
     tcase_add_test(tc_octo_hash, test_octo_hash_put_get_remove);
     tcase_add_test(tc_octo_hash, test_octo_hash_chaining);
     tcase_add_test(tc_octo_hash, test_octo_hash_strings);
+    tcase_add_test(tc_octo_hash, test_octo_hash_resize);
+    tcase_add_test(tc_octo_hash, test_octo_hash_cached_hash);
+    tcase_add_test(tc_octo_hash, test_octo_hash_iter);
+    tcase_add_test(tc_octo_hash, test_octo_hash_clear);
+    tcase_add_test(tc_octo_hash, test_octo_hash_get_many);
+    tcase_add_test(tc_octo_hash, test_octo_hash_stats);
+    tcase_add_test(tc_octo_hash, test_octo_hash_flood_guard);
     /*
     tcase_add_test(tc_octo_hash, test_octo_hash_prepend);
     tcase_add_test(tc_octo_hash, test_octo_hash_append);
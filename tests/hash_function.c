@@ -23,6 +23,7 @@
 #include <octonaut/hash_function.h>
 #include <check.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/time.h>
 
 static const char bigmsg[] = "/hey/man/nice/shot?what&what;123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235123456123412345612341235";
@@ -78,25 +79,218 @@ static void test_speed(octo_hash_function func, const char *name)
 }
 
 
+/**
+ * hashes of a few keys with seed 42 that must never change, tables may
+ * be persisted with them
+ */
+static void test_stable(octo_hash_function func, const uint32_t expected[4])
+{
+    const char *keys[4] = {
+        "",
+        "Host",
+        "Content-Length",
+        "/hey/man/nice/shot?what&what;123456123412345612341235123456"
+    };
+
+    for(int i = 0; i < 4; ++i)
+    {
+        fail_unless(func(keys[i], strlen(keys[i]), 42) == expected[i],
+            "hash function output changed");
+    }
+}
+
 START_TEST (test_murmurhash3_x64)
 {
+    const uint32_t expected[4] = {0xa07c2dd8, 0x3e8a2a65, 0x19a8a36b, 0xa64f5dd6};
+
     test_sanity(octo_hash_murmur3_x64);
+    test_stable(octo_hash_murmur3_x64, expected);
     test_speed(octo_hash_murmur3_x64, "murmur3_x64");
 }
 END_TEST
 
 START_TEST (test_murmurhash3)
 {
+    const uint32_t expected[4] = {0x9612eff2, 0x52ba0ca4, 0x77f194a4, 0x8e6ec578};
+
     test_sanity(octo_hash_murmur3);
+    test_stable(octo_hash_murmur3, expected);
     test_speed(octo_hash_murmur3, "murmur3");
 }
 END_TEST
 
+START_TEST (test_wyhash)
+{
+    const uint32_t expected[4] = {0x27c0ce49, 0xbe449672, 0xebc262ee, 0x06dd4258};
+
+    test_sanity(octo_hash_wyhash);
+    test_stable(octo_hash_wyhash, expected);
+    test_speed(octo_hash_wyhash, "wyhash");
+}
+END_TEST
+
+START_TEST (test_crc32c)
+{
+    const uint32_t expected[4] = {0x087fcd5c, 0xd1ecaf46, 0xd5104136, 0xdf1e6886};
+
+    test_sanity(octo_hash_crc32c);
+    test_stable(octo_hash_crc32c, expected);
+    test_speed(octo_hash_crc32c, "crc32c");
+}
+END_TEST
+
+/**
+ * siphash-1-3 and halfsiphash-1-3 of the messages 00..n-1 under the key
+ * 00..0f, the low 32 bits for siphash. the siphash values agree with
+ * openssl's SIPHASH mac with 1 compression and 3 finalization rounds.
+ */
+static const uint32_t test_siphash13_vectors[16] =
+{
+    0x050fc4dc, 0x7d57ca93, 0x4dc7d44d, 0xe7ddf7fb,
+    0x88d38328, 0x49533b67, 0xc59f22a7, 0x9bb11140,
+    0x8d299a8e, 0x6c063de4, 0x92ff097f, 0xf94dc352,
+    0x57b4d9a2, 0x1229ffa7, 0xc0f95d34, 0x2a519956
+};
+
+static const uint32_t test_halfsiphash13_vectors[16] =
+{
+    0x5814c896, 0xe7e864ca, 0xbc4b0e30, 0x01539939,
+    0x7e059ea6, 0x88e3d89b, 0xa0080b65, 0x9d38d9d6,
+    0x577999b1, 0xc839caed, 0xe4fa32cf, 0x959246ee,
+    0x6b28096c, 0x66dd9cd6, 0x16658a7c, 0xd0257b04
+};
+
+START_TEST (test_siphash)
+{
+    const char header[] = "Content-Length";
+    uint8_t process_key[16];
+    uint8_t key[16];
+    uint8_t msg[16];
+
+    test_sanity(octo_hash_siphash13);
+    test_sanity(octo_hash_halfsiphash13);
+
+    /* the process key is shared by every test, put it back after */
+    octo_hash_siphash_get_key(process_key);
+
+    for(int i = 0; i < 16; ++i)
+    {
+        key[i] = i;
+        msg[i] = i;
+    }
+    octo_hash_siphash_set_key(key);
+    octo_hash_siphash_get_key(key);
+    for(int i = 0; i < 16; ++i)
+    {
+        fail_unless(key[i] == i, "process key should read back as set");
+    }
+    for(size_t len = 0; len < 16; ++len)
+    {
+        fail_unless(octo_hash_siphash13(msg, len, 0) == test_siphash13_vectors[len],
+            "siphash-1-3 doesn't match the reference");
+        fail_unless(octo_hash_halfsiphash13(msg, len, 0) == test_halfsiphash13_vectors[len],
+            "halfsiphash-1-3 doesn't match the reference");
+    }
+
+    /* hashes follow the process key */
+    memset(key, 1, sizeof(key));
+    octo_hash_siphash_set_key(key);
+    uint32_t hash1 = octo_hash_siphash13(header, strlen(header), 0);
+    uint32_t half1 = octo_hash_halfsiphash13(header, strlen(header), 0);
+
+    memset(key, 2, sizeof(key));
+    octo_hash_siphash_set_key(key);
+    fail_unless(octo_hash_siphash13(header, strlen(header), 0) != hash1,
+        "siphash should depend on the process key");
+    fail_unless(octo_hash_halfsiphash13(header, strlen(header), 0) != half1,
+        "halfsiphash should depend on the process key");
+
+    memset(key, 1, sizeof(key));
+    octo_hash_siphash_set_key(key);
+    fail_unless(octo_hash_siphash13(header, strlen(header), 0) == hash1,
+        "siphash should be stable for a process key");
+
+    octo_hash_siphash_set_key(process_key);
+
+    fail_unless(octo_hash_random_seed() != octo_hash_random_seed(),
+        "random seeds should differ");
+
+    test_speed(octo_hash_siphash13, "siphash13");
+    test_speed(octo_hash_halfsiphash13, "halfsiphash13");
+}
+END_TEST
+
+START_TEST (test_short)
+{
+    const char *keys[3] = {"", "Host", "Content-Length"};
+    const uint32_t expected[3] = {0x0abcbe75, 0xabc9ca62, 0xbdc845bf};
+    const char key[] = "Content-Security";
+    uint32_t hashes[OCTO_HASH_SHORT_MAX + 1];
+    const uint32_t zero_hi = 0xe7037ed1, zero_lo = 0xa0b428db ^ 16;
+    uint8_t zeroing[16] = {0};
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for(int i = 0; i < 3; ++i)
+    {
+        fail_unless(octo_hash_short(keys[i], strlen(keys[i]), 42) == expected[i],
+            "hash function output changed");
+    }
+#endif
+
+    /* the default function hashes short keys with it, every prefix of
+     * a key hashes differently */
+    for(size_t len = 0; len <= OCTO_HASH_SHORT_MAX; ++len)
+    {
+        hashes[len] = octo_hash_short(key, len, 7);
+        fail_unless(octo_default_hash_function(key, len, 7) == hashes[len],
+            "default hash of a short key should be octo_hash_short");
+        fail_unless(octo_hash_short(key, len, 8) != hashes[len],
+            "short hash should depend on the seed");
+        for(size_t j = 0; j < len; ++j)
+        {
+            fail_unless(hashes[j] != hashes[len], "prefixes should hash differently");
+        }
+    }
+
+    /* the loads of bytes 12..15 and 4..7 of a 16 byte key cancel the
+     * constant of the second multiply operand, which must not zero the
+     * hash under every seed */
+    memcpy(&zeroing[12], &zero_hi, 4);
+    memcpy(&zeroing[4], &zero_lo, 4);
+    fail_unless(octo_hash_short(zeroing, 16, 7) != octo_hash_short(zeroing, 16, 12352),
+        "short hash should depend on the seed for every key");
+    fail_unless(octo_hash_short(zeroing, 16, 12352) != octo_hash_short(zeroing, 16, 24697),
+        "short hash should depend on the seed for every key");
+}
+END_TEST
+
+START_TEST (test_default_hash_function)
+{
+    static const char key[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+    /* longer keys are seeded wyhash on every machine, never a crc whose
+     * collisions don't depend on the seed */
+    for(size_t len = OCTO_HASH_SHORT_MAX + 1; len < sizeof(key); ++len)
+    {
+        fail_unless(octo_default_hash_function(key, len, 7) == octo_hash_wyhash(key, len, 7),
+            "default hash of a longer key should be wyhash");
+    }
+
+    test_sanity(octo_default_hash_function);
+    test_speed(octo_default_hash_function, "default");
+}
+END_TEST
+
 TCase* octo_hash_function_tcase()
 {
     TCase* tc_octo_hash_function = tcase_create("octo_hash_function");
     tcase_add_test(tc_octo_hash_function, test_murmurhash3_x64);
     tcase_add_test(tc_octo_hash_function, test_murmurhash3);
+    tcase_add_test(tc_octo_hash_function, test_wyhash);
+    tcase_add_test(tc_octo_hash_function, test_crc32c);
+    tcase_add_test(tc_octo_hash_function, test_siphash);
+    tcase_add_test(tc_octo_hash_function, test_short);
+    tcase_add_test(tc_octo_hash_function, test_default_hash_function);
     return tc_octo_hash_function;
 }
 
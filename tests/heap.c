@@ -0,0 +1,159 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <octonaut/common.h>
+#include <octonaut/heap.h>
+#include <check.h>
+#include <stdlib.h>
+
+typedef struct test_heap_struct
+{
+    double deadline;
+    octo_heap_entry entry;
+} test_heap_struct;
+
+/**
+ * check every node's key is no less than its parent's and every entry
+ * knows where it is
+ */
+static void test_heap_check(octo_heap *heap)
+{
+    for(size_t i = 3; i < heap->size + 3; ++i)
+    {
+        fail_unless(heap->nodes[i].entry->index == i, "entry index is wrong");
+        if(i > 3)
+        {
+            fail_unless(heap->nodes[(i - 4)/4 + 3].key <= heap->nodes[i].key,
+                "a node's key is less than its parent's");
+        }
+    }
+}
+
+static uint64_t test_heap_rand(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+START_TEST (test_octo_heap_push_pop)
+{
+    octo_heap heap;
+    test_heap_struct *s = calloc(1000, sizeof(test_heap_struct));
+    uint64_t state = 88172645463325252ULL;
+
+    fail_unless(octo_heap_init(&heap, 1), "init should succeed");
+    fail_unless(octo_heap_empty(&heap), "new heap should be empty");
+    fail_unless(octo_heap_pop(&heap) == NULL, "empty heap should pop nothing");
+
+    /* the heap grows from its initial capacity as entries are pushed */
+    for(int i = 0; i < 1000; ++i)
+    {
+        s[i].deadline = test_heap_rand(&state) % 500;
+        octo_heap_entry_init(&s[i].entry);
+        fail_unless(octo_heap_push(&heap, &s[i].entry, s[i].deadline), "push should succeed");
+        fail_unless(octo_heap_entry_active(&s[i].entry), "pushed entry should be active");
+    }
+    test_heap_check(&heap);
+    fail_unless(octo_heap_size(&heap) == 1000, "heap size is incorrect");
+    fail_unless(((uintptr_t)&heap.nodes[4] & 63) == 0,
+        "children should start on a cache line");
+
+    double last = -1.0;
+    for(int i = 0; i < 1000; ++i)
+    {
+        double key = octo_heap_top_key(&heap);
+        octo_heap_entry *entry = octo_heap_pop(&heap);
+        fail_unless(key >= last, "entries should pop in key order");
+        fail_unless((ptr_offset(entry, test_heap_struct, entry))->deadline == key,
+            "popped entry should have the least key");
+        fail_unless(!octo_heap_entry_active(entry), "popped entry should be inactive");
+        last = key;
+    }
+    fail_unless(octo_heap_empty(&heap), "heap should be empty");
+
+    octo_heap_destroy(&heap);
+    free(s);
+}
+END_TEST
+
+START_TEST (test_octo_heap_remove_update)
+{
+    octo_heap heap;
+    test_heap_struct *s = calloc(1000, sizeof(test_heap_struct));
+    uint64_t state = 88172645463325252ULL;
+
+    octo_heap_init(&heap, 16);
+    for(int i = 0; i < 1000; ++i)
+    {
+        s[i].deadline = test_heap_rand(&state) % 10000;
+        octo_heap_entry_init(&s[i].entry);
+        octo_heap_push(&heap, &s[i].entry, s[i].deadline);
+    }
+
+    /* cancel a third and move the rest of every other to new keys,
+     * sooner and later */
+    for(int i = 0; i < 1000; ++i)
+    {
+        if(i % 3 == 0)
+        {
+            octo_heap_remove(&heap, &s[i].entry);
+            fail_unless(!octo_heap_entry_active(&s[i].entry), "removed entry should be inactive");
+        }
+        else if(i % 2 == 0)
+        {
+            s[i].deadline = test_heap_rand(&state) % 10000;
+            octo_heap_update(&heap, &s[i].entry, s[i].deadline);
+            fail_unless(octo_heap_key(&heap, &s[i].entry) == s[i].deadline,
+                "updated entry should have its new key");
+        }
+        if(i % 100 == 0)
+        {
+            test_heap_check(&heap);
+        }
+    }
+    test_heap_check(&heap);
+    fail_unless(octo_heap_size(&heap) == 666, "heap size is incorrect");
+
+    double last = -1.0;
+    octo_heap_entry *entry;
+    while((entry = octo_heap_pop(&heap)) != NULL)
+    {
+        test_heap_struct *ts = ptr_offset(entry, test_heap_struct, entry);
+        fail_unless(ts->deadline >= last, "entries should pop in key order");
+        fail_unless((ts - s) % 3 != 0, "removed entries should not pop");
+        last = ts->deadline;
+    }
+
+    octo_heap_destroy(&heap);
+    free(s);
+}
+END_TEST
+
+TCase* octo_heap_tcase()
+{
+    TCase* tc_octo_heap = tcase_create("octo_heap");
+    tcase_add_test(tc_octo_heap, test_octo_heap_push_pop);
+    tcase_add_test(tc_octo_heap, test_octo_heap_remove_update);
+    return tc_octo_heap;
+}
@@ -23,6 +23,7 @@
 #include <octonaut/http_message.h>
 #include <octonaut/http_header.h>
 #include <check.h>
+#include <string.h>
 
 typedef struct test_header
 {
@@ -66,21 +67,86 @@ START_TEST (test_octo_http_message_add_headers)
         octo_http_message_add_header(message, headers[i]);
     }
 
+    fail_unless(octo_hash_size(&message->headers) == 10,
+        "every header should be added");
+
     for(int i = 0; i < 10; ++i)
     {
-        octo_http_header_delete(headers[i]);
+        octo_hash_entry *entry = octo_hash_get(&message->headers,
+            test_headers[i].field, strlen(test_headers[i].field));
+        fail_unless(entry == &headers[i]->header_hash,
+            "header should be found by its field");
     }
 
+    /* the message deletes the headers it holds */
+    octo_http_message_delete(message);
+}
+END_TEST
+
+START_TEST (test_octo_http_message_header_key)
+{
+    octo_http_message *message = octo_http_message_new();
+    octo_http_header *header = octo_http_header_new();
+    char field[300];
+
+    /* a field written in pieces that spans chunks */
+    memset(field, 'x', sizeof(field));
+    memcpy(field, "X-Long-", 7);
+    octo_buffer_write(&header->field, field, 200);
+    octo_buffer_write(&header->field, &field[200], 100);
+    fail_unless(octo_buffer_chunks(&header->field) > 1,
+        "field should span chunks");
+
+    fail_unless(octo_http_message_add_header(message, header),
+        "header should be added");
+    fail_unless(octo_hash_get(&message->headers, field, sizeof(field)) == &header->header_hash,
+        "header should be found by its whole field");
+
+    /* the key stays valid however the field buffer is used after */
+    octo_buffer_drain(&header->field, sizeof(field));
+    octo_buffer_trim(&header->field);
+    fail_unless(octo_hash_get(&message->headers, field, sizeof(field)) == &header->header_hash,
+        "header should be found after its field buffer changed");
+
     octo_http_message_delete(message);
 }
 END_TEST
 
+START_TEST (test_octo_http_message_repeated_header)
+{
+    octo_http_message *message = octo_http_message_new();
+    octo_http_header *headers[3];
+    const char *values[3] = {"a=1", "b=2", "c=3"};
+
+    for(int i = 0; i < 3; ++i)
+    {
+        headers[i] = octo_http_header_new();
+        octo_buffer_write(&headers[i]->field, "Cookie", 6);
+        octo_buffer_write(&headers[i]->value, (void *)values[i], 3);
+        fail_unless(octo_http_message_add_header(message, headers[i]),
+            "repeated header should be added");
+    }
+
+    fail_unless(octo_hash_size(&message->headers) == 1,
+        "a repeated field should be in the table once");
+    fail_unless(octo_hash_get(&message->headers, "Cookie", 6) == &headers[0]->header_hash,
+        "the first header with a field should be in the table");
+    fail_unless(octo_list_head(&headers[0]->header_list) == &headers[1]->header_list
+        && octo_list_tail(&headers[0]->header_list) == &headers[2]->header_list,
+        "repeated headers should follow the first in order");
+
+    /* the message deletes the repeated headers too */
+    octo_http_message_delete(message);
+}
+END_TEST
 
 TCase* octo_http_message_tcase()
 {
     TCase* tc_octo_http_message = tcase_create("octo_http_message");
     tcase_add_test(tc_octo_http_message, test_octo_http_message_new_delete);
     tcase_add_test(tc_octo_http_message, test_octo_http_message_add_headers);
+    tcase_add_test(tc_octo_http_message, test_octo_http_message_header_key);
+    tcase_add_test(tc_octo_http_message, test_octo_http_message_repeated_header);
     return tc_octo_http_message;
 }
 
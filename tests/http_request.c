@@ -20,8 +20,10 @@
  * THE SOFTWARE.
  */
 
+#include <octonaut/common.h>
 #include <octonaut/http_request.h>
 #include <check.h>
+#include <string.h>
 
 START_TEST (test_octo_http_request_init)
 {
@@ -68,12 +70,51 @@ START_TEST (test_octo_http_request_complete_message)
 }
 END_TEST
 
+START_TEST (test_octo_http_request_body)
+{
+    const char request_str[] = "POST /upload HTTP/1.1\r\n"
+                               "Host: 0.0.0.0:5000\r\n"
+                               "Content-Length: 10000\r\n"
+                               "\r\n";
+    char body[1000];
+    octo_http_request request;
+    octo_buffer_stats stats;
+    octo_http_message *message;
+
+    memset(body, 'b', sizeof(body));
+    octo_http_request_init(&request);
+
+    octo_http_request_parse(&request, request_str, strlen(request_str));
+    fail_unless(!octo_list_empty(&request.message_queue),
+        "a message should be queued once parsing begins");
+
+    /* the body arrives in pieces as it would off a socket */
+    for(int i = 0; i < 10; ++i)
+    {
+        octo_http_request_parse(&request, body, sizeof(body));
+    }
+
+    message = ptr_offset(octo_list_head(&request.message_queue),
+        octo_http_message, message_queue);
+    octo_buffer_get_stats(&message->body, &stats);
+    fail_unless(octo_buffer_size(&message->body) == 10000,
+        "the whole body should be in the message");
+    fail_unless(stats.chunks == 1,
+        "a body sized by Content-Length should land in one chunk");
+    fail_unless(request.message == NULL,
+        "no message should be in progress once the body is complete");
+
+    octo_http_request_destroy(&request);
+}
+END_TEST
+
 TCase* octo_http_request_tcase()
 {
     TCase* tc_octo_http_request = tcase_create("octo_http_request");
     tcase_add_test(tc_octo_http_request, test_octo_http_request_init);
     tcase_add_test(tc_octo_http_request, test_octo_http_request_partial_message);
     tcase_add_test(tc_octo_http_request, test_octo_http_request_complete_message);
+    tcase_add_test(tc_octo_http_request, test_octo_http_request_body);
     return tc_octo_http_request;
 }
 
@@ -0,0 +1,339 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <octonaut/common.h>
+#include <octonaut/lflist.h>
+#include <check.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define TEST_THREADS 4
+#define TEST_ROUNDS 100000
+
+typedef struct test_lflist_struct
+{
+    uint32_t thread;
+    uint32_t value;
+    octo_lfstack_node stack;
+    octo_mpsc_node queue;
+} test_lflist_struct;
+
+START_TEST (test_octo_lfstack_push_pop)
+{
+    octo_lfstack stack;
+    test_lflist_struct s[10];
+
+    octo_lfstack_init(&stack);
+    fail_unless(octo_lfstack_empty(&stack), "new stack should be empty");
+    fail_unless(octo_lfstack_pop(&stack) == NULL, "empty stack should pop nothing");
+
+    for(uint32_t i = 0; i < 10; ++i)
+    {
+        s[i].value = i;
+        octo_lfstack_push(&stack, &s[i].stack);
+    }
+
+    for(uint32_t i = 10; i-- > 5;)
+    {
+        octo_lfstack_node *node = octo_lfstack_pop(&stack);
+        fail_unless((ptr_offset(node, test_lflist_struct, stack))->value == i,
+            "stack should pop in reverse order of pushes");
+    }
+
+    octo_lfstack_node *node = octo_lfstack_pop_all(&stack);
+    for(uint32_t i = 5; i-- > 0;)
+    {
+        fail_unless((ptr_offset(node, test_lflist_struct, stack))->value == i,
+            "pop all should link nodes most recent first");
+        node = node->next;
+    }
+    fail_unless(node == NULL, "pop all chain should end with NULL");
+    fail_unless(octo_lfstack_empty(&stack), "stack should be empty after pop all");
+}
+END_TEST
+
+static void * test_lfstack_worker(void *arg)
+{
+    octo_lfstack *stack = arg;
+
+    /* popped nodes are pushed right back, so other threads keep finding
+     * the same nodes at the top, which is where ABA would strike */
+    for(int i = 0; i < TEST_ROUNDS; ++i)
+    {
+        octo_lfstack_node *node = octo_lfstack_pop(stack);
+        if(node != NULL)
+        {
+            (ptr_offset(node, test_lflist_struct, stack))->value += 1;
+            octo_lfstack_push(stack, node);
+        }
+    }
+    return NULL;
+}
+
+START_TEST (test_octo_lfstack_threads)
+{
+    octo_lfstack stack;
+    test_lflist_struct s[8];
+    pthread_t threads[TEST_THREADS];
+    bool seen[8] = {false};
+    uint32_t pops = 0;
+    int count = 0;
+
+    octo_lfstack_init(&stack);
+    for(int i = 0; i < 8; ++i)
+    {
+        s[i].value = 0;
+        octo_lfstack_push(&stack, &s[i].stack);
+    }
+
+    for(int t = 0; t < TEST_THREADS; ++t)
+    {
+        pthread_create(&threads[t], NULL, test_lfstack_worker, &stack);
+    }
+    for(int t = 0; t < TEST_THREADS; ++t)
+    {
+        pthread_join(threads[t], NULL);
+    }
+
+    for(octo_lfstack_node *node = octo_lfstack_pop_all(&stack); node; node = node->next)
+    {
+        test_lflist_struct *ts = ptr_offset(node, test_lflist_struct, stack);
+        fail_unless(!seen[ts - s], "no node should be on the stack twice");
+        seen[ts - s] = true;
+        pops += ts->value;
+        count += 1;
+    }
+    fail_unless(count == 8, "every node should be back on the stack");
+    fail_unless(pops == TEST_THREADS*TEST_ROUNDS,
+        "every pop should have found a node");
+}
+END_TEST
+
+START_TEST (test_octo_mpsc_push_pop)
+{
+    octo_mpsc queue;
+    test_lflist_struct s[10];
+
+    octo_mpsc_init(&queue);
+    fail_unless(octo_mpsc_empty(&queue), "new queue should be empty");
+    fail_unless(octo_mpsc_pop(&queue) == NULL, "empty queue should pop nothing");
+
+    /* the queue is emptied and filled again to pass over the stub */
+    for(int round = 0; round < 3; ++round)
+    {
+        for(uint32_t i = 0; i < 10; ++i)
+        {
+            s[i].value = i;
+            octo_mpsc_push(&queue, &s[i].queue);
+        }
+        fail_unless(!octo_mpsc_empty(&queue), "queue should not be empty");
+
+        for(uint32_t i = 0; i < 10; ++i)
+        {
+            octo_mpsc_node *node = octo_mpsc_pop(&queue);
+            fail_unless(node != NULL && (ptr_offset(node, test_lflist_struct, queue))->value == i,
+                "queue should pop in order of pushes");
+        }
+        fail_unless(octo_mpsc_pop(&queue) == NULL, "drained queue should pop nothing");
+        fail_unless(octo_mpsc_empty(&queue), "drained queue should be empty");
+    }
+}
+END_TEST
+
+typedef struct test_mpsc_thread
+{
+    pthread_t thread;
+    octo_mpsc *queue;
+    test_lflist_struct *nodes;
+} test_mpsc_thread;
+
+static void * test_mpsc_producer(void *arg)
+{
+    test_mpsc_thread *t = arg;
+
+    for(int i = 0; i < TEST_ROUNDS; ++i)
+    {
+        octo_mpsc_push(t->queue, &t->nodes[i].queue);
+    }
+    return NULL;
+}
+
+START_TEST (test_octo_mpsc_threads)
+{
+    octo_mpsc queue;
+    test_mpsc_thread threads[TEST_THREADS];
+    uint32_t next[TEST_THREADS] = {0};
+    size_t count = 0;
+
+    octo_mpsc_init(&queue);
+
+    for(uint32_t t = 0; t < TEST_THREADS; ++t)
+    {
+        threads[t].queue = &queue;
+        threads[t].nodes = calloc(TEST_ROUNDS, sizeof(test_lflist_struct));
+        for(uint32_t i = 0; i < TEST_ROUNDS; ++i)
+        {
+            threads[t].nodes[i].thread = t;
+            threads[t].nodes[i].value = i;
+        }
+        pthread_create(&threads[t].thread, NULL, test_mpsc_producer, &threads[t]);
+    }
+
+    while(count < TEST_THREADS*TEST_ROUNDS)
+    {
+        octo_mpsc_node *node = octo_mpsc_pop(&queue);
+        if(node != NULL)
+        {
+            test_lflist_struct *ts = ptr_offset(node, test_lflist_struct, queue);
+            fail_unless(ts->value == next[ts->thread],
+                "each producer's nodes should pop in the order pushed");
+            next[ts->thread] += 1;
+            count += 1;
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+
+    for(int t = 0; t < TEST_THREADS; ++t)
+    {
+        pthread_join(threads[t].thread, NULL);
+        free(threads[t].nodes);
+    }
+    fail_unless(octo_mpsc_pop(&queue) == NULL, "drained queue should pop nothing");
+}
+END_TEST
+
+START_TEST (test_octo_spsc_push_pop)
+{
+    octo_spsc ring;
+    uint64_t value;
+
+    fail_unless(octo_spsc_init(&ring, 5, sizeof(uint64_t)), "init should succeed");
+    fail_unless(octo_spsc_capacity(&ring) == 8, "capacity should round up to a power of 2");
+    fail_unless(!octo_spsc_pop(&ring, &value), "empty ring should pop nothing");
+
+    /* wrap around the ring a few times */
+    for(uint64_t round = 0; round < 3; ++round)
+    {
+        for(uint64_t i = 0; i < 8; ++i)
+        {
+            value = round*8 + i;
+            fail_unless(octo_spsc_push(&ring, &value), "push should fit");
+        }
+        fail_unless(!octo_spsc_push(&ring, &value), "full ring should refuse a push");
+        fail_unless(octo_spsc_size(&ring) == 8, "ring should be full");
+
+        for(uint64_t i = 0; i < 8; ++i)
+        {
+            fail_unless(octo_spsc_pop(&ring, &value) && value == round*8 + i,
+                "ring should pop in order of pushes");
+        }
+        fail_unless(octo_spsc_peek(&ring) == NULL, "drained ring should have nothing");
+    }
+
+    /* records are filled in and read in place */
+    uint64_t *slot = octo_spsc_reserve(&ring);
+    *slot = 1234;
+    fail_unless(octo_spsc_peek(&ring) == NULL, "uncommitted record should not be seen");
+    octo_spsc_commit(&ring);
+    fail_unless(*(uint64_t *)octo_spsc_peek(&ring) == 1234, "committed record should be seen");
+    octo_spsc_release(&ring);
+    fail_unless(octo_spsc_size(&ring) == 0, "released record should be gone");
+
+    /* a batch is read in place across the wrap and released at once */
+    for(value = 0; value < 6; ++value)
+    {
+        octo_spsc_push(&ring, &value);
+    }
+    for(uint64_t i = 0; i < 6; ++i)
+    {
+        fail_unless(*(uint64_t *)octo_spsc_peek_at(&ring, i) == i,
+            "batch should be read in order of pushes");
+    }
+    fail_unless(octo_spsc_peek_at(&ring, 6) == NULL, "peek past the last record should fail");
+    octo_spsc_release_n(&ring, 4);
+    fail_unless(octo_spsc_pop(&ring, &value) && value == 4, "release should drop the batch");
+
+    octo_spsc_destroy(&ring);
+}
+END_TEST
+
+static void * test_spsc_producer(void *arg)
+{
+    octo_spsc *ring = arg;
+
+    for(uint64_t i = 0; i < TEST_ROUNDS*TEST_THREADS;)
+    {
+        if(octo_spsc_push(ring, &i))
+        {
+            ++i;
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+START_TEST (test_octo_spsc_threads)
+{
+    octo_spsc ring;
+    pthread_t producer;
+    uint64_t value;
+
+    octo_spsc_init(&ring, 64, sizeof(uint64_t));
+    pthread_create(&producer, NULL, test_spsc_producer, &ring);
+
+    for(uint64_t i = 0; i < TEST_ROUNDS*TEST_THREADS;)
+    {
+        if(octo_spsc_pop(&ring, &value))
+        {
+            fail_unless(value == i, "ring should pop in order of pushes");
+            ++i;
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+
+    pthread_join(producer, NULL);
+    fail_unless(!octo_spsc_pop(&ring, &value), "drained ring should pop nothing");
+    octo_spsc_destroy(&ring);
+}
+END_TEST
+
+TCase* octo_lflist_tcase()
+{
+    TCase* tc_octo_lflist = tcase_create("octo_lflist");
+    tcase_add_test(tc_octo_lflist, test_octo_lfstack_push_pop);
+    tcase_add_test(tc_octo_lflist, test_octo_lfstack_threads);
+    tcase_add_test(tc_octo_lflist, test_octo_mpsc_push_pop);
+    tcase_add_test(tc_octo_lflist, test_octo_mpsc_threads);
+    tcase_add_test(tc_octo_lflist, test_octo_spsc_push_pop);
+    tcase_add_test(tc_octo_lflist, test_octo_spsc_threads);
+    return tc_octo_lflist;
+}
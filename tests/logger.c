@@ -20,8 +20,109 @@
  * THE SOFTWARE.
  */
 
+#include <octonaut/common.h>
 #include <octonaut/logger.h>
 #include <check.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+#define TEST_LINES 2000
+#define TEST_THREADS 4
+
+typedef struct test_log_pipe
+{
+    int fds[2];
+    pthread_t reader;
+    int last[TEST_THREADS];
+    size_t lines;
+    size_t out_of_order;
+} test_log_pipe;
+
+/**
+ * read lines logged as "line <thread> <number>" from a pipe, counting
+ * them and any that come before an earlier line of the same thread
+ */
+static void * test_log_pipe_read(void *arg)
+{
+    test_log_pipe *pipe = arg;
+    char line[OCTO_LOG_RECORD_SIZE];
+    size_t len = 0;
+    char c;
+
+    while(read(pipe->fds[0], &c, 1) == 1)
+    {
+        int thread, number;
+        const char *msg;
+
+        if(c != '\n')
+        {
+            line[len++ % sizeof(line)] = c;
+            continue;
+        }
+
+        line[min(len, sizeof(line) - 1)] = '\0';
+        len = 0;
+        pipe->lines += 1;
+
+        msg = strstr(line, ":: line ");
+        if(msg == NULL || sscanf(msg, ":: line %d %d", &thread, &number) != 2
+            || thread < 0 || thread >= TEST_THREADS || number <= pipe->last[thread])
+        {
+            pipe->out_of_order += 1;
+            continue;
+        }
+        pipe->last[thread] = number;
+    }
+    return NULL;
+}
+
+static void test_log_pipe_open(test_log_pipe *pipe_, octo_logger *logger)
+{
+    fail_unless(pipe(pipe_->fds) == 0, "pipe should open");
+    for(int i = 0; i < TEST_THREADS; ++i)
+    {
+        pipe_->last[i] = -1;
+    }
+    pipe_->lines = 0;
+    pipe_->out_of_order = 0;
+    octo_logger_add_output(logger, LOG_INFO, fdopen(pipe_->fds[1], "w"), false);
+}
+
+static void test_log_pipe_start(test_log_pipe *pipe_)
+{
+    pthread_create(&pipe_->reader, NULL, test_log_pipe_read, pipe_);
+}
+
+/**
+ * close the write end of the pipe, through the logger's output, and wait
+ * for the reader to see everything
+ */
+static void test_log_pipe_close(test_log_pipe *pipe_, octo_logger *logger)
+{
+    octo_logger_destroy(logger);
+    pthread_join(pipe_->reader, NULL);
+    close(pipe_->fds[0]);
+}
+
+typedef struct test_log_thread
+{
+    octo_logger *logger;
+    int id;
+} test_log_thread;
+
+static void * test_log_lines(void *arg)
+{
+    test_log_thread *thread = arg;
+
+    for(int i = 0; i < TEST_LINES; ++i)
+    {
+        octo_plogger_info(thread->logger, "line %d %d", thread->id, i);
+    }
+    return NULL;
+}
 
 START_TEST (test_octo_logger)
 {
@@ -39,9 +140,162 @@ START_TEST (test_octo_logger)
 }
 END_TEST
 
+START_TEST (test_octo_logger_precision)
+{
+    octo_logger logger;
+    FILE *stream = tmpfile();
+    char line[OCTO_LOG_RECORD_SIZE];
+    char date[64];
+    size_t time_len;
+    struct tm ts;
+    time_t now = time(NULL);
+    const char *when;
+
+    octo_logger_init(&logger, "octonaut");
+    octo_logger_add_output(&logger, LOG_INFO, stream, false);
+    fail_unless(octo_logger_precision(&logger) == 0, "times should be to the second by default");
+
+    octo_plogger_info(&logger, "seconds");
+    octo_logger_set_precision(&logger, 3);
+    octo_plogger_info(&logger, "milliseconds");
+    octo_logger_set_precision(&logger, 12);
+    fail_unless(octo_logger_precision(&logger) == 9, "precision should stop at nanoseconds");
+    octo_plogger_info(&logger, "nanoseconds");
+
+    /* the cached date should match a freshly formatted one, unless
+     * midnight has just passed */
+    localtime_r(&now, &ts);
+    time_len = strftime(date, sizeof(date), "%a %Y-%m-%d %H:%M:%S", &ts);
+    strftime(date, sizeof(date), "%a %Y-%m-%d", &ts);
+
+    rewind(stream);
+    for(int digits = 0; digits <= 9; digits += (digits == 0 ? 3 : 6))
+    {
+        fail_unless(fgets(line, sizeof(line), stream) != NULL, "line should be logged");
+        when = strstr(line, " :: ");
+        fail_unless(when != NULL, "line should have a time");
+        when += 4;
+        fail_unless(strncmp(when, date, strlen(date)) == 0 || ts.tm_hour == 23,
+            "date should be formatted as before");
+        when += time_len;
+        if(digits > 0)
+        {
+            fail_unless(when[0] == '.', "fraction should follow the seconds");
+            for(int i = 1; i <= digits; ++i)
+            {
+                fail_unless(when[i] >= '0' && when[i] <= '9', "fraction should be digits");
+            }
+            when += digits + 1;
+        }
+        fail_unless(when[0] == ' ', "time zone should follow the time");
+    }
+
+    octo_logger_destroy(&logger);
+}
+END_TEST
+
+START_TEST (test_octo_logger_async_drop)
+{
+    octo_logger logger;
+    octo_log_writer writer;
+    test_log_pipe pipe;
+    test_log_thread thread = { &logger, 0 };
+
+    octo_logger_init(&logger, "octonaut");
+    test_log_pipe_open(&pipe, &logger);
+    fail_unless(octo_log_writer_init(&writer, 16, LOG_DROP), "writer should start");
+    octo_logger_set_writer(&logger, &writer);
+
+    /* nothing reads the pipe yet, once it and the ring are full lines
+     * have to be dropped */
+    test_log_lines(&thread);
+    fail_unless(octo_log_writer_dropped(&writer) > 0, "lines should have been dropped");
+
+    test_log_pipe_start(&pipe);
+    test_log_pipe_close(&pipe, &logger);
+    octo_log_writer_destroy(&writer);
+
+    fail_unless(octo_log_writer_written(&writer) + octo_log_writer_dropped(&writer) == TEST_LINES,
+        "every line should be written or dropped");
+    fail_unless(pipe.lines == octo_log_writer_written(&writer),
+        "written lines should all be read");
+    fail_unless(pipe.out_of_order == 0, "lines should be whole and in order");
+}
+END_TEST
+
+START_TEST (test_octo_logger_async_block)
+{
+    octo_logger logger;
+    octo_log_writer writer;
+    test_log_pipe pipe;
+    test_log_thread threads[TEST_THREADS];
+    pthread_t ids[TEST_THREADS];
+
+    octo_logger_init(&logger, "octonaut");
+    test_log_pipe_open(&pipe, &logger);
+    test_log_pipe_start(&pipe);
+    fail_unless(octo_log_writer_init(&writer, 16, LOG_BLOCK), "writer should start");
+    octo_logger_set_writer(&logger, &writer);
+
+    for(int i = 0; i < TEST_THREADS; ++i)
+    {
+        threads[i].logger = &logger;
+        threads[i].id = i;
+        pthread_create(&ids[i], NULL, test_log_lines, &threads[i]);
+    }
+    for(int i = 0; i < TEST_THREADS; ++i)
+    {
+        pthread_join(ids[i], NULL);
+    }
+
+    /* destroying the logger waits for its lines before closing the pipe */
+    test_log_pipe_close(&pipe, &logger);
+    fail_unless(octo_log_writer_written(&writer) == TEST_LINES*TEST_THREADS,
+        "every line should be written before the logger is destroyed");
+    octo_log_writer_destroy(&writer);
+
+    fail_unless(octo_log_writer_dropped(&writer) == 0, "blocking writer should drop nothing");
+    fail_unless(pipe.lines == TEST_LINES*TEST_THREADS, "every line should be read");
+    fail_unless(pipe.out_of_order == 0, "lines of each thread should be whole and in order");
+}
+END_TEST
+
+START_TEST (test_octo_logger_async_unset)
+{
+    octo_logger logger;
+    octo_log_writer writer;
+    test_log_pipe pipe;
+    test_log_thread thread = { &logger, 0 };
+
+    octo_logger_init(&logger, "octonaut");
+    test_log_pipe_open(&pipe, &logger);
+    test_log_pipe_start(&pipe);
+    fail_unless(octo_log_writer_init(&writer, 16, LOG_BLOCK), "writer should start");
+    octo_logger_set_writer(&logger, &writer);
+
+    test_log_lines(&thread);
+
+    /* going back to writing straight away waits for the queued lines */
+    octo_logger_set_writer(&logger, NULL);
+    fail_unless(octo_log_writer_written(&writer) == TEST_LINES,
+        "queued lines should be written before the writer is unset");
+    octo_plogger_info(&logger, "line %d %d", 0, TEST_LINES);
+
+    test_log_pipe_close(&pipe, &logger);
+    octo_log_writer_destroy(&writer);
+
+    fail_unless(pipe.lines == TEST_LINES + 1, "every line should be read");
+    fail_unless(pipe.out_of_order == 0, "lines should stay in order across the switch");
+}
+END_TEST
+
 TCase* octo_logger_tcase()
 {
     TCase* tc_octo_logger= tcase_create("octo_logger");
     tcase_add_test(tc_octo_logger, test_octo_logger);
+    tcase_add_test(tc_octo_logger, test_octo_logger_precision);
+    tcase_add_test(tc_octo_logger, test_octo_logger_async_drop);
+    tcase_add_test(tc_octo_logger, test_octo_logger_async_block);
+    tcase_add_test(tc_octo_logger, test_octo_logger_async_unset);
     return tc_octo_logger;
 }
@@ -2,9 +2,19 @@
 
 #include "aio.h"
 #include "list.h"
+#include "array.h"
+#include "lflist.h"
 #include "buffer.h"
+#include "ringbuf.h"
+#include "sweeper.h"
+#include "scheduler.h"
 #include "hash_function.h"
 #include "hash.h"
+#include "ohash.h"
+#include "chash.h"
+#include "thash.h"
+#include "rbtree.h"
+#include "heap.h"
 #include "logger.h"
 #include "server.h"
 #include "http_header.h"
@@ -17,9 +27,19 @@ Suite* octonaut_suite(void)
 {
     Suite *s = suite_create("octonaut");
     suite_add_tcase(s, octo_list_tcase());
+    suite_add_tcase(s, octo_array_tcase());
+    suite_add_tcase(s, octo_lflist_tcase());
     suite_add_tcase(s, octo_buffer_tcase());
+    suite_add_tcase(s, octo_ringbuf_tcase());
+    suite_add_tcase(s, octo_sweeper_tcase());
+    suite_add_tcase(s, octo_scheduler_tcase());
     suite_add_tcase(s, octo_hash_function_tcase());
     suite_add_tcase(s, octo_hash_tcase());
+    suite_add_tcase(s, octo_ohash_tcase());
+    suite_add_tcase(s, octo_chash_tcase());
+    suite_add_tcase(s, octo_thash_tcase());
+    suite_add_tcase(s, octo_rbtree_tcase());
+    suite_add_tcase(s, octo_heap_tcase());
     suite_add_tcase(s, octo_logger_tcase());
     suite_add_tcase(s, octo_aio_tcase());
     suite_add_tcase(s, octo_server_tcase());
@@ -0,0 +1,208 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <octonaut/hash_function.h>
+#include <octonaut/ohash.h>
+#include <check.h>
+#include <stdlib.h>
+
+typedef struct test_ohash_struct
+{
+    uint32_t value;
+    octo_hash_entry hash;
+} test_ohash_struct;
+
+START_TEST (test_octo_ohash_create)
+{
+    octo_ohash hash;
+
+    octo_ohash_init(&hash, octo_default_hash_function, 0, 0);
+
+    fail_unless(hash.n_slots == 16,
+        "hash table should have at least a group of slots");
+
+    octo_ohash_destroy(&hash);
+}
+END_TEST
+
+START_TEST (test_octo_ohash_put_get_pop)
+{
+    octo_ohash hash;
+
+    test_ohash_struct s1 =
+        {
+            .value = 1,
+        };
+    octo_hash_entry_init(&s1.hash, &s1.value, sizeof(s1.value));
+
+    test_ohash_struct s2 =
+        {
+            .value = 2,
+        };
+    octo_hash_entry_init(&s2.hash, &s2.value, sizeof(s2.value));
+
+    test_ohash_struct s3 =
+        {
+            .value = 2,
+        };
+    octo_hash_entry_init(&s3.hash, &s3.value, sizeof(s3.value));
+
+    octo_ohash_init(&hash, octo_default_hash_function, 0, 4);
+
+    fail_unless(octo_ohash_put(&hash, &s1.hash),
+        "put should succeed");
+    fail_unless(octo_ohash_put(&hash, &s2.hash),
+        "put should succeed");
+    fail_unless(!octo_ohash_put(&hash, &s3.hash),
+        "double put of the same key should result in failing to put");
+
+    uint32_t key = 1;
+    fail_unless(octo_ohash_get(&hash, &key, sizeof(key)) == &s1.hash,
+        "hash table failed to retrieve correct entry");
+
+    key = 2;
+    fail_unless(octo_ohash_has(&hash, &key, sizeof(key)),
+        "hash table failed to find correct entry");
+    fail_unless(octo_ohash_pop(&hash, &key, sizeof(key)) == &s2.hash,
+        "hash table failed to pop correct entry");
+    fail_unless(octo_ohash_get(&hash, &key, sizeof(key)) == NULL,
+        "popped entry should be gone");
+    fail_unless(octo_ohash_size(&hash) == 1,
+        "hash table size is incorrect");
+
+    fail_unless(octo_ohash_put(&hash, &s3.hash),
+        "put should succeed after the key was popped");
+    fail_unless(octo_ohash_get(&hash, &key, sizeof(key)) == &s3.hash,
+        "hash table failed to retrieve correct entry");
+
+    key = 3;
+    fail_unless(octo_ohash_get(&hash, &key, sizeof(key)) == NULL,
+        "hash table should not find a missing key");
+
+    octo_ohash_destroy(&hash);
+}
+END_TEST
+
+static uint32_t test_ohash_collide(const void *key, size_t keylen, uint32_t seed)
+{
+    return 7;
+}
+
+START_TEST (test_octo_ohash_collisions)
+{
+    octo_ohash hash;
+    test_ohash_struct s[40];
+
+    /* every key lands in the same group with the same control byte */
+    octo_ohash_init(&hash, test_ohash_collide, 0, 6);
+
+    for(uint32_t i = 0; i < 40; ++i)
+    {
+        s[i].value = i;
+        octo_hash_entry_init(&s[i].hash, &s[i].value, sizeof(s[i].value));
+        fail_unless(octo_ohash_put(&hash, &s[i].hash),
+            "put should succeed");
+    }
+
+    for(uint32_t i = 0; i < 40; i += 2)
+    {
+        fail_unless(octo_ohash_pop(&hash, &i, sizeof(i)) == &s[i].hash,
+            "hash table failed to pop correct entry");
+    }
+
+    for(uint32_t i = 0; i < 40; ++i)
+    {
+        octo_hash_entry *entry = octo_ohash_get(&hash, &i, sizeof(i));
+        fail_unless(entry == (i % 2 ? &s[i].hash : NULL),
+            "probing past deleted slots failed");
+    }
+
+    fail_unless(octo_ohash_size(&hash) == 20,
+        "hash table size is incorrect");
+
+    octo_ohash_destroy(&hash);
+}
+END_TEST
+
+START_TEST (test_octo_ohash_grow)
+{
+    octo_ohash hash;
+    size_t count = 10000;
+    test_ohash_struct *s = malloc(sizeof(test_ohash_struct)*count);
+
+    octo_ohash_init(&hash, octo_default_hash_function, 0, 0);
+
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        s[i].value = i;
+        octo_hash_entry_init(&s[i].hash, &s[i].value, sizeof(s[i].value));
+        fail_unless(octo_ohash_put(&hash, &s[i].hash),
+            "put should succeed");
+    }
+
+    fail_unless(octo_ohash_size(&hash) == count,
+        "hash table size is incorrect");
+    fail_unless(hash.n_slots >= count + count/8,
+        "hash table should have grown past its load limit");
+
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        fail_unless(octo_ohash_get(&hash, &i, sizeof(i)) == &s[i].hash,
+            "hash table failed to retrieve correct entry after growing");
+    }
+
+    for(uint32_t i = count/2; i < count; ++i)
+    {
+        octo_ohash_pop(&hash, &i, sizeof(i));
+    }
+
+    /* churning through deleted slots rehashes in place instead of growing */
+    uint32_t n_slots = hash.n_slots;
+    for(int round = 0; round < 4; ++round)
+    {
+        for(uint32_t i = 0; i < count/2; ++i)
+        {
+            fail_unless(octo_ohash_pop(&hash, &s[i].value, sizeof(uint32_t)) == &s[i].hash,
+                "hash table failed to pop correct entry");
+            s[i].value = i + count*(round + 1);
+            octo_ohash_put(&hash, &s[i].hash);
+        }
+    }
+    fail_unless(hash.n_slots == n_slots,
+        "reusing deleted slots should not grow the table");
+    fail_unless(octo_ohash_size(&hash) == count/2,
+        "hash table size is incorrect");
+
+    octo_ohash_destroy(&hash);
+    free(s);
+}
+END_TEST
+
+TCase* octo_ohash_tcase()
+{
+    TCase* tc_octo_ohash = tcase_create("octo_ohash");
+    tcase_add_test(tc_octo_ohash, test_octo_ohash_create);
+    tcase_add_test(tc_octo_ohash, test_octo_ohash_put_get_pop);
+    tcase_add_test(tc_octo_ohash, test_octo_ohash_collisions);
+    tcase_add_test(tc_octo_ohash, test_octo_ohash_grow);
+    return tc_octo_ohash;
+}
@@ -0,0 +1,289 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <octonaut/common.h>
+#include <octonaut/rbtree.h>
+#include <check.h>
+#include <stdlib.h>
+
+typedef struct test_rbtree_struct
+{
+    uint32_t value;
+    octo_rbtree_entry entry;
+} test_rbtree_struct;
+
+static bool test_rbtree_eq(octo_rbtree_entry *lh, octo_rbtree_entry *rh)
+{
+    return (ptr_offset(lh, test_rbtree_struct, entry))->value ==
+        (ptr_offset(rh, test_rbtree_struct, entry))->value;
+}
+
+static bool test_rbtree_lt(octo_rbtree_entry *lh, octo_rbtree_entry *rh)
+{
+    return (ptr_offset(lh, test_rbtree_struct, entry))->value <
+        (ptr_offset(rh, test_rbtree_struct, entry))->value;
+}
+
+/**
+ * check the red-black rules below an entry and return its black height
+ */
+static int test_rbtree_check(octo_rbtree_entry *entry, octo_rbtree_entry *parent)
+{
+    if(entry == NULL)
+    {
+        return 1;
+    }
+
+    fail_unless(entry->parent == parent, "parent link is broken");
+    fail_unless(!(entry->red && parent != NULL && parent->red),
+        "a red entry has a red parent");
+    if(entry->lchild != NULL)
+    {
+        fail_unless(!test_rbtree_lt(entry, entry->lchild), "left child is greater");
+    }
+    if(entry->rchild != NULL)
+    {
+        fail_unless(!test_rbtree_lt(entry->rchild, entry), "right child is less");
+    }
+
+    int lheight = test_rbtree_check(entry->lchild, entry);
+    int rheight = test_rbtree_check(entry->rchild, entry);
+    fail_unless(lheight == rheight, "black heights differ");
+
+    return lheight + !entry->red;
+}
+
+START_TEST (test_octo_rbtree_insert_remove)
+{
+    octo_rbtree tree;
+    test_rbtree_struct *s = calloc(1000, sizeof(test_rbtree_struct));
+    uint64_t state = 88172645463325252ULL;
+
+    octo_rbtree_init(&tree, test_rbtree_eq, test_rbtree_lt);
+    fail_unless(octo_rbtree_empty(&tree), "new tree should be empty");
+    fail_unless(octo_rbtree_first(&tree) == NULL, "empty tree has no first entry");
+
+    /* values 0 to 999 in a shuffled order */
+    for(uint32_t i = 0; i < 1000; ++i)
+    {
+        s[i].value = i;
+    }
+    for(uint32_t i = 999; i > 0; --i)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        uint32_t j = state % (i + 1);
+        uint32_t tmp = s[i].value;
+        s[i].value = s[j].value;
+        s[j].value = tmp;
+    }
+
+    for(uint32_t i = 0; i < 1000; ++i)
+    {
+        octo_rbtree_insert(&tree, &s[i].entry);
+    }
+    test_rbtree_check(tree.root, NULL);
+    fail_unless(octo_rbtree_size(&tree) == 1000, "tree size is incorrect");
+
+    uint32_t expected = 0;
+    for(octo_rbtree_entry *e = octo_rbtree_first(&tree); e; e = octo_rbtree_next(e))
+    {
+        fail_unless((ptr_offset(e, test_rbtree_struct, entry))->value == expected++,
+            "entries should come in order");
+    }
+    fail_unless(expected == 1000, "every entry should be visited");
+    for(octo_rbtree_entry *e = octo_rbtree_last(&tree); e; e = octo_rbtree_prev(e))
+    {
+        fail_unless((ptr_offset(e, test_rbtree_struct, entry))->value == --expected,
+            "entries should come in reverse order");
+    }
+
+    /* remove every other inserted entry, the rules must hold throughout */
+    for(uint32_t i = 0; i < 1000; i += 2)
+    {
+        octo_rbtree_remove(&tree, &s[i].entry);
+        if(i % 64 == 0)
+        {
+            test_rbtree_check(tree.root, NULL);
+        }
+    }
+    test_rbtree_check(tree.root, NULL);
+    fail_unless(octo_rbtree_size(&tree) == 500, "tree size is incorrect");
+
+    for(uint32_t i = 0; i < 1000; ++i)
+    {
+        octo_rbtree_entry *found = octo_rbtree_find(&tree, &s[i].entry);
+        fail_unless(found == (i % 2 ? &s[i].entry : NULL),
+            "only the entries left should be found");
+    }
+
+    for(uint32_t i = 1; i < 1000; i += 2)
+    {
+        octo_rbtree_remove(&tree, &s[i].entry);
+    }
+    fail_unless(octo_rbtree_empty(&tree), "tree should be empty");
+
+    octo_rbtree_destroy(&tree);
+    free(s);
+}
+END_TEST
+
+/**
+ * a request waiting on its deadline
+ */
+typedef struct test_request
+{
+    double deadline;
+    uint32_t id;
+    octo_rbtree_entry timeout;
+} test_request;
+
+typedef struct test_deadline_search
+{
+    double deadline;
+    octo_rbtree_s_entry s_entry;
+} test_deadline_search;
+
+static bool test_deadline_eq(octo_rbtree_entry *lh, octo_rbtree_entry *rh)
+{
+    return (ptr_offset(lh, test_request, timeout))->deadline ==
+        (ptr_offset(rh, test_request, timeout))->deadline;
+}
+
+static bool test_deadline_lt(octo_rbtree_entry *lh, octo_rbtree_entry *rh)
+{
+    return (ptr_offset(lh, test_request, timeout))->deadline <
+        (ptr_offset(rh, test_request, timeout))->deadline;
+}
+
+static bool test_deadline_s_eq(octo_rbtree_s_entry *lh, octo_rbtree_entry *rh)
+{
+    return (ptr_offset(lh, test_deadline_search, s_entry))->deadline ==
+        (ptr_offset(rh, test_request, timeout))->deadline;
+}
+
+static bool test_deadline_s_lt(octo_rbtree_s_entry *lh, octo_rbtree_entry *rh)
+{
+    return (ptr_offset(lh, test_deadline_search, s_entry))->deadline <
+        (ptr_offset(rh, test_request, timeout))->deadline;
+}
+
+START_TEST (test_octo_rbtree_deadlines)
+{
+    octo_rbtree timeouts;
+    octo_rbtree_iterator iter;
+    test_request requests[100];
+    test_deadline_search search = {0.0, {test_deadline_s_eq, test_deadline_s_lt}};
+    test_request *request;
+
+    octo_rbtree_init(&timeouts, test_deadline_eq, test_deadline_lt);
+
+    /* ten requests share each deadline from 1.0 to 10.0 */
+    for(uint32_t i = 0; i < 100; ++i)
+    {
+        requests[i].id = i;
+        requests[i].deadline = 1.0 + i % 10;
+        octo_rbtree_insert(&timeouts, &requests[i].timeout);
+    }
+
+    /* requests that finish in time are taken out of the index */
+    for(uint32_t i = 0; i < 100; i += 3)
+    {
+        octo_rbtree_remove(&timeouts, &requests[i].timeout);
+    }
+    fail_unless(octo_rbtree_size(&timeouts) == 66, "index size is incorrect");
+
+    /* the earliest deadline at or after 4.5 is 5.0 */
+    search.deadline = 4.5;
+    request = ptr_offset(octo_rbtree_lower_bound(&timeouts, &search.s_entry), test_request, timeout);
+    fail_unless(request->deadline == 5.0, "lower bound should be the next deadline");
+    search.deadline = 5.0;
+    fail_unless(octo_rbtree_search(&timeouts, &search.s_entry) != NULL,
+        "a request with the deadline should be found");
+    search.deadline = 11.0;
+    fail_unless(octo_rbtree_lower_bound(&timeouts, &search.s_entry) == NULL,
+        "no deadline is that late");
+
+    /* pushing a request's deadline back moves it behind the others */
+    octo_rbtree_remove(&timeouts, &requests[1].timeout);
+    requests[1].deadline = 9.0;
+    octo_rbtree_insert(&timeouts, &requests[1].timeout);
+
+    /* at 5.5 every request due by then times out in deadline order, and
+     * requests with the same deadline in the order they were added */
+    double now = 5.5;
+    double last_deadline = 0.0;
+    uint32_t last_id = 0;
+    size_t expired = 0;
+    octo_rbtree_entry *entry;
+
+    while((entry = octo_rbtree_first(&timeouts)) != NULL)
+    {
+        request = ptr_offset(entry, test_request, timeout);
+        if(request->deadline > now)
+        {
+            break;
+        }
+        fail_unless(request->deadline > last_deadline ||
+            (request->deadline == last_deadline && request->id > last_id),
+            "requests should time out in order");
+        fail_unless(request->id % 3 != 0, "finished requests should not time out");
+        fail_unless(request->id != 1, "postponed request should not time out");
+        last_deadline = request->deadline;
+        last_id = request->id;
+        octo_rbtree_remove(&timeouts, entry);
+        expired += 1;
+    }
+    fail_unless(expired == 32, "every request due should have timed out");
+
+    /* the postponed request is the last of those due at 9.0 */
+    search.deadline = 9.0;
+    size_t due = 0;
+    for(entry = octo_rbtree_iter_from(&timeouts, &iter, &search.s_entry); entry;
+            entry = octo_rbtree_iternext(&iter))
+    {
+        request = ptr_offset(entry, test_request, timeout);
+        if(request->deadline == 9.0)
+        {
+            due += 1;
+            fail_unless(request->id != 1 || octo_rbtree_next(entry) == NULL ||
+                (ptr_offset(octo_rbtree_next(entry), test_request, timeout))->deadline > 9.0,
+                "postponed request should come after the others due with it");
+        }
+        octo_rbtree_iterremove(&iter);
+    }
+    fail_unless(due == 8, "every request due at 9.0 should be found");
+    fail_unless(octo_rbtree_size(&timeouts) == 66 - 32 - due - 6,
+        "iteration should have removed everything from 9.0 on");
+
+    octo_rbtree_destroy(&timeouts);
+}
+END_TEST
+
+TCase* octo_rbtree_tcase()
+{
+    TCase* tc_octo_rbtree = tcase_create("octo_rbtree");
+    tcase_add_test(tc_octo_rbtree, test_octo_rbtree_insert_remove);
+    tcase_add_test(tc_octo_rbtree, test_octo_rbtree_deadlines);
+    return tc_octo_rbtree;
+}
@@ -0,0 +1,167 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <octonaut/ringbuf.h>
+#include <check.h>
+#include <string.h>
+#include <unistd.h>
+
+static void test_wraparound(bool mirror)
+{
+    size_t len = 0;
+    octo_ringbuf ring;
+    const char mystr[] = "the world is not enough";
+    char cmpstr[sizeof(mystr)];
+    struct iovec iov[2];
+    uint8_t *region;
+
+    fail_unless(octo_ringbuf_init(&ring, 1, mirror),
+        "ring buffer init failed");
+
+    fail_unless(octo_ringbuf_size(&ring) == 0,
+        "ring buffer size not set correctly by ringbuf_init");
+
+    /* move the read and write positions up to just before the end,
+     * leaving a byte behind so the positions aren't reset */
+    region = octo_ringbuf_reserve(&ring, &len);
+    octo_ringbuf_commit(&ring, octo_ringbuf_capacity(&ring) - 10);
+    octo_ringbuf_drain(&ring, octo_ringbuf_capacity(&ring) - 11);
+
+    len = octo_ringbuf_write(&ring, (uint8_t*)mystr, sizeof(mystr));
+
+    fail_unless(len == sizeof(mystr),
+        "ring buffer write did not return length of string");
+
+    octo_ringbuf_drain(&ring, 1);
+
+    fail_unless(octo_ringbuf_size(&ring) == sizeof(mystr),
+        "ring buffer size is not correct");
+
+    region = octo_ringbuf_data(&ring, &len);
+
+    if(mirror && ring.mirrored)
+    {
+        fail_unless(len == sizeof(mystr),
+            "mirrored ring buffer data is not contiguous");
+
+        fail_unless(memcmp(region, mystr, sizeof(mystr)) == 0,
+            "mirrored ring buffer data does not match expected string");
+
+        fail_unless(octo_ringbuf_peekv(&ring, iov, 2) == 1,
+            "mirrored ring buffer peekv did not return one iovec");
+    }
+    else
+    {
+        fail_unless(len == 10,
+            "ring buffer data did not stop at the end of memory");
+
+        fail_unless(octo_ringbuf_peekv(&ring, iov, 2) == 2,
+            "ring buffer peekv did not return two iovecs");
+
+        fail_unless(iov[0].iov_len + iov[1].iov_len == sizeof(mystr),
+            "ring buffer peekv lengths are not correct");
+    }
+
+    len = octo_ringbuf_peek(&ring, cmpstr, sizeof(cmpstr));
+
+    fail_unless(len == sizeof(mystr) && memcmp(cmpstr, mystr, sizeof(mystr)) == 0,
+        "ring buffer peek does not match expected string");
+
+    len = octo_ringbuf_read(&ring, cmpstr, 4);
+
+    fail_unless(len == 4 && strncmp(cmpstr, "the ", 4) == 0,
+        "ring buffer read does not match expected string");
+
+    fail_unless(octo_ringbuf_size(&ring) == sizeof(mystr) - 4,
+        "ring buffer size is not correct");
+
+    len = octo_ringbuf_drain(&ring, sizeof(mystr));
+
+    fail_unless(len == sizeof(mystr) - 4,
+        "ring buffer drain did not return correct length");
+
+    fail_unless(octo_ringbuf_size(&ring) == 0,
+        "ring buffer size is not correct");
+
+    octo_ringbuf_destroy(&ring);
+}
+
+START_TEST (test_octo_ringbuf_mirrored)
+{
+    test_wraparound(true);
+}
+END_TEST
+
+START_TEST (test_octo_ringbuf_flat)
+{
+    test_wraparound(false);
+}
+END_TEST
+
+START_TEST (test_octo_ringbuf_full)
+{
+    size_t len = 0;
+    octo_ringbuf ring;
+    const char mystr[] = "the world is not enough";
+    int pipefds[2];
+
+    fail_unless(octo_ringbuf_init(&ring, 1, true),
+        "ring buffer init failed");
+
+    while(octo_ringbuf_remaining(&ring) > 0)
+    {
+        len = octo_ringbuf_write(&ring, (uint8_t*)mystr, sizeof(mystr));
+    }
+
+    fail_unless(len < sizeof(mystr),
+        "ring buffer write did not stop at capacity");
+
+    fail_unless(octo_ringbuf_write(&ring, (uint8_t*)mystr, sizeof(mystr)) == 0,
+        "full ring buffer accepted a write");
+
+    octo_ringbuf_drain(&ring, octo_ringbuf_size(&ring));
+
+    fail_unless(pipe(pipefds) != -1);
+
+    write(pipefds[1], mystr, sizeof(mystr));
+
+    fail_unless(octo_ringbuf_read_fd(&ring, pipefds[0]) == sizeof(mystr),
+        "ring buffer read_fd did not read the message");
+
+    fail_unless(octo_ringbuf_size(&ring) == sizeof(mystr),
+        "ring buffer size is not correct");
+
+    close(pipefds[0]);
+    close(pipefds[1]);
+
+    octo_ringbuf_destroy(&ring);
+}
+END_TEST
+
+TCase* octo_ringbuf_tcase()
+{
+    TCase* tc_octo_ringbuf = tcase_create("octo_ringbuf");
+    tcase_add_test(tc_octo_ringbuf, test_octo_ringbuf_mirrored);
+    tcase_add_test(tc_octo_ringbuf, test_octo_ringbuf_flat);
+    tcase_add_test(tc_octo_ringbuf, test_octo_ringbuf_full);
+    return tc_octo_ringbuf;
+}
@@ -0,0 +1,148 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <octonaut/common.h>
+#include <octonaut/scheduler.h>
+#include <ev.h>
+#include <check.h>
+
+typedef struct test_request
+{
+    int id;
+    int fired;
+    octo_scheduler_entry timeout;
+} test_request;
+
+static int test_order[8];
+static int test_n_fired;
+
+static void test_request_timeout(octo_scheduler *scheduler, octo_scheduler_entry *entry)
+{
+    test_request *request = ptr_offset(entry, test_request, timeout);
+    request->fired += 1;
+    test_order[test_n_fired++] = request->id;
+}
+
+START_TEST (test_octo_scheduler_fire)
+{
+    octo_scheduler scheduler;
+    test_request requests[5];
+    struct ev_loop *loop = EV_DEFAULT;
+
+    fail_unless(octo_scheduler_init(&scheduler, loop, 2), "init should succeed");
+    test_n_fired = 0;
+
+    for(int i = 0; i < 5; ++i)
+    {
+        requests[i].id = i;
+        requests[i].fired = 0;
+        octo_scheduler_entry_init(&requests[i].timeout, test_request_timeout);
+    }
+
+    /* three are already due, out of order, two are far off */
+    octo_scheduler_add(&scheduler, &requests[0].timeout, -1.0);
+    octo_scheduler_add(&scheduler, &requests[1].timeout, -3.0);
+    octo_scheduler_add(&scheduler, &requests[2].timeout, -2.0);
+    octo_scheduler_add(&scheduler, &requests[3].timeout, 100.0);
+    octo_scheduler_add(&scheduler, &requests[4].timeout, 200.0);
+    fail_unless(octo_scheduler_size(&scheduler) == 5, "scheduler size is incorrect");
+    fail_unless(ev_is_active(&scheduler.timer), "timer should be armed");
+
+    /* activity on a request pushes its deadline back */
+    octo_scheduler_add(&scheduler, &requests[0].timeout, 50.0);
+    fail_unless(octo_scheduler_deadline(&scheduler, &requests[0].timeout) ==
+        ev_now(loop) + 50.0, "deadline should have moved");
+
+    fail_unless(octo_scheduler_run(&scheduler) == 2, "both due requests should fire");
+    fail_unless(test_order[0] == 1 && test_order[1] == 2,
+        "requests should fire in deadline order");
+    fail_unless(!octo_scheduler_pending(&requests[1].timeout),
+        "fired request should no longer be pending");
+    fail_unless(octo_scheduler_pending(&requests[3].timeout),
+        "request not due should still be pending");
+    fail_unless(scheduler.timer_at == ev_now(loop) + 50.0,
+        "timer should be set for the earliest deadline left");
+
+    /* a fired request can be scheduled again */
+    octo_scheduler_add(&scheduler, &requests[1].timeout, -1.0);
+    fail_unless(octo_scheduler_run(&scheduler) == 1, "rescheduled request should fire");
+    fail_unless(requests[1].fired == 2, "request should have fired twice");
+
+    octo_scheduler_cancel(&scheduler, &requests[0].timeout);
+    octo_scheduler_cancel(&scheduler, &requests[3].timeout);
+    octo_scheduler_cancel(&scheduler, &requests[3].timeout);
+    fail_unless(ev_is_active(&scheduler.timer), "timer should stay for the last request");
+    octo_scheduler_cancel(&scheduler, &requests[4].timeout);
+    fail_unless(!ev_is_active(&scheduler.timer), "timer should stop with nothing pending");
+    fail_unless(octo_scheduler_size(&scheduler) == 0, "scheduler should be empty");
+
+    octo_scheduler_destroy(&scheduler);
+}
+END_TEST
+
+static void test_request_rearm(octo_scheduler *scheduler, octo_scheduler_entry *entry)
+{
+    test_request *request = ptr_offset(entry, test_request, timeout);
+    request->fired += 1;
+    octo_scheduler_add(scheduler, entry, 0.0);
+}
+
+START_TEST (test_octo_scheduler_rearm)
+{
+    octo_scheduler scheduler;
+    test_request requests[2];
+    struct ev_loop *loop = EV_DEFAULT;
+
+    fail_unless(octo_scheduler_init(&scheduler, loop, 2), "init should succeed");
+
+    for(int i = 0; i < 2; ++i)
+    {
+        requests[i].id = i;
+        requests[i].fired = 0;
+        octo_scheduler_entry_init(&requests[i].timeout, test_request_rearm);
+        octo_scheduler_add(&scheduler, &requests[i].timeout, -1.0);
+    }
+
+    /* each run fires every request once however often they re-arm */
+    for(int run = 1; run <= 3; ++run)
+    {
+        fail_unless(octo_scheduler_run(&scheduler) == 2,
+            "a run should fire only the requests due when it began");
+        fail_unless(requests[0].fired == run && requests[1].fired == run,
+            "requests re-armed with no delay should wait for the next run");
+        fail_unless(octo_scheduler_size(&scheduler) == 2,
+            "re-armed requests should be pending");
+        fail_unless(ev_is_active(&scheduler.timer),
+            "timer should be armed for the re-armed requests");
+    }
+
+    octo_scheduler_destroy(&scheduler);
+}
+END_TEST
+
+TCase* octo_scheduler_tcase()
+{
+    TCase* tc_octo_scheduler = tcase_create("octo_scheduler");
+    tcase_add_test(tc_octo_scheduler, test_octo_scheduler_fire);
+    tcase_add_test(tc_octo_scheduler, test_octo_scheduler_rearm);
+    return tc_octo_scheduler;
+}
@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <octonaut/sweeper.h>
+#include <ev.h>
+#include <check.h>
+#include <string.h>
+
+START_TEST (test_octo_sweeper_idle)
+{
+    octo_sweeper sweeper;
+    octo_sweeper_entry entries[3];
+    octo_buffer bufs[3];
+    static uint8_t data[4096];
+
+    struct ev_loop *loop = EV_DEFAULT;
+
+    octo_sweeper_init(&sweeper, loop, 1.0, 0.0);
+
+    for(int i = 0; i < 3; ++i)
+    {
+        octo_buffer_init(&bufs[i], 256);
+        octo_buffer_write(&bufs[i], data, sizeof(data));
+        octo_buffer_drain(&bufs[i], sizeof(data) - 10);
+        octo_sweeper_add(&sweeper, &entries[i], &bufs[i]);
+    }
+
+    /* the second buffer is busy between sweeps, the third is too but
+     * ends up the same size it was */
+    octo_buffer_write(&bufs[1], data, 10);
+    octo_buffer_write(&bufs[2], data, 10);
+    octo_buffer_drain(&bufs[2], 10);
+    octo_sweeper_sweep(&sweeper);
+
+    fail_unless(octo_buffer_chunks(&bufs[0]) == 0,
+        "idle buffer was not trimmed");
+
+    fail_unless(octo_buffer_chunks(&bufs[1]) != 0,
+        "busy buffer was trimmed");
+
+    fail_unless(octo_buffer_chunks(&bufs[2]) != 0,
+        "busy buffer back at the same size was trimmed");
+
+    fail_unless(sweeper.released > 0,
+        "sweeper did not count released memory");
+
+    octo_sweeper_sweep(&sweeper);
+
+    fail_unless(octo_buffer_chunks(&bufs[1]) == 0,
+        "buffer gone idle was not trimmed");
+
+    for(int i = 0; i < 3; ++i)
+    {
+        octo_sweeper_remove(&entries[i]);
+        octo_buffer_destroy(&bufs[i]);
+    }
+
+    octo_sweeper_destroy(&sweeper);
+}
+END_TEST
+
+TCase* octo_sweeper_tcase()
+{
+    TCase* tc_octo_sweeper = tcase_create("octo_sweeper");
+    tcase_add_test(tc_octo_sweeper, test_octo_sweeper_idle);
+    return tc_octo_sweeper;
+}
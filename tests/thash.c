@@ -0,0 +1,138 @@
+/**
+ * Copyright (c) 2010 Tom Burdick <thomas.burdick@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <octonaut/common.h>
+#include <octonaut/hash_function.h>
+#include <octonaut/thash.h>
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+OCTO_HASH_DEFINE(test_u32_hash, uint32_t, octo_thash_u32, octo_thash_eq)
+
+static inline uint32_t test_str_hash_fn(const char *key)
+{
+    return octo_default_hash_function(key, strlen(key), 0);
+}
+
+static inline bool test_str_eq_fn(const char *a, const char *b)
+{
+    return strcmp(a, b) == 0;
+}
+
+OCTO_HASH_DEFINE(test_str_hash, const char *, test_str_hash_fn, test_str_eq_fn)
+
+typedef struct test_thash_struct
+{
+    int value;
+    test_u32_hash_entry hash;
+} test_thash_struct;
+
+START_TEST (test_octo_thash_u32)
+{
+    test_u32_hash hash;
+    size_t count = 10000;
+    test_thash_struct *s = malloc(sizeof(test_thash_struct)*count);
+
+    test_u32_hash_init(&hash, 0);
+
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        s[i].value = i;
+        test_u32_hash_entry_init(&s[i].hash, i*7);
+        fail_unless(test_u32_hash_put(&hash, &s[i].hash),
+            "put should succeed");
+    }
+
+    fail_unless(!test_u32_hash_put(&hash, &s[3].hash),
+        "double put of the same key should result in failing to put");
+    fail_unless(test_u32_hash_size(&hash) == count,
+        "hash table size is incorrect");
+    fail_unless(hash.n_bins >= count/2,
+        "hash table should have grown with its load");
+
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        test_u32_hash_entry *entry = test_u32_hash_get(&hash, i*7);
+        fail_unless(entry == &s[i].hash,
+            "hash table failed to retrieve correct entry");
+        fail_unless((ptr_offset(entry, test_thash_struct, hash))->value == i,
+            "hash table entry should be in its struct");
+    }
+
+    fail_unless(!test_u32_hash_has(&hash, 1),
+        "hash table should not find a missing key");
+
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        fail_unless(test_u32_hash_pop(&hash, i*7) == &s[i].hash,
+            "hash table failed to pop correct entry");
+    }
+
+    fail_unless(test_u32_hash_size(&hash) == 0,
+        "hash table size is incorrect");
+    fail_unless(test_u32_hash_pop(&hash, 7) == NULL,
+        "popped entry should be gone");
+
+    test_u32_hash_destroy(&hash);
+    free(s);
+}
+END_TEST
+
+START_TEST (test_octo_thash_strings)
+{
+    test_str_hash hash;
+    test_str_hash_entry s[3];
+    char queen[] = "Queen";
+
+    test_str_hash_init(&hash, 1);
+
+    test_str_hash_entry_init(&s[0], "Queen");
+    test_str_hash_entry_init(&s[1], "King");
+    test_str_hash_entry_init(&s[2], "Jack");
+
+    for(int i = 0; i < 3; ++i)
+    {
+        fail_unless(test_str_hash_put(&hash, &s[i]),
+            "put should succeed");
+    }
+
+    fail_unless(test_str_hash_get(&hash, queen) == &s[0],
+        "hash table should compare keys by value");
+    fail_unless(test_str_hash_get(&hash, "Ace") == NULL,
+        "hash table should not find a missing key");
+    fail_unless(test_str_hash_pop(&hash, "King") == &s[1],
+        "hash table failed to pop correct entry");
+    fail_unless(test_str_hash_size(&hash) == 2,
+        "hash table size is incorrect");
+
+    test_str_hash_destroy(&hash);
+}
+END_TEST
+
+TCase* octo_thash_tcase()
+{
+    TCase* tc_octo_thash = tcase_create("octo_thash");
+    tcase_add_test(tc_octo_thash, test_octo_thash_u32);
+    tcase_add_test(tc_octo_thash, test_octo_thash_strings);
+    return tc_octo_thash;
+}